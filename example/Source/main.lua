@@ -7,6 +7,7 @@ local screen <const> = playdate.display
 local v2d <const> = collision.vector2D
 local poly <const> = collision.polygon
 local coll <const> = collision
+local grid <const> = collision.grid
 
 
 local positions = {
@@ -32,24 +33,21 @@ local bigPoly = poly.new(
 local polyMiddle, polyRadius = bigPoly:getBoundingCircle()
 bigPoly:cacheNormals()
 
-
--- list is array of Vector2d structs
--- will always assume poly described by list is closed
-local function drawV2DListAsPoly(list)
-    for i=1, #list do
-        local x1,y1 = list[i]:unpack()
-        local x2,y2 = list[(i % #list)+1]:unpack()
-        gfx.drawLine(x1,y1,x2,y2)
-    end
+-- broadphase for circle-circle checks, ids match indices in positions
+local bodyGrid = grid.new(32)
+for i = 1, #positions do
+    bodyGrid:insertCircle(positions[i], radius)
 end
 
+
 local function render()
     gfx.clear(gfx.kColorWhite)
 
     for i = 1, #positions do
         gfx.drawCircleAtPoint(positions[i], radius)
     end
-    drawV2DListAsPoly(bigPoly)
+    -- unpack pushes all coordinates onto the Lua stack, fine for up to 8 vertices
+    gfx.drawPolygon(bigPoly:unpack())
     -- gfx.drawCircleAtPoint(polyMiddle, polyRadius)
 
     playdate.drawFPS(380,2)
@@ -60,7 +58,9 @@ local time = 0
 local sum = 0
 local count = 0
 
-local colNormal = nil
+-- reused for all collision results, so the update loop does not create any garbage
+local colNormal = v2d.new(0,0)
+local velDiff = v2d.new(0,0)
 local depth = 0
 
 function playdate.update()
@@ -80,27 +80,33 @@ function playdate.update()
     end
 
     for i=1, #positions do
-        for k=i+1, #positions do
-            local collides = coll.circleCircle_check(positions[i], radius, positions[k], radius)
-            if not collides then goto continue_inner end
+        bodyGrid:updateCircle(i, positions[i], radius)
+    end
 
-            colNormal, depth = coll.circleCircle(positions[i], radius, positions[k], radius)
-            positions[i]:addScaled(colNormal, -depth / 2)
-            positions[k]:addScaled(colNormal, depth / 2)
+    local pairCount = bodyGrid:findPairs()
+    for p=1, pairCount do
+        local i, k = bodyGrid:getPair(p)
+        depth = coll.circleCircle_into(colNormal, positions[i], radius, positions[k], radius)
+        if depth == nil then goto continue_pair end
 
-            local velDiff = v2d.new(velocities[i].x - velocities[k].x, velocities[i].y - velocities[k].y)
-            local relSpeed = colNormal:dotProduct(velDiff)
-            velocities[i]:addScaled(colNormal, -relSpeed)
-            velocities[k]:addScaled(colNormal, relSpeed)
+        positions[i]:addScaled(colNormal, -depth / 2)
+        positions[k]:addScaled(colNormal, depth / 2)
 
-            ::continue_inner::
-        end
+        velDiff.x = velocities[i].x - velocities[k].x
+        velDiff.y = velocities[i].y - velocities[k].y
+        local relSpeed = colNormal:dotProduct(velDiff)
+        velocities[i]:addScaled(colNormal, -relSpeed)
+        velocities[k]:addScaled(colNormal, relSpeed)
+
+        ::continue_pair::
+    end
 
+    for i=1, #positions do
         local collides = coll.circleCircle_check(positions[i], radius, polyMiddle, polyRadius)
         if not collides then goto continue end
 
-        colNormal, depth = coll.circlePoly(positions[i], radius, bigPoly)
-        if colNormal ~= nil then
+        depth = coll.circlePoly_into(colNormal, positions[i], radius, bigPoly)
+        if depth ~= nil then
             positions[i]:addScaled(colNormal, -depth)
 
             local dp = colNormal:dotProduct(velocities[i])
@@ -130,6 +136,7 @@ function playdate.AButtonUp()
     end
 
     table.insert(positions, pos)
+    bodyGrid:insertCircle(pos, radius)
     local vel = v2d.new(math.random() * 2 + 1, math.random() * 2 + 1)
     table.insert(velocities, vel)
 end
@@ -138,6 +145,7 @@ function playdate.BButtonUp()
     local count = #positions
     for i=1, count do positions[i]=nil end
     for i=1, count do velocities[i]=nil end
+    bodyGrid:clear()
 end
 
 ---
@@ -150,6 +158,7 @@ local bechmarkItem, _ = menu:addMenuItem("Benchmark", function()
     local count = #positions
     for i=1, count do positions[i]=nil end
     for i=1, count do velocities[i]=nil end
+    bodyGrid:clear()
 
     table.insert(positions, v2d.new(50,50))
     table.insert(positions, v2d.new(260,50))
@@ -193,6 +202,10 @@ local bechmarkItem, _ = menu:addMenuItem("Benchmark", function()
     table.insert(velocities, v2d.new(-2,2))
     table.insert(velocities, v2d.new(1,2))
 
+    for i = 1, #positions do
+        bodyGrid:insertCircle(positions[i], radius)
+    end
+
     print("--- Starting benchmark...");
     for i=1,3 do
         local benchTime = playdate.getElapsedTime()
@@ -203,4 +216,16 @@ local bechmarkItem, _ = menu:addMenuItem("Benchmark", function()
         print(string.format("Round %d: 100 frames in %.2fms", i, benchTime * 1000))
     end
     print("--- Benchmark finished")
-end)
\ No newline at end of file
+end)
+
+-- scripted scenes at 20, 200 and 2000 bodies, compared against scenarios.csv from an earlier run if there is one
+local scenarioItem, _ = menu:addMenuItem("Scenarios", function()
+    local baseline = nil
+    if playdate.file.exists("scenarios.csv") then
+        baseline = "scenarios.csv"
+    end
+
+    print("--- Starting scenarios...")
+    local regressions = collision.scenario.runSuite(baseline, 10, "scenarios_last.csv")
+    print(string.format("--- Scenarios finished, %d regressions", regressions))
+end)
@@ -6,6 +6,13 @@
 #include "../src/vector2d.h"
 #include "../src/polygon.h"
 #include "../src/collision.h"
+#include "../src/spatialgrid.h"
+#include "../src/aabbtree.h"
+#include "../src/sweepprune.h"
+#include "../src/world.h"
+#include "../src/stats.h"
+#include "../src/trace.h"
+#include "../src/scenario.h"
 
 static PlaydateAPI* pd = NULL;
 
@@ -23,6 +30,13 @@ int eventHandler(PlaydateAPI* playdate, PDSystemEvent event, uint32_t arg)
 		registerCollision(pd);
 		registerVector2D(pd);
 		registerPoly(pd);
+		registerSpatialGrid(pd);
+		registerAABBTree(pd);
+		registerSweepPrune(pd);
+		registerWorld(pd);
+		registerStats(pd);
+		registerTrace(pd);
+		registerScenario(pd);
 	}
 
 	return 0;
@@ -0,0 +1,791 @@
+// Host benchmark for the collision kernels in src/collision.c
+//
+// Every kernel is timed against a small set of prepared shapes, where a given
+// fraction of the shapes overlap the reference shape (hit ratio). Polygon kernels
+// are additionally run for different vertex counts and preparation levels: plain
+// vertices, cached normals, plus convexity flag and plus cached bounds.
+//
+// The broadphase structures are timed on a scene of moving circles (same density
+// for every body count), compared against brute force all-pairs testing. world_step
+// runs the same scene through the complete physics step of world.h.
+//
+// The vector kernels of simd.h are checked against plain loops on random inputs, so the SSE2,
+// AVX2 and scalar (-DCOLLISION_SIMD=OFF) builds have to agree.
+//
+// With COLLISION_THREADS (on by default) the batchPairs functions are timed single-threaded
+// and on a thread pool (see parallel.h) for the pairs of the same scene.
+//
+// Built with -DCOLLISION_STATS=ON the instrumentation counters of the whole run are
+// printed at the end (see stats.h).
+//
+// Usage: collision_bench [--csv] [--quick]
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "pd_api.h"
+#include "vector2d.h"
+#include "polygon.h"
+#include "collision.h"
+#include "spatialgrid.h"
+#include "aabbtree.h"
+#include "sweepprune.h"
+#include "world.h"
+#include "stats.h"
+#include "parallel.h"
+#include "simd.h"
+
+#define SHAPE_COUNT 16
+#define SHAPE_RADIUS 20.0f
+#define HIT_OFFSET 15.0f
+#define MISS_OFFSET 60.0f
+
+#define SCENE_RADIUS 5.0f
+#define SCENE_CELL_SIZE 16.0f
+#define SCENE_FRAMES 100
+
+#define SIMD_CHECK_ROUNDS 2000
+#define SIMD_CHECK_MAX_VERTS 64
+#define SIMD_CHECK_MAX_CIRCLES 37
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef struct
+{
+    Polygon *refPoly;
+    Vector2D refCenter;
+    Polygon *polys[SHAPE_COUNT];
+    Vector2D centers[SHAPE_COUNT];
+} BenchCase;
+
+typedef int (*BenchFn)(const BenchCase *c, int i);
+
+typedef enum
+{
+    PREP_NONE,
+    PREP_NORMALS,
+    PREP_CONVEX,
+    PREP_BOUNDS,
+} BenchPrep;
+
+static const char *prepLabels[] = { "none", "normals", "convex", "bounds" };
+
+typedef struct
+{
+    int count;
+    float width;
+    float height;
+    Vector2D *pos;
+    Vector2D *vel;
+} BenchScene;
+
+static int csvOutput = 0;
+static double minSeconds = 0.1;
+static int sceneFrames = SCENE_FRAMES;
+static volatile int sink = 0;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Regular n-gon in CW order (screen coordinates), matching the example project
+static void setRegularPoly(Polygon *p, Vector2D center, float radius)
+{
+    for (int i = 0; i < p->count; ++i)
+    {
+        float angle = (float)(2.0 * M_PI * i / p->count);
+        p->verts[i].x = center.x + cosf(angle) * radius;
+        p->verts[i].y = center.y + sinf(angle) * radius;
+    }
+}
+
+// Places shape i either overlapping the reference (first hitCount shapes) or
+// well outside of it. Directions are spread evenly around the reference shape.
+static Vector2D shapeOffset(Vector2D ref, int i, int hitCount)
+{
+    float angle = (float)(2.0 * M_PI * i / SHAPE_COUNT) + 0.3f;
+    float dist = i < hitCount ? HIT_OFFSET : MISS_OFFSET;
+    Vector2D result = { .x = ref.x + cosf(angle) * dist, .y = ref.y + sinf(angle) * dist };
+    return result;
+}
+
+static void preparePoly(Polygon *p, BenchPrep prep)
+{
+    if (prep >= PREP_NORMALS)
+        polygon_cacheNormals(p);
+    if (prep >= PREP_CONVEX)
+        polygon_updateConvex(p);
+    if (prep >= PREP_BOUNDS)
+        polygon_updateCache(p);
+}
+
+// vertCount == 0 only sets up circles
+static void benchCase_init(BenchCase *c, int vertCount, float hitRatio, BenchPrep prep)
+{
+    int hitCount = (int)(hitRatio * SHAPE_COUNT + 0.5f);
+    c->refCenter.x = 200.0f;
+    c->refCenter.y = 120.0f;
+    for (int i = 0; i < SHAPE_COUNT; ++i)
+        c->centers[i] = shapeOffset(c->refCenter, i, hitCount);
+
+    c->refPoly = NULL;
+    if (vertCount == 0)
+        return;
+
+    c->refPoly = polygon_new(vertCount);
+    setRegularPoly(c->refPoly, c->refCenter, SHAPE_RADIUS);
+    preparePoly(c->refPoly, prep);
+
+    for (int i = 0; i < SHAPE_COUNT; ++i)
+    {
+        c->polys[i] = polygon_new(vertCount);
+        setRegularPoly(c->polys[i], c->centers[i], SHAPE_RADIUS);
+        preparePoly(c->polys[i], prep);
+    }
+}
+
+static void benchCase_free(BenchCase *c)
+{
+    if (c->refPoly == NULL)
+        return;
+
+    polygon_free(c->refPoly);
+    for (int i = 0; i < SHAPE_COUNT; ++i)
+        polygon_free(c->polys[i]);
+}
+
+// --- KERNELS ---
+
+static int bench_circleCircle_check(const BenchCase *c, int i)
+{
+    return collision_circleCircle_check(c->refCenter, SHAPE_RADIUS, c->centers[i], SHAPE_RADIUS);
+}
+
+static int bench_circleCircle(const BenchCase *c, int i)
+{
+    Vector2D resolveDir;
+    float depth;
+    return collision_circleCircle(&resolveDir, &depth, c->refCenter, SHAPE_RADIUS, c->centers[i], SHAPE_RADIUS);
+}
+
+static int bench_polyPoly_check(const BenchCase *c, int i)
+{
+    return collision_polyPoly_check(*c->refPoly, *c->polys[i]);
+}
+
+static int bench_polyPoly(const BenchCase *c, int i)
+{
+    Vector2D resolveDir;
+    float depth;
+    return collision_polyPoly(&resolveDir, &depth, *c->refPoly, *c->polys[i]);
+}
+
+static int bench_circlePoly_check(const BenchCase *c, int i)
+{
+    return collision_circlePoly_check(c->centers[i], SHAPE_RADIUS, *c->refPoly);
+}
+
+static int bench_circlePoly(const BenchCase *c, int i)
+{
+    Vector2D resolveDir;
+    float depth;
+    return collision_circlePoly(&resolveDir, &depth, c->centers[i], SHAPE_RADIUS, *c->refPoly);
+}
+
+static int bench_polyPoly_gjk_check(const BenchCase *c, int i)
+{
+    return collision_polyPoly_gjk_check(*c->refPoly, *c->polys[i]);
+}
+
+static int bench_polyPoly_gjk(const BenchCase *c, int i)
+{
+    Vector2D resolveDir;
+    float depth;
+    return collision_polyPoly_gjk(&resolveDir, &depth, *c->refPoly, *c->polys[i]);
+}
+
+static int bench_circlePoly_gjk_check(const BenchCase *c, int i)
+{
+    return collision_circlePoly_gjk_check(c->centers[i], SHAPE_RADIUS, *c->refPoly);
+}
+
+static int bench_circlePoly_gjk(const BenchCase *c, int i)
+{
+    Vector2D resolveDir;
+    float depth;
+    return collision_circlePoly_gjk(&resolveDir, &depth, c->centers[i], SHAPE_RADIUS, *c->refPoly);
+}
+
+// --- RUNNER ---
+
+static double runLoop(BenchFn fn, const BenchCase *c, long iterations)
+{
+    int hits = 0;
+    double start = now();
+    for (long n = 0; n < iterations; ++n)
+        hits += fn(c, (int)(n % SHAPE_COUNT));
+    double elapsed = now() - start;
+    sink += hits;
+    return elapsed;
+}
+
+// Doubles the iteration count until a run takes at least minSeconds
+static double measure(BenchFn fn, const BenchCase *c, long *outIterations)
+{
+    long iterations = SHAPE_COUNT * 64;
+    double elapsed = runLoop(fn, c, iterations);
+    while (elapsed < minSeconds)
+    {
+        iterations *= 2;
+        elapsed = runLoop(fn, c, iterations);
+    }
+    *outIterations = iterations;
+    return elapsed;
+}
+
+static void printHeader(void)
+{
+    if (csvOutput)
+        printf("kernel,verts,hit_ratio,prep,ns_per_call,calls_per_sec\n");
+    else
+        printf("%-22s %6s %6s %8s %12s %14s\n", "kernel", "verts", "hit%", "prep", "ns/call", "calls/sec");
+}
+
+static void printResult(const char *name, int verts, float hitRatio, const char *prep, double seconds, long iterations)
+{
+    double nsPerCall = seconds * 1e9 / iterations;
+    double callsPerSec = iterations / seconds;
+    if (csvOutput)
+        printf("%s,%d,%.2f,%s,%.2f,%.0f\n", name, verts, hitRatio, prep, nsPerCall, callsPerSec);
+    else if (verts == 0)
+        printf("%-22s %6s %5.0f%% %8s %12.2f %14.0f\n", name, "-", hitRatio * 100.0f, prep, nsPerCall, callsPerSec);
+    else
+        printf("%-22s %6d %5.0f%% %8s %12.2f %14.0f\n", name, verts, hitRatio * 100.0f, prep, nsPerCall, callsPerSec);
+}
+
+static void runKernel(const char *name, BenchFn fn, int verts, float hitRatio, BenchPrep prep)
+{
+    BenchCase c;
+    long iterations;
+    benchCase_init(&c, verts, hitRatio, prep);
+    double seconds = measure(fn, &c, &iterations);
+    printResult(name, verts, hitRatio, verts == 0 ? "-" : prepLabels[prep], seconds, iterations);
+    benchCase_free(&c);
+}
+
+// --- BROADPHASE ---
+
+// Body count scales the world size, so density stays the same as 200 bodies on 400x240
+static void benchScene_init(BenchScene *s, int count)
+{
+    float scale = count > 200 ? sqrtf(count / 200.0f) : 1.0f;
+    s->count = count;
+    s->width = 400.0f * scale;
+    s->height = 240.0f * scale;
+    s->pos = malloc(sizeof(Vector2D) * count);
+    s->vel = malloc(sizeof(Vector2D) * count);
+
+    srand(1234);
+    for (int i = 0; i < count; ++i)
+    {
+        s->pos[i].x = SCENE_RADIUS + (float)rand() / RAND_MAX * (s->width - 2 * SCENE_RADIUS);
+        s->pos[i].y = SCENE_RADIUS + (float)rand() / RAND_MAX * (s->height - 2 * SCENE_RADIUS);
+        s->vel[i].x = (float)rand() / RAND_MAX * 8.0f - 4.0f;
+        s->vel[i].y = (float)rand() / RAND_MAX * 8.0f - 4.0f;
+    }
+}
+
+static void benchScene_free(BenchScene *s)
+{
+    free(s->pos);
+    free(s->vel);
+}
+
+static void benchScene_step(BenchScene *s)
+{
+    for (int i = 0; i < s->count; ++i)
+    {
+        if ((s->pos[i].x < SCENE_RADIUS && s->vel[i].x < 0) || (s->pos[i].x >= s->width - SCENE_RADIUS && s->vel[i].x > 0))
+            s->vel[i].x = -s->vel[i].x;
+        if ((s->pos[i].y < SCENE_RADIUS && s->vel[i].y < 0) || (s->pos[i].y >= s->height - SCENE_RADIUS && s->vel[i].y > 0))
+            s->vel[i].y = -s->vel[i].y;
+        vector2D_addVecScaled(&s->pos[i], s->vel[i], 1.0f);
+    }
+}
+
+static int broadphase_bruteForce(BenchScene *s, int frames)
+{
+    int pairs = 0;
+    AABB *bounds = malloc(sizeof(AABB) * s->count);
+    for (int f = 0; f < frames; ++f)
+    {
+        benchScene_step(s);
+        pairs = 0;
+        for (int i = 0; i < s->count; ++i)
+            aabb_fromCircle(&bounds[i], s->pos[i], SCENE_RADIUS);
+        for (int i = 0; i < s->count; ++i)
+            for (int k = i + 1; k < s->count; ++k)
+                pairs += aabb_overlaps(bounds[i], bounds[k]);
+    }
+    free(bounds);
+    return pairs;
+}
+
+static int broadphase_grid(BenchScene *s, int frames)
+{
+    int pairs = 0;
+    AABB bounds;
+    SpatialGrid *grid = spatialGrid_new(SCENE_CELL_SIZE);
+    for (int i = 0; i < s->count; ++i)
+    {
+        aabb_fromCircle(&bounds, s->pos[i], SCENE_RADIUS);
+        spatialGrid_insert(grid, bounds);
+    }
+    for (int f = 0; f < frames; ++f)
+    {
+        benchScene_step(s);
+        for (int i = 0; i < s->count; ++i)
+        {
+            aabb_fromCircle(&bounds, s->pos[i], SCENE_RADIUS);
+            spatialGrid_update(grid, i, bounds);
+        }
+        pairs = spatialGrid_findPairs(grid);
+    }
+    spatialGrid_free(grid);
+    return pairs;
+}
+
+static int broadphase_tree(BenchScene *s, int frames)
+{
+    int pairs = 0;
+    AABB bounds;
+    AABBTree *tree = aabbTree_new(TREE_DEFAULT_MARGIN);
+    int *ids = malloc(sizeof(int) * s->count);
+    for (int i = 0; i < s->count; ++i)
+    {
+        aabb_fromCircle(&bounds, s->pos[i], SCENE_RADIUS);
+        ids[i] = aabbTree_insert(tree, bounds);
+    }
+    for (int f = 0; f < frames; ++f)
+    {
+        benchScene_step(s);
+        for (int i = 0; i < s->count; ++i)
+        {
+            aabb_fromCircle(&bounds, s->pos[i], SCENE_RADIUS);
+            aabbTree_update(tree, ids[i], bounds);
+        }
+        pairs = aabbTree_findPairs(tree);
+    }
+    free(ids);
+    aabbTree_free(tree);
+    return pairs;
+}
+
+static int broadphase_sweepPrune(BenchScene *s, int frames)
+{
+    int pairs = 0;
+    AABB bounds;
+    SweepPrune *sap = sweepPrune_new();
+    for (int i = 0; i < s->count; ++i)
+    {
+        aabb_fromCircle(&bounds, s->pos[i], SCENE_RADIUS);
+        sweepPrune_insert(sap, bounds);
+    }
+    for (int f = 0; f < frames; ++f)
+    {
+        benchScene_step(s);
+        for (int i = 0; i < s->count; ++i)
+        {
+            aabb_fromCircle(&bounds, s->pos[i], SCENE_RADIUS);
+            sweepPrune_update(sap, i, bounds);
+        }
+        pairs = sweepPrune_findPairs(sap);
+    }
+    sweepPrune_free(sap);
+    return pairs;
+}
+
+// Whole frame in C: integration, grid broadphase, narrowphase and resolution, returns collisions
+static int broadphase_world(BenchScene *s, int frames)
+{
+    int contacts = 0;
+    World *world = world_new(SCENE_CELL_SIZE);
+    world->hasBounds = 1;
+    world->bounds.maxX = s->width;
+    world->bounds.maxY = s->height;
+    for (int i = 0; i < s->count; ++i)
+    {
+        int index = world_addCircle(world, &s->pos[i], SCENE_RADIUS, 1.0f, 1.0f);
+        world->bodies[index].velocity = s->vel[i];
+    }
+    for (int f = 0; f < frames; ++f)
+        contacts = world_step(world, 1.0f);
+    world_free(world);
+    return contacts;
+}
+
+// --- SIMD CHECK ---
+
+static float randomFloat(float min, float max)
+{
+    return min + (float)rand() / RAND_MAX * (max - min);
+}
+
+// Plain loops computing the same as the simd.h kernels. Min, max and the squared distance test
+// are exact in every lane order, so any kernel has to return the same values.
+static void reference_projectMinMax(float *outMin, float *outMax, const Polygon *p, Vector2D axis)
+{
+    *outMin = FLT_MAX;
+    *outMax = -FLT_MAX;
+    for (int i = 0; i < p->count; ++i)
+    {
+        float d = axis.x * p->verts[i].x + axis.y * p->verts[i].y;
+        *outMin = d < *outMin ? d : *outMin;
+        *outMax = d > *outMax ? d : *outMax;
+    }
+}
+
+static int reference_circleCandidates(int *indices, float x, float y, float r, const float *xs, const float *ys, const float *rs, int count)
+{
+    int found = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        float dx = xs[i] - x;
+        float dy = ys[i] - y;
+        float sum = rs[i] + r;
+        if (!(dx * dx + dy * dy >= sum * sum))
+            indices[found++] = i;
+    }
+    return found;
+}
+
+// Projects random polygons (through their padded SoA copy) and tests random circles with the
+// kernels of this build and the reference loops. Small integer coordinates make circles touch
+// exactly, the edge case of the rejection test. Returns 1 on any difference.
+static int runSimdCheck(void)
+{
+    static float xs[SIMD_CHECK_MAX_CIRCLES], ys[SIMD_CHECK_MAX_CIRCLES], rs[SIMD_CHECK_MAX_CIRCLES];
+    static int expected[SIMD_CHECK_MAX_CIRCLES], found[SIMD_CHECK_MAX_CIRCLES];
+    int projections = 0;
+    int candidateSets = 0;
+    int mismatches = 0;
+
+    srand(4321);
+    for (int round = 0; round < SIMD_CHECK_ROUNDS; ++round)
+    {
+        Polygon *p = polygon_new(3 + round % (SIMD_CHECK_MAX_VERTS - 2));
+        for (int i = 0; i < p->count; ++i)
+        {
+            p->verts[i].x = randomFloat(-100.0f, 100.0f);
+            p->verts[i].y = randomFloat(-100.0f, 100.0f);
+        }
+        polygon_updateCache(p);
+
+        Vector2D axis = { .x = randomFloat(-1.0f, 1.0f), .y = randomFloat(-1.0f, 1.0f) };
+        float min, max, expectedMin, expectedMax;
+        simd_projectMinMax(&min, &max, p->soa, p->soa + p->soaCount, p->soaCount, axis.x, axis.y);
+        reference_projectMinMax(&expectedMin, &expectedMax, p, axis);
+        if (min != expectedMin || max != expectedMax)
+        {
+            if (mismatches++ == 0)
+                fprintf(stderr, "simd_projectMinMax: %d vertices, %g %g instead of %g %g\n", p->count, min, max, expectedMin, expectedMax);
+        }
+        ++projections;
+        polygon_free(p);
+
+        int count = round % (SIMD_CHECK_MAX_CIRCLES + 1);
+        int exact = round % 2;
+        for (int i = 0; i < count; ++i)
+        {
+            xs[i] = exact ? (float)(rand() % 16) : randomFloat(0.0f, 64.0f);
+            ys[i] = exact ? (float)(rand() % 16) : randomFloat(0.0f, 64.0f);
+            rs[i] = exact ? (float)(rand() % 6) : randomFloat(1.0f, 8.0f);
+        }
+        float x = exact ? (float)(rand() % 16) : randomFloat(0.0f, 64.0f);
+        float y = exact ? (float)(rand() % 16) : randomFloat(0.0f, 64.0f);
+        float r = exact ? (float)(rand() % 6) : randomFloat(1.0f, 8.0f);
+        int foundCount = simd_circleCandidates(found, x, y, r, xs, ys, rs, count);
+        int expectedCount = reference_circleCandidates(expected, x, y, r, xs, ys, rs, count);
+        if (foundCount != expectedCount || memcmp(found, expected, sizeof(int) * foundCount) != 0)
+        {
+            if (mismatches++ == 0)
+                fprintf(stderr, "simd_circleCandidates: %d circles, %d candidates instead of %d\n", count, foundCount, expectedCount);
+        }
+        ++candidateSets;
+    }
+
+    if (csvOutput)
+        printf("simd_check,lanes,projections,candidate_sets,mismatches\nsimd_check,%d,%d,%d,%d\n",
+                SIMD_WIDTH, projections, candidateSets, mismatches);
+    else
+        printf("simd check (%d lanes): %d projections, %d candidate sets, %d mismatches\n",
+                SIMD_WIDTH, projections, candidateSets, mismatches);
+    return mismatches > 0;
+}
+
+// --- PARALLEL ---
+
+#if COLLISION_THREADS
+
+typedef struct
+{
+    float *x;
+    float *y;
+    float *r;
+    Polygon **polys;
+    SpatialGrid *grid;
+    CollisionResult *results;
+    int pairCount;
+} PairScene;
+
+// Circles and hexagons at the positions of the broadphase scene, candidate pairs from a grid
+static void pairScene_init(PairScene *p, int count)
+{
+    BenchScene s;
+    benchScene_init(&s, count);
+    p->x = malloc(sizeof(float) * count);
+    p->y = malloc(sizeof(float) * count);
+    p->r = malloc(sizeof(float) * count);
+    p->polys = malloc(sizeof(Polygon *) * count);
+    p->grid = spatialGrid_new(SCENE_CELL_SIZE);
+
+    AABB bounds;
+    for (int i = 0; i < count; ++i)
+    {
+        p->x[i] = s.pos[i].x;
+        p->y[i] = s.pos[i].y;
+        p->r[i] = SCENE_RADIUS;
+        p->polys[i] = polygon_new(6);
+        setRegularPoly(p->polys[i], s.pos[i], SCENE_RADIUS);
+        preparePoly(p->polys[i], PREP_BOUNDS);
+        aabb_fromCircle(&bounds, s.pos[i], SCENE_RADIUS);
+        spatialGrid_insert(p->grid, bounds);
+    }
+    p->pairCount = spatialGrid_findPairs(p->grid);
+    p->results = malloc(sizeof(CollisionResult) * (p->pairCount > 0 ? p->pairCount : 1));
+    benchScene_free(&s);
+}
+
+static void pairScene_free(PairScene *p, int count)
+{
+    for (int i = 0; i < count; ++i)
+        polygon_free(p->polys[i]);
+    free(p->x);
+    free(p->y);
+    free(p->r);
+    free(p->polys);
+    free(p->results);
+    spatialGrid_free(p->grid);
+}
+
+// pool NULL runs the single-threaded function
+static int runPairs(ParallelPool *pool, PairScene *p, int polys)
+{
+    if (polys && pool != NULL)
+        return parallel_polyPoly_batchPairs(pool, p->results, p->pairCount, p->polys, p->grid->pairs, p->pairCount, COLLISION_SAT);
+    if (polys)
+        return collision_polyPoly_batchPairs(p->results, p->pairCount, p->polys, p->grid->pairs, p->pairCount, COLLISION_SAT);
+    if (pool != NULL)
+        return parallel_circleCircle_batchPairs(pool, p->results, p->pairCount, p->x, p->y, p->r, p->grid->pairs, p->pairCount);
+    return collision_circleCircle_batchPairs(p->results, p->pairCount, p->x, p->y, p->r, p->grid->pairs, p->pairCount);
+}
+
+// Times one variant on the pair set and prints its row, returns the number of collisions
+static int timePairs(const char *name, ParallelPool *pool, PairScene *p, int count, int polys)
+{
+    int hits = 0;
+    long calls = 0;
+    double start = now();
+    double elapsed = 0;
+    while (elapsed < minSeconds)
+    {
+        hits = runPairs(pool, p, polys);
+        ++calls;
+        elapsed = now() - start;
+    }
+    sink += hits;
+
+    double usPerCall = elapsed * 1e6 / calls;
+    int threads = pool != NULL ? parallel_threadCount(pool) : 1;
+    if (csvOutput)
+        printf("%s,%d,%d,%d,%d,%.2f\n", name, count, threads, p->pairCount, hits, usPerCall);
+    else
+        printf("%-22s %6d %7d %8d %8d %12.2f\n", name, count, threads, p->pairCount, hits, usPerCall);
+    return hits;
+}
+
+// Runs the serial and the pooled variant on the same pair set, returns 0 if both found the
+// same collisions in the same order
+static int runParallel(const char *name, ParallelPool *pool, int count, int polys)
+{
+    PairScene p;
+    pairScene_init(&p, count);
+
+    size_t resultsSize = sizeof(CollisionResult) * (p.pairCount > 0 ? p.pairCount : 1);
+    CollisionResult *expected = malloc(resultsSize);
+    int expectedHits = timePairs(name, NULL, &p, count, polys);
+    memcpy(expected, p.results, resultsSize);
+    memset(p.results, 0, resultsSize);
+
+    int hits = timePairs(name, pool, &p, count, polys);
+    int mismatch = hits != expectedHits || memcmp(expected, p.results, sizeof(CollisionResult) * hits) != 0;
+    if (mismatch)
+        fprintf(stderr, "%s: pooled results differ from the serial ones (%d bodies, %d vs %d hits)\n", name, count, hits, expectedHits);
+
+    free(expected);
+    pairScene_free(&p, count);
+    return mismatch;
+}
+
+#endif // COLLISION_THREADS
+
+typedef int (*BroadphaseFn)(BenchScene *s, int frames);
+
+static void runBroadphase(const char *name, BroadphaseFn fn, int count)
+{
+    BenchScene s;
+    benchScene_init(&s, count);
+    double start = now();
+    int pairs = fn(&s, sceneFrames);
+    double elapsed = now() - start;
+    benchScene_free(&s);
+
+    double usPerFrame = elapsed * 1e6 / sceneFrames;
+    if (csvOutput)
+        printf("%s,%d,%d,%.2f\n", name, count, pairs, usPerFrame);
+    else
+        printf("%-22s %6d %8d %12.2f\n", name, count, pairs, usPerFrame);
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--csv") == 0)
+            csvOutput = 1;
+        else if (strcmp(argv[i], "--quick") == 0)
+        {
+            minSeconds = 0.01;
+            sceneFrames = 10;
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--csv] [--quick]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    PlaydateAPI *pd = pdstub_api();
+    registerCollision(pd);
+    registerVector2D(pd);
+    registerPoly(pd);
+    registerSpatialGrid(pd);
+    registerAABBTree(pd);
+    registerSweepPrune(pd);
+    registerWorld(pd);
+    registerStats(pd);
+    registerParallel(pd);
+
+    int failed = 0;
+
+    static const int vertCounts[] = { 3, 4, 8, 16, 32, 64 };
+    static const float hitRatios[] = { 0.0f, 0.5f, 1.0f };
+    const int vertCountsLen = sizeof(vertCounts) / sizeof(vertCounts[0]);
+    const int hitRatiosLen = sizeof(hitRatios) / sizeof(hitRatios[0]);
+
+    static const struct
+    {
+        const char *name;
+        BenchFn fn;
+    } polyKernels[] =
+    {
+        { "polyPoly_check", bench_polyPoly_check },
+        { "polyPoly", bench_polyPoly },
+        { "circlePoly_check", bench_circlePoly_check },
+        { "circlePoly", bench_circlePoly },
+        { "polyPoly_gjk_check", bench_polyPoly_gjk_check },
+        { "polyPoly_gjk", bench_polyPoly_gjk },
+        { "circlePoly_gjk_check", bench_circlePoly_gjk_check },
+        { "circlePoly_gjk", bench_circlePoly_gjk },
+    };
+
+    printHeader();
+
+    for (int h = 0; h < hitRatiosLen; ++h)
+    {
+        runKernel("circleCircle_check", bench_circleCircle_check, 0, hitRatios[h], PREP_NONE);
+        runKernel("circleCircle", bench_circleCircle, 0, hitRatios[h], PREP_NONE);
+    }
+
+    for (int k = 0; k < (int)(sizeof(polyKernels) / sizeof(polyKernels[0])); ++k)
+    {
+        for (int v = 0; v < vertCountsLen; ++v)
+        {
+            for (int h = 0; h < hitRatiosLen; ++h)
+            {
+                for (int prep = PREP_NONE; prep <= PREP_BOUNDS; ++prep)
+                    runKernel(polyKernels[k].name, polyKernels[k].fn, vertCounts[v], hitRatios[h], prep);
+            }
+        }
+    }
+
+    printf("\n");
+    failed |= runSimdCheck();
+
+    static const int bodyCounts[] = { 20, 200, 2000 };
+
+    static const struct
+    {
+        const char *name;
+        BroadphaseFn fn;
+    } broadphases[] =
+    {
+        { "bruteForce", broadphase_bruteForce },
+        { "grid", broadphase_grid },
+        { "tree", broadphase_tree },
+        { "sweepPrune", broadphase_sweepPrune },
+        { "world_step", broadphase_world },
+    };
+
+    printf("\n");
+    if (csvOutput)
+        printf("broadphase,bodies,pairs_last_frame,us_per_frame\n");
+    else
+        printf("%-22s %6s %8s %12s\n", "broadphase", "bodies", "pairs", "us/frame");
+
+    for (int n = 0; n < (int)(sizeof(bodyCounts) / sizeof(bodyCounts[0])); ++n)
+        for (int b = 0; b < (int)(sizeof(broadphases) / sizeof(broadphases[0])); ++b)
+            runBroadphase(broadphases[b].name, broadphases[b].fn, bodyCounts[n]);
+
+#if COLLISION_THREADS
+    ParallelPool *pool = parallel_newPool(0);
+    static const int pairBodyCounts[] = { 2000, 20000 };
+
+    printf("\n");
+    if (csvOutput)
+        printf("batch,bodies,threads,pairs,hits,us_per_call\n");
+    else
+        printf("%-22s %6s %7s %8s %8s %12s\n", "batch", "bodies", "threads", "pairs", "hits", "us/call");
+
+    for (int n = 0; n < (int)(sizeof(pairBodyCounts) / sizeof(pairBodyCounts[0])); ++n)
+    {
+        failed |= runParallel("circleCircle_pairs", pool, pairBodyCounts[n], 0);
+        failed |= runParallel("polyPoly_pairs", pool, pairBodyCounts[n], 1);
+    }
+    parallel_freePool(pool);
+#endif
+
+#if COLLISION_STATS
+    static char statsCSV[1024];
+    if (stats_writeCSV(statsCSV, sizeof(statsCSV)) >= 0)
+        printf("\n%s", statsCSV);
+#endif
+
+    return failed;
+}
@@ -0,0 +1,130 @@
+// Minimal stand-in for the Playdate SDK's pd_api.h, used by the host (Linux) build.
+// Only the parts of the API that the library actually touches are declared here.
+// Member names and signatures match the real SDK, so the sources in src/ compile
+// unchanged against either header.
+
+#ifndef PLAYDATEAPI_H
+#define PLAYDATEAPI_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+typedef void* lua_State;
+typedef int (*lua_CFunction)(lua_State* L);
+typedef struct LuaUDObject LuaUDObject;
+
+enum l_valtype { kInt, kFloat, kStr };
+
+typedef struct
+{
+	const char* name;
+	lua_CFunction func;
+} lua_reg;
+
+typedef struct
+{
+	const char* name;
+	enum l_valtype type;
+	union
+	{
+		unsigned int intval;
+		float floatval;
+		const char* strval;
+	} v;
+} lua_val;
+
+enum LuaType
+{
+	kTypeNil,
+	kTypeBool,
+	kTypeInt,
+	kTypeFloat,
+	kTypeString,
+	kTypeTable,
+	kTypeFunction,
+	kTypeThread,
+	kTypeObject
+};
+
+typedef enum
+{
+	kEventInit,
+	kEventInitLua,
+	kEventLock,
+	kEventUnlock,
+	kEventPause,
+	kEventResume,
+	kEventTerminate,
+	kEventKeyPressed,
+	kEventKeyReleased,
+	kEventLowPower
+} PDSystemEvent;
+
+struct playdate_sys
+{
+	void* (*realloc)(void* ptr, size_t size);
+	void (*logToConsole)(const char* fmt, ...);
+	void (*error)(const char* fmt, ...);
+	float (*getElapsedTime)(void);
+	void (*resetElapsedTime)(void);
+};
+
+typedef void SDFile;
+
+typedef enum
+{
+	kFileRead = (1<<0),
+	kFileReadData = (1<<1),
+	kFileWrite = (1<<2),
+	kFileAppend = (2<<2)
+} FileOptions;
+
+struct playdate_file
+{
+	const char* (*geterr)(void);
+	SDFile* (*open)(const char* name, FileOptions mode);
+	int (*close)(SDFile* file);
+	int (*read)(SDFile* file, void* buf, unsigned int len);
+	int (*write)(SDFile* file, const void* buf, unsigned int len);
+	int (*flush)(SDFile* file);
+};
+
+struct playdate_lua
+{
+	int (*registerClass)(const char* name, const lua_reg* reg, const lua_val* vals, int isstatic, const char** outErr);
+	int (*indexMetatable)(void);
+
+	int (*getArgCount)(void);
+	enum LuaType (*getArgType)(int pos, const char** outClass);
+	int (*argIsNil)(int pos);
+	int (*getArgBool)(int pos);
+	int (*getArgInt)(int pos);
+	float (*getArgFloat)(int pos);
+	const char* (*getArgString)(int pos);
+	const char* (*getArgBytes)(int pos, size_t* outlen);
+	void* (*getArgObject)(int pos, char* type, LuaUDObject** outud);
+
+	void (*pushNil)(void);
+	void (*pushBool)(int val);
+	void (*pushInt)(int val);
+	void (*pushFloat)(float val);
+	void (*pushString)(const char* str);
+	void (*pushBytes)(const char* str, size_t len);
+	LuaUDObject* (*pushObject)(void* obj, char* type, int nValues);
+	LuaUDObject* (*retainObject)(LuaUDObject* obj);
+	void (*releaseObject)(LuaUDObject* obj);
+};
+
+typedef struct PlaydateAPI
+{
+	const struct playdate_sys* system;
+	const struct playdate_file* file;
+	const struct playdate_lua* lua;
+} PlaydateAPI;
+
+// Host only: returns the stub API instance (see pd_stub.c)
+PlaydateAPI* pdstub_api(void);
+
+#endif // PLAYDATEAPI_H
@@ -0,0 +1,176 @@
+#include "pd_api.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+#include <errno.h>
+
+// --- SYSTEM ---
+
+static struct timespec startTime;
+
+static void* stub_realloc(void* ptr, size_t size)
+{
+    if (size == 0)
+    {
+        free(ptr);
+        return NULL;
+    }
+    return realloc(ptr, size);
+}
+
+static void stub_logToConsole(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    putchar('\n');
+}
+
+static void stub_error(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+    abort();
+}
+
+static float stub_getElapsedTime(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (float)(now.tv_sec - startTime.tv_sec) + (float)(now.tv_nsec - startTime.tv_nsec) * 1e-9f;
+}
+
+static void stub_resetElapsedTime(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+}
+
+// --- FILE ---
+// Paths are relative to the working directory instead of the game's data folder.
+
+static const char* stub_geterr(void)
+{
+    return strerror(errno);
+}
+
+static SDFile* stub_open(const char* name, FileOptions mode)
+{
+    const char *fileMode = "rb";
+    if (mode & kFileAppend)
+        fileMode = "ab";
+    else if (mode & kFileWrite)
+        fileMode = "wb";
+    return fopen(name, fileMode);
+}
+
+static int stub_close(SDFile* file)
+{
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+static int stub_read(SDFile* file, void* buf, unsigned int len)
+{
+    size_t count = fread(buf, 1, len, file);
+    return ferror((FILE *)file) ? -1 : (int)count;
+}
+
+static int stub_write(SDFile* file, const void* buf, unsigned int len)
+{
+    return fwrite(buf, 1, len, file) == len ? (int)len : -1;
+}
+
+static int stub_flush(SDFile* file)
+{
+    return fflush(file) == 0 ? 0 : -1;
+}
+
+// --- LUA ---
+// There is no Lua runtime on the host. Classes register successfully, but all
+// argument getters return empty values and pushes are discarded.
+
+static int stub_registerClass(const char* name, const lua_reg* reg, const lua_val* vals, int isstatic, const char** outErr)
+{
+    return 1;
+}
+
+static int stub_indexMetatable(void) { return 0; }
+static int stub_getArgCount(void) { return 0; }
+static enum LuaType stub_getArgType(int pos, const char** outClass) { return kTypeNil; }
+static int stub_argIsNil(int pos) { return 1; }
+static int stub_getArgBool(int pos) { return 0; }
+static int stub_getArgInt(int pos) { return 0; }
+static float stub_getArgFloat(int pos) { return 0.0f; }
+static const char* stub_getArgString(int pos) { return ""; }
+static const char* stub_getArgBytes(int pos, size_t* outlen) { *outlen = 0; return NULL; }
+static void* stub_getArgObject(int pos, char* type, LuaUDObject** outud) { return NULL; }
+
+static void stub_pushNil(void) {}
+static void stub_pushBool(int val) {}
+static void stub_pushInt(int val) {}
+static void stub_pushFloat(float val) {}
+static void stub_pushString(const char* str) {}
+static void stub_pushBytes(const char* str, size_t len) {}
+static LuaUDObject* stub_pushObject(void* obj, char* type, int nValues) { return NULL; }
+static LuaUDObject* stub_retainObject(LuaUDObject* obj) { return obj; }
+static void stub_releaseObject(LuaUDObject* obj) {}
+
+static const struct playdate_sys stubSystem =
+{
+    .realloc = stub_realloc,
+    .logToConsole = stub_logToConsole,
+    .error = stub_error,
+    .getElapsedTime = stub_getElapsedTime,
+    .resetElapsedTime = stub_resetElapsedTime,
+};
+
+static const struct playdate_file stubFile =
+{
+    .geterr = stub_geterr,
+    .open = stub_open,
+    .close = stub_close,
+    .read = stub_read,
+    .write = stub_write,
+    .flush = stub_flush,
+};
+
+static const struct playdate_lua stubLua =
+{
+    .registerClass = stub_registerClass,
+    .indexMetatable = stub_indexMetatable,
+    .getArgCount = stub_getArgCount,
+    .getArgType = stub_getArgType,
+    .argIsNil = stub_argIsNil,
+    .getArgBool = stub_getArgBool,
+    .getArgInt = stub_getArgInt,
+    .getArgFloat = stub_getArgFloat,
+    .getArgString = stub_getArgString,
+    .getArgBytes = stub_getArgBytes,
+    .getArgObject = stub_getArgObject,
+    .pushNil = stub_pushNil,
+    .pushBool = stub_pushBool,
+    .pushInt = stub_pushInt,
+    .pushFloat = stub_pushFloat,
+    .pushString = stub_pushString,
+    .pushBytes = stub_pushBytes,
+    .pushObject = stub_pushObject,
+    .retainObject = stub_retainObject,
+    .releaseObject = stub_releaseObject,
+};
+
+static PlaydateAPI stubApi =
+{
+    .system = &stubSystem,
+    .file = &stubFile,
+    .lua = &stubLua,
+};
+
+PlaydateAPI* pdstub_api(void)
+{
+    if (startTime.tv_sec == 0 && startTime.tv_nsec == 0)
+        stub_resetElapsedTime();
+    return &stubApi;
+}
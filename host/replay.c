@@ -0,0 +1,692 @@
+// Replays a query trace recorded on the device or in the simulator with
+// collision.trace.start(path) (see src/trace.h).
+//
+// Every recorded query is run again through the C collision functions of this build.
+// The result has to match the recorded one (same hit, values within a small tolerance,
+// since cached bounds of moved polygons are recomputed here instead of moved along).
+// Batch calls are replayed as a whole and have to return the same list of results.
+// Then the queries are timed per kind, so a real scene can be profiled and optimized on
+// the desktop. Returns 1 if any result differs, 2 if the trace cannot be read.
+//
+// Usage: collision_replay <trace> [--csv] [--quick]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pd_api.h"
+#include "vector2d.h"
+#include "polygon.h"
+#include "collision.h"
+#include "trace.h"
+
+#define MAX_VALUES 16
+#define TOLERANCE 1e-4f
+#define MAX_REPORTED 10
+
+// Input items of a query: c circle, v vector, f float, b box, k capsule, p polygon.
+// Outputs: r resolve (dir, depth), h sweep / ray hit (t, normal, point), m manifold.
+static const struct
+{
+    const char *name;
+    const char *inputs;
+    char output;
+} opFormats[TRACE_OP_COUNT] =
+{
+    [TRACE_CIRCLE_CIRCLE] = { "circleCircle", "cc", 'r' },
+    [TRACE_CIRCLE_POLY] = { "circlePoly", "cp", 'r' },
+    [TRACE_POLY_POLY] = { "polyPoly", "pp", 'r' },
+    [TRACE_POLY_POLY_MANIFOLD] = { "polyPoly_manifold", "pp", 'm' },
+    [TRACE_CIRCLE_POLY_SWEPT] = { "circlePoly_swept", "cvp", 'h' },
+    [TRACE_POLY_POLY_SWEPT] = { "polyPoly_swept", "pvp", 'h' },
+    [TRACE_AABB_AABB] = { "aabbAABB", "bb", 'r' },
+    [TRACE_AABB_CIRCLE] = { "aabbCircle", "bc", 'r' },
+    [TRACE_CAPSULE_CIRCLE] = { "capsuleCircle", "kc", 'r' },
+    [TRACE_CAPSULE_CAPSULE] = { "capsuleCapsule", "kk", 'r' },
+    [TRACE_SEGMENT_POLY] = { "segmentPoly", "vvp", 'r' },
+    [TRACE_RAY_CIRCLE] = { "rayCircle", "vvfc", 'h' },
+    [TRACE_RAY_POLY] = { "rayPoly", "vvfp", 'h' },
+    // inputs and results of the batch calls are read by readBatch
+    [TRACE_BATCH_CIRCLE_CIRCLE] = { "batch_circleCircle", "", 'B' },
+    [TRACE_BATCH_CIRCLE_POLY] = { "batch_circlePoly", "", 'B' },
+    [TRACE_BATCH_POLY_POLY] = { "batch_polyPoly", "", 'B' },
+};
+
+// Inputs and recorded results of a batch call, replayed holds the results of runQuery
+typedef struct
+{
+    float *x;
+    float *y;
+    float *r;
+    int circleCount;
+    Polygon **polys;
+    int polyCount;
+    CollisionPair *pairs;
+    int pairCount;
+
+    CollisionResult *results;
+    int resultCount;
+    CollisionResult *replayed;
+} Batch;
+
+typedef struct
+{
+    TraceOp op;
+    int flags;
+    // floats of all non-polygon inputs in order
+    float in[MAX_VALUES];
+    Polygon *polys[2];
+    int polyCount;
+    // batch records only, hit is the number of results then
+    Batch *batch;
+
+    int hit;
+    float out[MAX_VALUES];
+    int outCount;
+} Query;
+
+typedef struct
+{
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+    int error;
+} Reader;
+
+static int csvOutput = 0;
+static double minSeconds = 0.2;
+static volatile int sink = 0;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// --- READING ---
+
+static void readBytes(Reader *r, void *target, size_t size)
+{
+    if (r->error || r->pos + size > r->size)
+    {
+        r->error = 1;
+        memset(target, 0, size);
+        return;
+    }
+    memcpy(target, r->data + r->pos, size);
+    r->pos += size;
+}
+
+static int readU8(Reader *r)
+{
+    uint8_t v;
+    readBytes(r, &v, 1);
+    return v;
+}
+
+static float readFloat(Reader *r)
+{
+    float v;
+    readBytes(r, &v, sizeof(float));
+    return v;
+}
+
+// Element counts of batch records, limited by the bytes left so a broken file cannot
+// make us allocate gigabytes
+static int readCount(Reader *r, size_t minBytes)
+{
+    uint32_t count;
+    readBytes(r, &count, sizeof(count));
+    if (r->error || (size_t)count * minBytes > r->size - r->pos)
+    {
+        r->error = 1;
+        return 0;
+    }
+    return (int)count;
+}
+
+// Builds the polygon the way the Lua hooks see it: convexity and parts, normals if they
+// were cached, the transform and the cached world space data
+static Polygon *readPoly(Reader *r)
+{
+    uint16_t count;
+    readBytes(r, &count, sizeof(count));
+    int flags = readU8(r);
+    Vector2D position = { 0, 0 };
+    float rotation = 0;
+    if (flags & TRACE_POLY_TRANSFORMED)
+    {
+        position.x = readFloat(r);
+        position.y = readFloat(r);
+        rotation = readFloat(r);
+    }
+    if (r->error || count == 0)
+    {
+        r->error = 1;
+        return NULL;
+    }
+
+    Polygon *p = polygon_new(count);
+    readBytes(r, p->verts, sizeof(Vector2D) * count);
+    polygon_updateConvex(p);
+    if (flags & TRACE_POLY_NORMALS)
+        polygon_cacheNormals(p);
+    if (flags & TRACE_POLY_TRANSFORMED)
+        polygon_setTransform(p, position, rotation);
+    polygon_updateCache(p);
+    return p;
+}
+
+static float *readFloats(Reader *r, int count)
+{
+    float *values = malloc(sizeof(float) * (count > 0 ? count : 1));
+    readBytes(r, values, sizeof(float) * count);
+    return values;
+}
+
+static CollisionPair *readPairs(Reader *r, int *count)
+{
+    *count = readCount(r, 8);
+    CollisionPair *pairs = malloc(sizeof(CollisionPair) * (*count > 0 ? *count : 1));
+    for (int i = 0; i < *count; ++i)
+    {
+        uint32_t ab[2];
+        readBytes(r, ab, sizeof(ab));
+        pairs[i].a = (int)ab[0];
+        pairs[i].b = (int)ab[1];
+    }
+    return pairs;
+}
+
+static Batch *readBatch(Reader *r, TraceOp op, int flags)
+{
+    Batch *batch = calloc(1, sizeof(Batch));
+    if (op != TRACE_BATCH_POLY_POLY)
+    {
+        batch->circleCount = readCount(r, 12);
+        batch->x = readFloats(r, batch->circleCount);
+        batch->y = readFloats(r, batch->circleCount);
+        batch->r = readFloats(r, batch->circleCount);
+    }
+    if (op != TRACE_BATCH_CIRCLE_CIRCLE)
+    {
+        int count = readCount(r, 3);
+        batch->polys = calloc(count > 0 ? count : 1, sizeof(Polygon *));
+        for (int i = 0; i < count && !r->error; ++i)
+            batch->polys[batch->polyCount++] = readPoly(r);
+    }
+    if (flags & TRACE_FLAG_PAIRS)
+        batch->pairs = readPairs(r, &batch->pairCount);
+
+    batch->resultCount = readCount(r, 20);
+    batch->results = malloc(sizeof(CollisionResult) * (batch->resultCount > 0 ? batch->resultCount : 1));
+    batch->replayed = malloc(sizeof(CollisionResult) * (batch->resultCount > 0 ? batch->resultCount : 1));
+    for (int i = 0; i < batch->resultCount; ++i)
+    {
+        uint32_t ab[2];
+        readBytes(r, ab, sizeof(ab));
+        batch->results[i].a = (int)ab[0];
+        batch->results[i].b = (int)ab[1];
+        batch->results[i].resolveDir.x = readFloat(r);
+        batch->results[i].resolveDir.y = readFloat(r);
+        batch->results[i].depth = readFloat(r);
+    }
+    return batch;
+}
+
+static int readQuery(Reader *r, Query *q)
+{
+    memset(q, 0, sizeof(Query));
+    q->op = (TraceOp)readU8(r);
+    q->flags = readU8(r);
+    if (r->error || q->op <= 0 || q->op >= TRACE_OP_COUNT)
+        return 0;
+
+    if (opFormats[q->op].output == 'B')
+    {
+        q->batch = readBatch(r, q->op, q->flags);
+        q->hit = q->batch->resultCount;
+        return !r->error;
+    }
+
+    static const int itemFloats[128] = { ['c'] = 3, ['v'] = 2, ['f'] = 1, ['b'] = 4, ['k'] = 5 };
+    int inCount = 0;
+    for (const char *item = opFormats[q->op].inputs; *item != '\0'; ++item)
+    {
+        if (*item == 'p')
+        {
+            q->polys[q->polyCount++] = readPoly(r);
+            continue;
+        }
+        for (int i = 0; i < itemFloats[(int)*item]; ++i)
+            q->in[inCount++] = readFloat(r);
+    }
+
+    q->hit = readU8(r);
+    if (q->hit)
+    {
+        char output = opFormats[q->op].output;
+        if (output == 'r' && !(q->flags & TRACE_FLAG_CHECK))
+            q->outCount = 3;
+        else if (output == 'h')
+            q->outCount = 5;
+        else if (output == 'm')
+            q->outCount = 3;
+
+        for (int i = 0; i < q->outCount; ++i)
+            q->out[i] = readFloat(r);
+
+        if (output == 'm')
+        {
+            int points = readU8(r);
+            q->out[q->outCount++] = (float)points;
+            for (int i = 0; i < points * 3 && q->outCount < MAX_VALUES; ++i)
+                q->out[q->outCount++] = readFloat(r);
+        }
+    }
+    return !r->error;
+}
+
+static void freeQuery(Query *q)
+{
+    for (int i = 0; i < q->polyCount; ++i)
+    {
+        if (q->polys[i] != NULL)
+            polygon_free(q->polys[i]);
+    }
+
+    Batch *batch = q->batch;
+    if (batch == NULL)
+        return;
+    for (int i = 0; i < batch->polyCount; ++i)
+    {
+        if (batch->polys[i] != NULL)
+            polygon_free(batch->polys[i]);
+    }
+    free(batch->x);
+    free(batch->y);
+    free(batch->r);
+    free(batch->polys);
+    free(batch->pairs);
+    free(batch->results);
+    free(batch->replayed);
+    free(batch);
+}
+
+// --- RUNNING ---
+
+static inline Vector2D vec(const float *v)
+{
+    Vector2D result = { .x = v[0], .y = v[1] };
+    return result;
+}
+
+static inline AABB box(const float *v)
+{
+    AABB result = { .minX = v[0], .minY = v[1], .maxX = v[2], .maxY = v[3] };
+    return result;
+}
+
+static inline Capsule capsule(const float *v)
+{
+    Capsule result = { .a = vec(v), .b = vec(v + 2), .radius = v[4] };
+    return result;
+}
+
+// Runs a batch call into batch->replayed, returns the number of results (which may be more
+// than were recorded, only those fit)
+static int runBatch(const Query *q)
+{
+    const Batch *batch = q->batch;
+    CollisionMethod method = (q->flags & TRACE_FLAG_GJK) ? COLLISION_GJK : COLLISION_SAT;
+    switch (q->op)
+    {
+        case TRACE_BATCH_CIRCLE_CIRCLE:
+            if (batch->pairs != NULL)
+                return collision_circleCircle_batchPairs(batch->replayed, batch->resultCount,
+                        batch->x, batch->y, batch->r, batch->pairs, batch->pairCount);
+            return collision_circleCircle_batch(batch->replayed, batch->resultCount,
+                    batch->x, batch->y, batch->r, batch->circleCount);
+
+        case TRACE_BATCH_CIRCLE_POLY:
+            return collision_circlePoly_batch(batch->replayed, batch->resultCount,
+                    batch->x, batch->y, batch->r, batch->circleCount, batch->polys, batch->polyCount, method);
+
+        case TRACE_BATCH_POLY_POLY:
+            if (batch->pairs != NULL)
+                return collision_polyPoly_batchPairs(batch->replayed, batch->resultCount,
+                        batch->polys, batch->pairs, batch->pairCount, method);
+            return collision_polyPoly_batch(batch->replayed, batch->resultCount, batch->polys, batch->polyCount, method);
+
+        default:
+            return 0;
+    }
+}
+
+static void hitOut(float *out, int *outCount, float t, Vector2D normal, Vector2D point)
+{
+    out[0] = t;
+    out[1] = normal.x;
+    out[2] = normal.y;
+    out[3] = point.x;
+    out[4] = point.y;
+    *outCount = 5;
+}
+
+// Runs the query through the same C function as the Lua hook, writes the outputs in trace order
+static int runQuery(const Query *q, float *out, int *outCount)
+{
+    const float *in = q->in;
+    int check = q->flags & TRACE_FLAG_CHECK;
+    int gjk = q->flags & TRACE_FLAG_GJK;
+    Vector2D dir = { 0, 0 };
+    float depth = 0;
+    int hit = 0;
+    *outCount = 0;
+
+    if (q->batch != NULL)
+        return runBatch(q);
+
+    switch (q->op)
+    {
+        case TRACE_CIRCLE_CIRCLE:
+            if (check)
+                return collision_circleCircle_check(vec(in), in[2], vec(in + 3), in[5]);
+            hit = collision_circleCircle(&dir, &depth, vec(in), in[2], vec(in + 3), in[5]);
+            break;
+
+        case TRACE_CIRCLE_POLY:
+            if (check)
+                return gjk ? collision_circlePoly_gjk_check(vec(in), in[2], *q->polys[0])
+                        : collision_circlePoly_check(vec(in), in[2], *q->polys[0]);
+            hit = gjk ? collision_circlePoly_gjk(&dir, &depth, vec(in), in[2], *q->polys[0])
+                    : collision_circlePoly(&dir, &depth, vec(in), in[2], *q->polys[0]);
+            break;
+
+        case TRACE_POLY_POLY:
+            if (check)
+                return gjk ? collision_polyPoly_gjk_check(*q->polys[0], *q->polys[1])
+                        : collision_polyPoly_check(*q->polys[0], *q->polys[1]);
+            hit = gjk ? collision_polyPoly_gjk(&dir, &depth, *q->polys[0], *q->polys[1])
+                    : collision_polyPoly(&dir, &depth, *q->polys[0], *q->polys[1]);
+            break;
+
+        case TRACE_POLY_POLY_MANIFOLD:
+        {
+            ContactManifold manifold;
+            if (!collision_polyPoly_manifold(&manifold, *q->polys[0], *q->polys[1]))
+                return 0;
+            out[(*outCount)++] = manifold.normal.x;
+            out[(*outCount)++] = manifold.normal.y;
+            out[(*outCount)++] = manifold.depth;
+            out[(*outCount)++] = (float)manifold.pointCount;
+            for (int i = 0; i < manifold.pointCount; ++i)
+            {
+                out[(*outCount)++] = manifold.points[i].x;
+                out[(*outCount)++] = manifold.points[i].y;
+                out[(*outCount)++] = manifold.depths[i];
+            }
+            return 1;
+        }
+
+        case TRACE_CIRCLE_POLY_SWEPT:
+        case TRACE_POLY_POLY_SWEPT:
+        {
+            SweepResult result;
+            if (q->op == TRACE_CIRCLE_POLY_SWEPT)
+                hit = collision_circlePoly_swept(&result, vec(in), in[2], vec(in + 3), *q->polys[0]);
+            else
+                hit = collision_polyPoly_swept(&result, *q->polys[0], vec(in), *q->polys[1]);
+            if (hit)
+                hitOut(out, outCount, result.toi, result.normal, result.point);
+            return hit;
+        }
+
+        case TRACE_AABB_AABB:
+            hit = collision_aabbAABB(&dir, &depth, box(in), box(in + 4));
+            break;
+
+        case TRACE_AABB_CIRCLE:
+            hit = collision_aabbCircle(&dir, &depth, box(in), vec(in + 4), in[6]);
+            break;
+
+        case TRACE_CAPSULE_CIRCLE:
+            hit = collision_capsuleCircle(&dir, &depth, capsule(in), vec(in + 5), in[7]);
+            break;
+
+        case TRACE_CAPSULE_CAPSULE:
+            hit = collision_capsuleCapsule(&dir, &depth, capsule(in), capsule(in + 5));
+            break;
+
+        case TRACE_SEGMENT_POLY:
+        {
+            Segment segment = { .a = vec(in), .b = vec(in + 2) };
+            hit = collision_segmentPoly(&dir, &depth, segment, *q->polys[0]);
+            break;
+        }
+
+        case TRACE_RAY_CIRCLE:
+        case TRACE_RAY_POLY:
+        {
+            RayHit rayHit;
+            if (q->op == TRACE_RAY_CIRCLE)
+                hit = collision_rayCircle(&rayHit, vec(in), vec(in + 2), in[4], vec(in + 5), in[7]);
+            else
+                hit = collision_rayPoly(&rayHit, vec(in), vec(in + 2), in[4], *q->polys[0]);
+            if (hit)
+                hitOut(out, outCount, rayHit.t, rayHit.normal, rayHit.point);
+            return hit;
+        }
+
+        default:
+            return 0;
+    }
+
+    // resolve direction and depth
+    if (hit)
+    {
+        out[0] = dir.x;
+        out[1] = dir.y;
+        out[2] = depth;
+        *outCount = 3;
+    }
+    return hit;
+}
+
+static inline int nearlyEqual(float value, float recorded)
+{
+    return fabsf(value - recorded) <= TOLERANCE * fmaxf(1.0f, fabsf(recorded));
+}
+
+static int matches(const Query *q, int hit, const float *out, int outCount)
+{
+    if (hit != q->hit || outCount != q->outCount)
+        return 0;
+    for (int i = 0; i < outCount; ++i)
+    {
+        if (!nearlyEqual(out[i], q->out[i]))
+            return 0;
+    }
+    if (q->batch == NULL)
+        return 1;
+
+    for (int i = 0; i < hit; ++i)
+    {
+        const CollisionResult *a = &q->batch->replayed[i];
+        const CollisionResult *b = &q->batch->results[i];
+        if (a->a != b->a || a->b != b->b || !nearlyEqual(a->resolveDir.x, b->resolveDir.x) ||
+                !nearlyEqual(a->resolveDir.y, b->resolveDir.y) || !nearlyEqual(a->depth, b->depth))
+            return 0;
+    }
+    return 1;
+}
+
+static void reportMismatch(int index, const Query *q, int hit, const float *out, int outCount)
+{
+    fprintf(stderr, "query %d (%s, flags %d): recorded hit %d", index, opFormats[q->op].name, q->flags, q->hit);
+    for (int i = 0; i < q->outCount; ++i)
+        fprintf(stderr, " %g", q->out[i]);
+    fprintf(stderr, ", replayed hit %d", hit);
+    for (int i = 0; i < outCount; ++i)
+        fprintf(stderr, " %g", out[i]);
+    fprintf(stderr, "\n");
+}
+
+// Runs all queries of one kind repeatedly for at least minSeconds, returns ns per query
+static double timeQueries(Query *const *queries, int count)
+{
+    float out[MAX_VALUES];
+    int outCount;
+    long long runs = 0;
+    double start = now();
+    double elapsed;
+    do
+    {
+        for (int i = 0; i < count; ++i)
+            sink += runQuery(queries[i], out, &outCount);
+        runs += count;
+        elapsed = now() - start;
+    } while (elapsed < minSeconds);
+
+    return elapsed * 1e9 / (double)runs;
+}
+
+// --- MAIN ---
+
+static uint8_t *loadFile(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = length > 0 ? malloc((size_t)length) : NULL;
+    if (data != NULL && fread(data, 1, (size_t)length, file) != (size_t)length)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = (size_t)length;
+    return data;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    int usage = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--csv") == 0)
+            csvOutput = 1;
+        else if (strcmp(argv[i], "--quick") == 0)
+            minSeconds = 0.01;
+        else if (path == NULL && argv[i][0] != '-')
+            path = argv[i];
+        else
+            usage = 1;
+    }
+    if (path == NULL || usage)
+    {
+        fprintf(stderr, "Usage: %s <trace> [--csv] [--quick]\n", argv[0]);
+        return 2;
+    }
+
+    PlaydateAPI *pd = pdstub_api();
+    registerCollision(pd);
+    registerVector2D(pd);
+    registerPoly(pd);
+
+    size_t size = 0;
+    uint8_t *data = loadFile(path, &size);
+    Reader reader = { .data = data, .size = size, .pos = 0, .error = 0 };
+    char magic[8];
+    uint32_t version = 0;
+    readBytes(&reader, magic, sizeof(magic));
+    readBytes(&reader, &version, sizeof(version));
+    if (data == NULL || reader.error || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 || version < 1 || version > TRACE_VERSION)
+    {
+        fprintf(stderr, "%s is not a version 1 to %d collision trace\n", path, TRACE_VERSION);
+        free(data);
+        return 2;
+    }
+
+    Query *queries = NULL;
+    int count = 0;
+    int capacity = 0;
+    while (reader.pos < reader.size)
+    {
+        if (count == capacity)
+        {
+            capacity = capacity > 0 ? capacity * 2 : 1024;
+            queries = realloc(queries, sizeof(Query) * capacity);
+        }
+        if (!readQuery(&reader, &queries[count]))
+        {
+            fprintf(stderr, "%s: broken record at byte %zu, replaying the %d queries before\n", path, reader.pos, count);
+            freeQuery(&queries[count]);
+            break;
+        }
+        ++count;
+    }
+    free(data);
+
+    // check results
+    int mismatches[TRACE_OP_COUNT] = { 0 };
+    int opCounts[TRACE_OP_COUNT] = { 0 };
+    int totalMismatches = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        float out[MAX_VALUES];
+        int outCount;
+        int hit = runQuery(&queries[i], out, &outCount);
+        ++opCounts[queries[i].op];
+        if (!matches(&queries[i], hit, out, outCount))
+        {
+            if (totalMismatches < MAX_REPORTED)
+                reportMismatch(i, &queries[i], hit, out, outCount);
+            ++mismatches[queries[i].op];
+            ++totalMismatches;
+        }
+    }
+
+    // time per kind
+    Query **byOp = malloc(sizeof(Query *) * (count > 0 ? count : 1));
+    if (csvOutput)
+        printf("query,count,mismatches,ns_per_query\n");
+    else
+        printf("%-20s %8s %10s %12s\n", "query", "count", "mismatches", "ns/query");
+
+    double totalNs = 0;
+    for (int op = 1; op < TRACE_OP_COUNT; ++op)
+    {
+        if (opCounts[op] == 0)
+            continue;
+
+        int n = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            if (queries[i].op == (TraceOp)op)
+                byOp[n++] = &queries[i];
+        }
+        double ns = timeQueries(byOp, n);
+        totalNs += ns * n;
+        if (csvOutput)
+            printf("%s,%d,%d,%.1f\n", opFormats[op].name, n, mismatches[op], ns);
+        else
+            printf("%-20s %8d %10d %12.1f\n", opFormats[op].name, n, mismatches[op], ns);
+    }
+    if (!csvOutput)
+        printf("%d queries, %d mismatches, %.1f us for one pass\n", count, totalMismatches, totalNs * 1e-3);
+
+    for (int i = 0; i < count; ++i)
+        freeQuery(&queries[i]);
+    free(queries);
+    free(byOp);
+
+    return totalMismatches > 0 ? 1 : 0;
+}
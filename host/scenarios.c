@@ -0,0 +1,67 @@
+// Host runner for the scenario benchmark suite in src/scenario.c
+//
+// Prints one CSV line per scenario and body count. With --baseline, every scenario that
+// got slower than the baseline file by more than the threshold (frame, broadphase or
+// narrowphase time) is reported and the run fails, so it can gate changes:
+//
+//   collision_scenarios --output baseline.csv           (on the reference build)
+//   collision_scenarios --baseline baseline.csv          (on the changed build)
+//
+// Exit code 1 on a regression, 2 if the baseline could not be read.
+//
+// Usage: collision_scenarios [--quick] [--baseline file] [--threshold percent] [--output file]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pd_api.h"
+#include "vector2d.h"
+#include "polygon.h"
+#include "collision.h"
+#include "spatialgrid.h"
+#include "world.h"
+#include "scenario.h"
+
+int main(int argc, char **argv)
+{
+    const char *baselinePath = NULL;
+    const char *outputPath = NULL;
+    float threshold = SCENARIO_DEFAULT_THRESHOLD;
+    int frames = SCENARIO_DEFAULT_FRAMES;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+            frames = 10;
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+            baselinePath = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+            threshold = strtof(argv[++i], NULL);
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            outputPath = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [--quick] [--baseline file] [--threshold percent] [--output file]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    PlaydateAPI *pd = pdstub_api();
+    registerCollision(pd);
+    registerVector2D(pd);
+    registerPoly(pd);
+    registerSpatialGrid(pd);
+    registerWorld(pd);
+    registerScenario(pd);
+
+    int regressions = scenario_runSuite(baselinePath, threshold, outputPath, frames);
+    if (regressions < 0)
+        return 2;
+    if (regressions > 0)
+    {
+        fprintf(stderr, "%d scenario(s) slower than the baseline by more than %.1f%%\n", regressions, threshold);
+        return 1;
+    }
+    return 0;
+}
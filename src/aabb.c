@@ -0,0 +1,83 @@
+#include "aabb.h"
+
+void aabb_fromCircle(AABB *target, Vector2D center, float radius)
+{
+    target->minX = center.x - radius;
+    target->minY = center.y - radius;
+    target->maxX = center.x + radius;
+    target->maxY = center.y + radius;
+}
+
+void aabb_fromCapsule(AABB *target, Vector2D a, Vector2D b, float radius)
+{
+    target->minX = fminf(a.x, b.x) - radius;
+    target->minY = fminf(a.y, b.y) - radius;
+    target->maxX = fmaxf(a.x, b.x) + radius;
+    target->maxY = fmaxf(a.y, b.y) + radius;
+}
+
+void aabb_merge(AABB *target, AABB a, AABB b)
+{
+    target->minX = fminf(a.minX, b.minX);
+    target->minY = fminf(a.minY, b.minY);
+    target->maxX = fmaxf(a.maxX, b.maxX);
+    target->maxY = fmaxf(a.maxY, b.maxY);
+}
+
+void aabb_fatten(AABB *target, float margin)
+{
+    target->minX -= margin;
+    target->minY -= margin;
+    target->maxX += margin;
+    target->maxY += margin;
+}
+
+// touching boxes count as overlapping, so the broadphase never drops a pair
+// the narrowphase might still consider colliding
+int aabb_overlaps(AABB a, AABB b)
+{
+    return a.minX <= b.maxX && b.minX <= a.maxX && a.minY <= b.maxY && b.minY <= a.maxY;
+}
+
+int aabb_contains(AABB outer, AABB inner)
+{
+    return outer.minX <= inner.minX && outer.minY <= inner.minY
+        && outer.maxX >= inner.maxX && outer.maxY >= inner.maxY;
+}
+
+float aabb_perimeter(AABB a)
+{
+    return 2.0f * ((a.maxX - a.minX) + (a.maxY - a.minY));
+}
+
+// narrows [tMin, tMax] to the part of the ray between min and max on one axis
+static int clipSlab(float *tMin, float *tMax, float min, float max, float origin, float dir)
+{
+    if (dir == 0)
+        return origin >= min && origin <= max;
+
+    float inv = 1.0f / dir;
+    float t1 = (min - origin) * inv;
+    float t2 = (max - origin) * inv;
+    if (t1 > t2)
+    {
+        float temp = t1;
+        t1 = t2;
+        t2 = temp;
+    }
+    *tMin = fmaxf(*tMin, t1);
+    *tMax = fminf(*tMax, t2);
+    return *tMin <= *tMax;
+}
+
+int aabb_raycast(float *tEnter, AABB box, Vector2D origin, Vector2D dir, float maxT)
+{
+    float tMin = 0;
+    float tMax = maxT;
+    if (!clipSlab(&tMin, &tMax, box.minX, box.maxX, origin.x, dir.x)
+            || !clipSlab(&tMin, &tMax, box.minY, box.maxY, origin.y, dir.y))
+        return 0;
+
+    *tEnter = tMin;
+    return 1;
+}
@@ -0,0 +1,28 @@
+#ifndef _AABB_H
+#define _AABB_H
+
+#include "vector2d.h"
+
+// Axis-aligned bounding box, used by the broadphase structures
+typedef struct
+{
+    float minX;
+    float minY;
+    float maxX;
+    float maxY;
+} AABB;
+
+void aabb_fromCircle(AABB *target, Vector2D center, float radius);
+// Bounds of a capsule, radius 0 for a segment
+void aabb_fromCapsule(AABB *target, Vector2D a, Vector2D b, float radius);
+void aabb_merge(AABB *target, AABB a, AABB b);
+void aabb_fatten(AABB *target, float margin);
+
+int aabb_overlaps(AABB a, AABB b);
+int aabb_contains(AABB outer, AABB inner);
+float aabb_perimeter(AABB a);
+// Tests the ray origin + dir * t (0 <= t <= maxT) against the box (slab test).
+// Returns 1 on a hit and writes the entry t (0 if origin is inside) to tEnter.
+int aabb_raycast(float *tEnter, AABB box, Vector2D origin, Vector2D dir, float maxT);
+
+#endif // _AABB_H
@@ -0,0 +1,796 @@
+#include "aabbtree.h"
+#include "polygon.h"
+#include "stats.h"
+#include "util.h"
+
+static PlaydateAPI* pd = NULL;
+
+// -- HELPER ---
+
+static inline int isLeaf(const TreeNode *node)
+{
+    return node->child1 == TREE_NULL_NODE;
+}
+
+static inline int maxInt(int a, int b)
+{
+    return a > b ? a : b;
+}
+
+static int allocateNode(AABBTree *tree)
+{
+    int id;
+    if (tree->freeList != TREE_NULL_NODE)
+    {
+        id = tree->freeList;
+        tree->freeList = tree->nodes[id].parent;
+    }
+    else
+    {
+        tree->nodes = ensureCapacity(pd->system->realloc, tree->nodes, &tree->nodeCapacity, tree->nodeCount + 1, sizeof(TreeNode));
+        id = tree->nodeCount++;
+    }
+
+    TreeNode *node = &tree->nodes[id];
+    node->parent = TREE_NULL_NODE;
+    node->child1 = TREE_NULL_NODE;
+    node->child2 = TREE_NULL_NODE;
+    node->height = 0;
+    node->proxy = TREE_NULL_NODE;
+    return id;
+}
+
+static void freeNode(AABBTree *tree, int id)
+{
+    tree->nodes[id].parent = tree->freeList;
+    tree->nodes[id].height = -1;
+    tree->freeList = id;
+}
+
+static void pushStack(AABBTree *tree, int *top, int value)
+{
+    tree->stack = ensureCapacity(pd->system->realloc, tree->stack, &tree->stackCapacity, *top + 1, sizeof(int));
+    tree->stack[(*top)++] = value;
+}
+
+// Performs a left or right rotation if node A is imbalanced. Returns the new root of the subtree.
+static int balance(AABBTree *tree, int iA)
+{
+    TreeNode *A = &tree->nodes[iA];
+    if (isLeaf(A) || A->height < 2)
+        return iA;
+
+    int iB = A->child1;
+    int iC = A->child2;
+    TreeNode *B = &tree->nodes[iB];
+    TreeNode *C = &tree->nodes[iC];
+
+    int heightDiff = C->height - B->height;
+
+    // rotate C up
+    if (heightDiff > 1)
+    {
+        int iF = C->child1;
+        int iG = C->child2;
+        TreeNode *F = &tree->nodes[iF];
+        TreeNode *G = &tree->nodes[iG];
+
+        C->child1 = iA;
+        C->parent = A->parent;
+        A->parent = iC;
+
+        if (C->parent == TREE_NULL_NODE)
+            tree->root = iC;
+        else if (tree->nodes[C->parent].child1 == iA)
+            tree->nodes[C->parent].child1 = iC;
+        else
+            tree->nodes[C->parent].child2 = iC;
+
+        if (F->height > G->height)
+        {
+            C->child2 = iF;
+            A->child2 = iG;
+            G->parent = iA;
+            aabb_merge(&A->bounds, B->bounds, G->bounds);
+            aabb_merge(&C->bounds, A->bounds, F->bounds);
+            A->height = 1 + maxInt(B->height, G->height);
+            C->height = 1 + maxInt(A->height, F->height);
+        }
+        else
+        {
+            C->child2 = iG;
+            A->child2 = iF;
+            F->parent = iA;
+            aabb_merge(&A->bounds, B->bounds, F->bounds);
+            aabb_merge(&C->bounds, A->bounds, G->bounds);
+            A->height = 1 + maxInt(B->height, F->height);
+            C->height = 1 + maxInt(A->height, G->height);
+        }
+        return iC;
+    }
+
+    // rotate B up
+    if (heightDiff < -1)
+    {
+        int iD = B->child1;
+        int iE = B->child2;
+        TreeNode *D = &tree->nodes[iD];
+        TreeNode *E = &tree->nodes[iE];
+
+        B->child1 = iA;
+        B->parent = A->parent;
+        A->parent = iB;
+
+        if (B->parent == TREE_NULL_NODE)
+            tree->root = iB;
+        else if (tree->nodes[B->parent].child1 == iA)
+            tree->nodes[B->parent].child1 = iB;
+        else
+            tree->nodes[B->parent].child2 = iB;
+
+        if (D->height > E->height)
+        {
+            B->child2 = iD;
+            A->child1 = iE;
+            E->parent = iA;
+            aabb_merge(&A->bounds, C->bounds, E->bounds);
+            aabb_merge(&B->bounds, A->bounds, D->bounds);
+            A->height = 1 + maxInt(C->height, E->height);
+            B->height = 1 + maxInt(A->height, D->height);
+        }
+        else
+        {
+            B->child2 = iE;
+            A->child1 = iD;
+            D->parent = iA;
+            aabb_merge(&A->bounds, C->bounds, D->bounds);
+            aabb_merge(&B->bounds, A->bounds, E->bounds);
+            A->height = 1 + maxInt(C->height, D->height);
+            B->height = 1 + maxInt(A->height, E->height);
+        }
+        return iB;
+    }
+
+    return iA;
+}
+
+// Walks from index up to the root, refitting bounds and rebalancing on the way
+static void refitUpwards(AABBTree *tree, int index)
+{
+    while (index != TREE_NULL_NODE)
+    {
+        index = balance(tree, index);
+
+        TreeNode *node = &tree->nodes[index];
+        TreeNode *child1 = &tree->nodes[node->child1];
+        TreeNode *child2 = &tree->nodes[node->child2];
+        node->height = 1 + maxInt(child1->height, child2->height);
+        aabb_merge(&node->bounds, child1->bounds, child2->bounds);
+
+        index = node->parent;
+    }
+}
+
+// Finds the cheapest sibling for a new leaf by surface area heuristic (perimeter in 2D)
+static int findBestSibling(AABBTree *tree, AABB leafBounds)
+{
+    int index = tree->root;
+    while (!isLeaf(&tree->nodes[index]))
+    {
+        TreeNode *node = &tree->nodes[index];
+        TreeNode *child1 = &tree->nodes[node->child1];
+        TreeNode *child2 = &tree->nodes[node->child2];
+
+        AABB combined;
+        aabb_merge(&combined, node->bounds, leafBounds);
+        float area = aabb_perimeter(node->bounds);
+        float combinedArea = aabb_perimeter(combined);
+
+        // cost of creating a new parent for this node and the new leaf
+        float cost = 2.0f * combinedArea;
+        // minimum cost of pushing the leaf further down the tree
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        float cost1, cost2;
+        aabb_merge(&combined, child1->bounds, leafBounds);
+        if (isLeaf(child1))
+            cost1 = aabb_perimeter(combined) + inheritanceCost;
+        else
+            cost1 = aabb_perimeter(combined) - aabb_perimeter(child1->bounds) + inheritanceCost;
+
+        aabb_merge(&combined, child2->bounds, leafBounds);
+        if (isLeaf(child2))
+            cost2 = aabb_perimeter(combined) + inheritanceCost;
+        else
+            cost2 = aabb_perimeter(combined) - aabb_perimeter(child2->bounds) + inheritanceCost;
+
+        if (cost < cost1 && cost < cost2)
+            break;
+
+        index = cost1 < cost2 ? node->child1 : node->child2;
+    }
+    return index;
+}
+
+static void insertLeaf(AABBTree *tree, int leaf)
+{
+    if (tree->root == TREE_NULL_NODE)
+    {
+        tree->root = leaf;
+        tree->nodes[leaf].parent = TREE_NULL_NODE;
+        return;
+    }
+
+    AABB leafBounds = tree->nodes[leaf].bounds;
+    int sibling = findBestSibling(tree, leafBounds);
+
+    int oldParent = tree->nodes[sibling].parent;
+    int newParent = allocateNode(tree);
+    TreeNode *parentNode = &tree->nodes[newParent];
+    parentNode->parent = oldParent;
+    aabb_merge(&parentNode->bounds, leafBounds, tree->nodes[sibling].bounds);
+    parentNode->height = tree->nodes[sibling].height + 1;
+    parentNode->child1 = sibling;
+    parentNode->child2 = leaf;
+    tree->nodes[sibling].parent = newParent;
+    tree->nodes[leaf].parent = newParent;
+
+    if (oldParent == TREE_NULL_NODE)
+        tree->root = newParent;
+    else if (tree->nodes[oldParent].child1 == sibling)
+        tree->nodes[oldParent].child1 = newParent;
+    else
+        tree->nodes[oldParent].child2 = newParent;
+
+    refitUpwards(tree, newParent);
+}
+
+static void removeLeaf(AABBTree *tree, int leaf)
+{
+    if (leaf == tree->root)
+    {
+        tree->root = TREE_NULL_NODE;
+        return;
+    }
+
+    int parent = tree->nodes[leaf].parent;
+    int grandParent = tree->nodes[parent].parent;
+    int sibling = tree->nodes[parent].child1 == leaf ? tree->nodes[parent].child2 : tree->nodes[parent].child1;
+
+    if (grandParent == TREE_NULL_NODE)
+    {
+        tree->root = sibling;
+        tree->nodes[sibling].parent = TREE_NULL_NODE;
+        freeNode(tree, parent);
+        return;
+    }
+
+    // replace parent with sibling
+    if (tree->nodes[grandParent].child1 == parent)
+        tree->nodes[grandParent].child1 = sibling;
+    else
+        tree->nodes[grandParent].child2 = sibling;
+    tree->nodes[sibling].parent = grandParent;
+    freeNode(tree, parent);
+
+    refitUpwards(tree, grandParent);
+}
+
+// Collects all leaves overlapping region into tree->results
+static int queryTree(AABBTree *tree, AABB region)
+{
+    tree->resultCount = 0;
+    if (tree->root == TREE_NULL_NODE)
+        return 0;
+
+    int top = 0;
+    pushStack(tree, &top, tree->root);
+    while (top > 0)
+    {
+        int index = tree->stack[--top];
+        TreeNode *node = &tree->nodes[index];
+        if (!aabb_overlaps(node->bounds, region))
+            continue;
+
+        if (isLeaf(node))
+        {
+            if (!aabb_overlaps(node->tight, region))
+                continue;
+            tree->results = ensureCapacity(pd->system->realloc, tree->results, &tree->resultCapacity, tree->resultCount + 1, sizeof(int));
+            tree->results[tree->resultCount++] = node->proxy;
+        }
+        else
+        {
+            pushStack(tree, &top, node->child1);
+            pushStack(tree, &top, node->child2);
+        }
+    }
+    return tree->resultCount;
+}
+
+// --- TREE ---
+
+AABBTree *aabbTree_new(float margin)
+{
+    AABBTree *tree = pd->system->realloc(NULL, sizeof(AABBTree));
+    memset(tree, 0, sizeof(AABBTree));
+    tree->margin = margin;
+    tree->freeList = TREE_NULL_NODE;
+    tree->root = TREE_NULL_NODE;
+    return tree;
+}
+
+void aabbTree_free(AABBTree *tree)
+{
+    pd->system->realloc(tree->nodes, 0);
+    pd->system->realloc(tree->proxyNodes, 0);
+    pd->system->realloc(tree->freeIds, 0);
+    pd->system->realloc(tree->stack, 0);
+    pd->system->realloc(tree->pairs, 0);
+    pd->system->realloc(tree->results, 0);
+    pd->system->realloc(tree, 0);
+}
+
+void aabbTree_clear(AABBTree *tree)
+{
+    tree->nodeCount = 0;
+    tree->freeList = TREE_NULL_NODE;
+    tree->root = TREE_NULL_NODE;
+    tree->proxyCount = 0;
+    tree->freeIdCount = 0;
+    tree->pairCount = 0;
+    tree->resultCount = 0;
+}
+
+int aabbTree_insert(AABBTree *tree, AABB bounds)
+{
+    int id;
+    if (tree->freeIdCount > 0)
+    {
+        id = tree->freeIds[--tree->freeIdCount];
+    }
+    else
+    {
+        tree->proxyNodes = ensureCapacity(pd->system->realloc, tree->proxyNodes, &tree->proxyCapacity, tree->proxyCount + 1, sizeof(int));
+        id = tree->proxyCount++;
+    }
+
+    int leaf = allocateNode(tree);
+    tree->proxyNodes[id] = leaf;
+    TreeNode *node = &tree->nodes[leaf];
+    node->proxy = id;
+    node->tight = bounds;
+    node->bounds = bounds;
+    node->filter = COLLISION_FILTER_DEFAULT;
+    aabb_fatten(&node->bounds, tree->margin);
+
+    insertLeaf(tree, leaf);
+    return id;
+}
+
+void aabbTree_remove(AABBTree *tree, int id)
+{
+    int leaf = tree->proxyNodes[id];
+    removeLeaf(tree, leaf);
+    freeNode(tree, leaf);
+
+    tree->proxyNodes[id] = TREE_NULL_NODE;
+    tree->freeIds = ensureCapacity(pd->system->realloc, tree->freeIds, &tree->freeIdCapacity, tree->freeIdCount + 1, sizeof(int));
+    tree->freeIds[tree->freeIdCount++] = id;
+}
+
+int aabbTree_update(AABBTree *tree, int id, AABB bounds)
+{
+    int leaf = tree->proxyNodes[id];
+    TreeNode *node = &tree->nodes[leaf];
+    node->tight = bounds;
+    if (aabb_contains(node->bounds, bounds))
+        return 0;
+
+    removeLeaf(tree, leaf);
+    node = &tree->nodes[leaf];
+    node->bounds = bounds;
+    aabb_fatten(&node->bounds, tree->margin);
+    insertLeaf(tree, leaf);
+    return 1;
+}
+
+void aabbTree_setFilter(AABBTree *tree, int id, CollisionFilter filter)
+{
+    tree->nodes[tree->proxyNodes[id]].filter = filter;
+}
+
+int aabbTree_findPairs(AABBTree *tree)
+{
+    tree->pairCount = 0;
+    if (tree->root == TREE_NULL_NODE)
+        return 0;
+    STATS_TIMER_START(TIMER_BROADPHASE);
+
+    // Simultaneous descent of the tree against itself. Stack holds node pairs (a, b),
+    // b == TREE_NULL_NODE means testing the subtree a against itself.
+    int top = 0;
+    pushStack(tree, &top, tree->root);
+    pushStack(tree, &top, TREE_NULL_NODE);
+    while (top > 0)
+    {
+        int b = tree->stack[--top];
+        int a = tree->stack[--top];
+        TreeNode *nodeA = &tree->nodes[a];
+
+        if (b == TREE_NULL_NODE)
+        {
+            if (isLeaf(nodeA))
+                continue;
+            int child1 = nodeA->child1;
+            int child2 = nodeA->child2;
+            pushStack(tree, &top, child1);
+            pushStack(tree, &top, TREE_NULL_NODE);
+            pushStack(tree, &top, child2);
+            pushStack(tree, &top, TREE_NULL_NODE);
+            pushStack(tree, &top, child1);
+            pushStack(tree, &top, child2);
+            continue;
+        }
+
+        TreeNode *nodeB = &tree->nodes[b];
+        if (!aabb_overlaps(nodeA->bounds, nodeB->bounds))
+            continue;
+
+        if (isLeaf(nodeA) && isLeaf(nodeB))
+        {
+            if (!aabb_overlaps(nodeA->tight, nodeB->tight))
+                continue;
+            if (!collisionFilter_test(nodeA->filter, nodeB->filter))
+            {
+                STATS_COUNT(STAT_FILTERED_PAIRS);
+                continue;
+            }
+            tree->pairs = ensureCapacity(pd->system->realloc, tree->pairs, &tree->pairCapacity, tree->pairCount + 1, sizeof(CollisionPair));
+            int idA = nodeA->proxy;
+            int idB = nodeB->proxy;
+            tree->pairs[tree->pairCount].a = idA < idB ? idA : idB;
+            tree->pairs[tree->pairCount].b = idA < idB ? idB : idA;
+            ++tree->pairCount;
+        }
+        // descend into the bigger node first, to cull as early as possible
+        else if (isLeaf(nodeB) || (!isLeaf(nodeA) && aabb_perimeter(nodeA->bounds) > aabb_perimeter(nodeB->bounds)))
+        {
+            int child1 = nodeA->child1;
+            int child2 = nodeA->child2;
+            pushStack(tree, &top, child1);
+            pushStack(tree, &top, b);
+            pushStack(tree, &top, child2);
+            pushStack(tree, &top, b);
+        }
+        else
+        {
+            int child1 = nodeB->child1;
+            int child2 = nodeB->child2;
+            pushStack(tree, &top, a);
+            pushStack(tree, &top, child1);
+            pushStack(tree, &top, a);
+            pushStack(tree, &top, child2);
+        }
+    }
+
+    STATS_TIMER_STOP(TIMER_BROADPHASE);
+    return tree->pairCount;
+}
+
+int aabbTree_queryRegion(AABBTree *tree, AABB region)
+{
+    return queryTree(tree, region);
+}
+
+void aabbTree_raycast(AABBTree *tree, Vector2D origin, Vector2D dir, float maxT, RaycastCallback callback, void *userData)
+{
+    if (tree->root == TREE_NULL_NODE)
+        return;
+
+    float tEnter;
+    if (!aabb_raycast(&tEnter, tree->nodes[tree->root].bounds, origin, dir, maxT))
+        return;
+
+    int top = 0;
+    pushStack(tree, &top, tree->root);
+    while (top > 0)
+    {
+        int index = tree->stack[--top];
+        TreeNode *node = &tree->nodes[index];
+        // maxT may have been clipped since the node was pushed
+        if (!aabb_raycast(&tEnter, node->bounds, origin, dir, maxT))
+            continue;
+
+        if (isLeaf(node))
+        {
+            if (!aabb_raycast(&tEnter, node->tight, origin, dir, maxT))
+                continue;
+            maxT = callback(userData, node->proxy, origin, dir, maxT);
+            if (maxT < 0)
+                return;
+        }
+        else
+        {
+            // visit the child closer along the ray first, so first hit queries clip early
+            float t1, t2;
+            int hit1 = aabb_raycast(&t1, tree->nodes[node->child1].bounds, origin, dir, maxT);
+            int hit2 = aabb_raycast(&t2, tree->nodes[node->child2].bounds, origin, dir, maxT);
+            if (hit1 && hit2 && t1 < t2)
+            {
+                pushStack(tree, &top, node->child2);
+                pushStack(tree, &top, node->child1);
+            }
+            else
+            {
+                if (hit1)
+                    pushStack(tree, &top, node->child1);
+                if (hit2)
+                    pushStack(tree, &top, node->child2);
+            }
+        }
+    }
+}
+
+int aabbTree_isValidId(AABBTree *tree, int id)
+{
+    return id >= 0 && id < tree->proxyCount && tree->proxyNodes[id] != TREE_NULL_NODE;
+}
+
+// --- LUA HOOKS ---
+
+static int lua_tree_new(lua_State *L)
+{
+    float margin = TREE_DEFAULT_MARGIN;
+    if (pd->lua->getArgCount() >= 1)
+        margin = pd->lua->getArgFloat(1);
+
+    AABBTree *tree = aabbTree_new(margin);
+    pd->lua->pushObject(tree, TREE_TYPE_NAME, 0);
+    return 1;
+}
+
+static int lua_tree_free(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+    aabbTree_free(tree);
+    return 0;
+}
+
+// Lua ids are 1-based
+static int lua_tree_insertCircle(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+    Vector2D *center = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(3);
+
+    AABB bounds;
+    aabb_fromCircle(&bounds, *center, radius);
+
+    pd->lua->pushInt(aabbTree_insert(tree, bounds) + 1);
+    return 1;
+}
+
+static int lua_tree_insertPoly(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+    Polygon *poly = pd->lua->getArgObject(2, POLY_TYPE_NAME, NULL);
+
+    polygon_updateCache(poly);
+    AABB bounds = poly->bounds;
+
+    pd->lua->pushInt(aabbTree_insert(tree, bounds) + 1);
+    return 1;
+}
+
+static int lua_tree_updateCircle(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+    Vector2D *center = pd->lua->getArgObject(3, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(4);
+
+    if (!aabbTree_isValidId(tree, id))
+        return 0;
+
+    AABB bounds;
+    aabb_fromCircle(&bounds, *center, radius);
+    aabbTree_update(tree, id, bounds);
+    return 0;
+}
+
+static int lua_tree_updatePoly(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+    Polygon *poly = pd->lua->getArgObject(3, POLY_TYPE_NAME, NULL);
+
+    if (!aabbTree_isValidId(tree, id))
+        return 0;
+
+    polygon_updateCache(poly);
+    AABB bounds = poly->bounds;
+    aabbTree_update(tree, id, bounds);
+    return 0;
+}
+
+// tree:insertBox(x, y, width, height)
+static int lua_tree_insertBox(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+
+    AABB bounds;
+    bounds.minX = pd->lua->getArgFloat(2);
+    bounds.minY = pd->lua->getArgFloat(3);
+    bounds.maxX = bounds.minX + pd->lua->getArgFloat(4);
+    bounds.maxY = bounds.minY + pd->lua->getArgFloat(5);
+
+    pd->lua->pushInt(aabbTree_insert(tree, bounds) + 1);
+    return 1;
+}
+
+// tree:insertCapsule(a, b, radius), radius 0 for a segment
+static int lua_tree_insertCapsule(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+    Vector2D *a = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
+    Vector2D *b = pd->lua->getArgObject(3, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(4);
+
+    AABB bounds;
+    aabb_fromCapsule(&bounds, *a, *b, radius);
+
+    pd->lua->pushInt(aabbTree_insert(tree, bounds) + 1);
+    return 1;
+}
+
+static int lua_tree_updateBox(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+
+    if (!aabbTree_isValidId(tree, id))
+        return 0;
+
+    AABB bounds;
+    bounds.minX = pd->lua->getArgFloat(3);
+    bounds.minY = pd->lua->getArgFloat(4);
+    bounds.maxX = bounds.minX + pd->lua->getArgFloat(5);
+    bounds.maxY = bounds.minY + pd->lua->getArgFloat(6);
+    aabbTree_update(tree, id, bounds);
+    return 0;
+}
+
+static int lua_tree_updateCapsule(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+    Vector2D *a = pd->lua->getArgObject(3, VECTOR_TYPE_NAME, NULL);
+    Vector2D *b = pd->lua->getArgObject(4, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(5);
+
+    if (!aabbTree_isValidId(tree, id))
+        return 0;
+
+    AABB bounds;
+    aabb_fromCapsule(&bounds, *a, *b, radius);
+    aabbTree_update(tree, id, bounds);
+    return 0;
+}
+
+static int lua_tree_remove(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+
+    if (!aabbTree_isValidId(tree, id))
+        return 0;
+
+    aabbTree_remove(tree, id);
+    return 0;
+}
+
+// tree:setFilter(id, category, mask, [group]), mask -1 for all categories
+static int lua_tree_setFilter(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+
+    if (!aabbTree_isValidId(tree, id))
+        return 0;
+
+    CollisionFilter filter;
+    filter.category = (uint32_t)pd->lua->getArgInt(3);
+    filter.mask = (uint32_t)pd->lua->getArgInt(4);
+    filter.group = pd->lua->argIsNil(5) ? 0 : pd->lua->getArgInt(5);
+    aabbTree_setFilter(tree, id, filter);
+    return 0;
+}
+
+static int lua_tree_clear(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+    aabbTree_clear(tree);
+    return 0;
+}
+
+static int lua_tree_findPairs(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+
+    pd->lua->pushInt(aabbTree_findPairs(tree));
+    return 1;
+}
+
+// returns ids of pair i (1-based) of the last findPairs call
+static int lua_tree_getPair(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+    int i = pd->lua->getArgInt(2) - 1;
+
+    if (i < 0 || i >= tree->pairCount)
+        return 0;
+
+    pd->lua->pushInt(tree->pairs[i].a + 1);
+    pd->lua->pushInt(tree->pairs[i].b + 1);
+    return 2;
+}
+
+// arguments are x, y, width, height of the region (like playdate.geometry.rect)
+static int lua_tree_queryRegion(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+    AABB region;
+    region.minX = pd->lua->getArgFloat(2);
+    region.minY = pd->lua->getArgFloat(3);
+    region.maxX = region.minX + pd->lua->getArgFloat(4);
+    region.maxY = region.minY + pd->lua->getArgFloat(5);
+
+    pd->lua->pushInt(aabbTree_queryRegion(tree, region));
+    return 1;
+}
+
+// returns id i (1-based) of the last queryRegion call
+static int lua_tree_getResult(lua_State *L)
+{
+    AABBTree *tree = pd->lua->getArgObject(1, TREE_TYPE_NAME, NULL);
+    int i = pd->lua->getArgInt(2) - 1;
+
+    if (i < 0 || i >= tree->resultCount)
+        return 0;
+
+    pd->lua->pushInt(tree->results[i] + 1);
+    return 1;
+}
+
+static const lua_reg treelib[] =
+{
+    { "new",            lua_tree_new },
+    { "__gc",           lua_tree_free },
+    { "insertCircle",   lua_tree_insertCircle },
+    { "insertPoly",     lua_tree_insertPoly },
+    { "insertBox",      lua_tree_insertBox },
+    { "insertCapsule",  lua_tree_insertCapsule },
+    { "updateCircle",   lua_tree_updateCircle },
+    { "updatePoly",     lua_tree_updatePoly },
+    { "updateBox",      lua_tree_updateBox },
+    { "updateCapsule",  lua_tree_updateCapsule },
+    { "remove",         lua_tree_remove },
+    { "setFilter",      lua_tree_setFilter },
+    { "clear",          lua_tree_clear },
+    { "findPairs",      lua_tree_findPairs },
+    { "getPair",        lua_tree_getPair },
+    { "queryRegion",    lua_tree_queryRegion },
+    { "getResult",      lua_tree_getResult },
+    { NULL, NULL }
+};
+
+void registerAABBTree(PlaydateAPI* playdate)
+{
+    pd = playdate;
+
+    const char* err;
+
+    if (!pd->lua->registerClass(TREE_TYPE_NAME, treelib, NULL, 0, &err))
+        pd->system->error("%s:%i: registerClass failed, %s", __FILE__, __LINE__, err);
+}
@@ -0,0 +1,89 @@
+#ifndef _AABBTREE_H
+#define _AABBTREE_H
+
+#include "pd_api.h"
+#include "aabb.h"
+#include "broadphase.h"
+
+#define TREE_TYPE_NAME "collision.tree"
+
+#define TREE_NULL_NODE -1
+#define TREE_DEFAULT_MARGIN 4.0f
+
+// Dynamic AABB tree (bounding volume hierarchy) broadphase. Works well for
+// bodies of very different sizes, where a uniform grid degrades.
+// Leaves store a fattened box (bounds grown by margin), so a body moving only
+// a little stays inside it and does not need to be reinserted. The tree is
+// kept balanced by rotations on every insert/remove.
+
+typedef struct
+{
+    AABB bounds;    // fattened for leaves
+    AABB tight;     // actual body bounds, leaves only
+    int parent;     // next free node while on the free list
+    int child1;
+    int child2;
+    int height;     // leaf = 0, free node = -1
+    int proxy;      // body id, leaves only
+    CollisionFilter filter; // leaves only
+} TreeNode;
+
+typedef struct
+{
+    float margin;
+
+    TreeNode *nodes;
+    int nodeCount;
+    int nodeCapacity;
+    int freeList;
+    int root;
+
+    // leaf node of every body id, TREE_NULL_NODE for removed ids. Body ids are dense like
+    // those of the grid (nodes also hold the internal nodes), removed ids are reused.
+    int *proxyNodes;
+    int proxyCount;
+    int proxyCapacity;
+    int *freeIds;
+    int freeIdCount;
+    int freeIdCapacity;
+
+    // traversal stack for queries
+    int *stack;
+    int stackCapacity;
+
+    // result of the last aabbTree_findPairs
+    CollisionPair *pairs;
+    int pairCount;
+    int pairCapacity;
+
+    // result of the last aabbTree_queryRegion
+    int *results;
+    int resultCount;
+    int resultCapacity;
+} AABBTree;
+
+AABBTree *aabbTree_new(float margin);
+void aabbTree_free(AABBTree *tree);
+void aabbTree_clear(AABBTree *tree);
+
+// Returns id of the new body (>= 0)
+int aabbTree_insert(AABBTree *tree, AABB bounds);
+void aabbTree_remove(AABBTree *tree, int id);
+// Returns 1 if the body left its fattened box and was reinserted, 0 otherwise
+int aabbTree_update(AABBTree *tree, int id, AABB bounds);
+// Bodies start with COLLISION_FILTER_DEFAULT, see CollisionFilter
+void aabbTree_setFilter(AABBTree *tree, int id, CollisionFilter filter);
+
+// Fills tree->pairs with all pairs of bodies with overlapping bounds whose filters
+// let them collide. Every pair is reported exactly once. Returns the number of pairs.
+int aabbTree_findPairs(AABBTree *tree);
+// Fills tree->results with ids of all bodies overlapping region. Returns the number of ids.
+int aabbTree_queryRegion(AABBTree *tree, AABB region);
+
+// Calls callback for every body whose bounds the ray crosses, closer nodes first (see RaycastCallback)
+void aabbTree_raycast(AABBTree *tree, Vector2D origin, Vector2D dir, float maxT, RaycastCallback callback, void *userData);
+int aabbTree_isValidId(AABBTree *tree, int id);
+
+void registerAABBTree(PlaydateAPI *playdate);
+
+#endif // _AABBTREE_H
@@ -0,0 +1,43 @@
+#ifndef _BROADPHASE_H
+#define _BROADPHASE_H
+
+#include <stdint.h>
+#include "vector2d.h"
+
+// Types shared by the broadphase structures (spatial grid, AABB tree, sweep and prune)
+
+// Candidate pair reported by a broadphase. a and b are the ids returned on insert, a < b.
+typedef struct
+{
+    int a;
+    int b;
+} CollisionPair;
+
+// Called by the broadphase raycast functions for every body whose bounds the ray
+// origin + dir * t (0 <= t <= maxT) passes through. Returns the new maxT: the hit t
+// of the body clips the ray (first hit queries), maxT keeps going (all hits queries)
+// and a negative value stops the query.
+typedef float (*RaycastCallback)(void *userData, int id, Vector2D origin, Vector2D dir, float maxT);
+
+// Collision layers of a body, checked by findPairs before a pair is reported. Two bodies
+// are a pair if the category of each one is in the mask of the other. A group overrides
+// that if both bodies share it: bodies of the same positive group always pair, bodies of
+// the same negative group never do (e.g. the parts of one character). Group 0 is no group.
+typedef struct
+{
+    uint32_t category;
+    uint32_t mask;
+    int group;
+} CollisionFilter;
+
+// Filter of newly inserted bodies: category 1, pairs with every category
+#define COLLISION_FILTER_DEFAULT ((CollisionFilter){ .category = 1, .mask = 0xFFFFFFFFu, .group = 0 })
+
+static inline int collisionFilter_test(CollisionFilter a, CollisionFilter b)
+{
+    if (a.group != 0 && a.group == b.group)
+        return a.group > 0;
+    return (a.category & b.mask) != 0 && (b.category & a.mask) != 0;
+}
+
+#endif // _BROADPHASE_H
@@ -1,25 +1,113 @@
 #include "collision.h"
-
-#ifndef FLT_MAX
-#define FLT_MAX 3.402823466e+38F
+#include "spatialgrid.h"
+#include "aabbtree.h"
+#include "sweepprune.h"
+#include "gjk.h"
+#include "stats.h"
+#include "util.h"
+#include "trace.h"
+#include "simd.h"
+
+// Polygons with fewer vertices are always projected by testing every vertex
+#define CONVEX_SEARCH_MIN_VERTS 8
+// Convex polygons up to this many vertices use the SoA projection instead of the search. With
+// vector lanes it beats the search up to about 32 vertices, the scalar loop only below it.
+#ifndef SIMD_PROJECT_MAX_VERTS
+#if SIMD_WIDTH > 1
+#define SIMD_PROJECT_MAX_VERTS 32
+#else
+#define SIMD_PROJECT_MAX_VERTS CONVEX_SEARCH_MIN_VERTS
+#endif
 #endif
+// Circles tested per call of simd_circleCandidates in the all pairs batch
+#define BATCH_CANDIDATE_BLOCK 64
 
 static PlaydateAPI* pd = NULL;
 
+// Concave polygons with convex parts, see the COMPOUND section
+static int compound_polyPoly(CollisionMethod method, Vector2D *resolveDir, float *depth, Polygon polyA, Polygon polyB);
+static int compound_circlePoly(CollisionMethod method, Vector2D *resolveDir, float *depth, Vector2D center, float radius, Polygon poly);
+static int compound_segmentPoly(Vector2D *resolveDir, float *depth, Segment segment, Polygon poly);
+
 // -- HELPER ---
 
 static void polyEdge(Vector2D *target, Polygon p, int index)
 {
-    int index2 = (index + 1) % p.count;
+    int index2 = index + 1 < p.count ? index + 1 : 0;
     target->x = p.verts[index2].x - p.verts[index].x;
     target->y = p.verts[index2].y - p.verts[index].y;
 }
 
+// number of SAT axes of a polygon, cached normals are deduplicated (see polygon_cacheNormals)
+static inline int axisCount(Polygon p)
+{
+    return p.normals != NULL ? p.normalCount : p.count;
+}
+
 static inline float square(float v)
 {
     return v * v;
 }
 
+// Direction from the local space of a transformed polygon to world space and back
+static inline Vector2D rotateToWorld(Polygon p, Vector2D v)
+{
+    Vector2D result = { .x = v.x * p.cosRot - v.y * p.sinRot, .y = v.x * p.sinRot + v.y * p.cosRot };
+    return result;
+}
+
+static inline Vector2D rotateToLocal(Polygon p, Vector2D v)
+{
+    Vector2D result = { .x = v.x * p.cosRot + v.y * p.sinRot, .y = v.y * p.cosRot - v.x * p.sinRot };
+    return result;
+}
+
+// Axis i of a polygon (as used by the SAT loops) in world space, normalized.
+// Returns 0 for zero-length edges.
+static inline int polyAxis(Vector2D *axis, Polygon p, int i)
+{
+    if (p.normals == NULL)
+    {
+        Vector2D edge;
+        polyEdge(&edge, p, i);
+
+        if (edge.x == 0 && edge.y == 0)
+            return 0;
+
+        vector2D_leftNormal(axis, edge);
+        vector2D_normalize(axis);
+    }
+    else
+    {
+        *axis = p.normals[i];
+    }
+    if (p.transformed)
+        *axis = rotateToWorld(p, *axis);
+    return 1;
+}
+
+// Cheap rejection by the cached bounds, skipped if a polygon is dirty
+static inline int boundsApart(Polygon polyA, Polygon polyB)
+{
+    if (polyA.dirty || polyB.dirty || aabb_overlaps(polyA.bounds, polyB.bounds))
+        return 0;
+    STATS_COUNT(STAT_BOUNDS_EXITS);
+    return 1;
+}
+
+static inline int circleBoundsApart(Vector2D center, float radius, Polygon poly)
+{
+    if (poly.dirty)
+        return 0;
+
+    float dx = fmaxf(fmaxf(poly.bounds.minX - center.x, center.x - poly.bounds.maxX), 0);
+    float dy = fmaxf(fmaxf(poly.bounds.minY - center.y, center.y - poly.bounds.maxY), 0);
+    if (square(dx) + square(dy) <= square(radius))
+        return 0;
+    STATS_COUNT(STAT_BOUNDS_EXITS);
+    return 1;
+}
+
 static void projectPoly(float *outMin, float *outMax, Polygon poly, Vector2D axis)
 {
     *outMin = FLT_MAX;
@@ -34,6 +122,83 @@ static void projectPoly(float *outMin, float *outMax, Polygon poly, Vector2D axi
     }
 }
 
+// Start vertices for the extreme vertex search of a convex polygon, see projectPolyHinted
+typedef struct
+{
+    int min;
+    int max;
+} ProjectionHint;
+
+// Index of the vertex with the largest projection onto axis (times sign, so sign = -1 finds the smallest).
+// Only valid for convex polygons: walks from start in ascending direction until the projection drops.
+static int extremeVertex(Polygon poly, Vector2D axis, int start, float sign)
+{
+    int best = start;
+    float bestVal = sign * vector2D_dotProduct(axis, poly.verts[start]);
+
+    // try forward first, only walk backwards if that did not improve anything
+    for (int dir = 1; dir >= -1 && best == start; dir -= 2)
+    {
+        int i = start;
+        float val = bestVal;
+        // equal values are walked over (duplicate vertices, edges perpendicular to axis)
+        for (int steps = 1; steps < poly.count; ++steps)
+        {
+            i += dir;
+            if (i == poly.count)
+                i = 0;
+            else if (i < 0)
+                i = poly.count - 1;
+
+            float d = sign * vector2D_dotProduct(axis, poly.verts[i]);
+            if (d < val)
+                break;
+            if (d > bestVal)
+            {
+                best = i;
+                bestVal = d;
+            }
+            val = d;
+        }
+    }
+    return best;
+}
+
+// Projects the polygon onto a world space axis. For convex polygons the min/max vertices
+// are found by hill-climbing from the hint (result of the previous call). The SAT loops test
+// edge normals in order, so the axis rotates steadily and the extreme vertices only move a
+// few steps each time, making a whole SAT test O(nA + nB) instead of O((nA + nB)^2).
+// Transformed polygons project their local vertices onto the axis rotated into local space,
+// the position only adds a constant offset.
+static void projectPolyHinted(float *outMin, float *outMax, Polygon poly, Vector2D axis, ProjectionHint *hint)
+{
+    float offset = 0;
+    if (poly.transformed)
+    {
+        offset = vector2D_dotProduct(axis, poly.position);
+        axis = rotateToLocal(poly, axis);
+    }
+
+    if (poly.soa != NULL && !(poly.dirty & POLY_DIRTY_SHAPE) && (!poly.convex || poly.count <= SIMD_PROJECT_MAX_VERTS))
+    {
+        simd_projectMinMax(outMin, outMax, poly.soa, poly.soa + poly.soaCount, poly.soaCount, axis.x, axis.y);
+    }
+    else if (!poly.convex || poly.count <= CONVEX_SEARCH_MIN_VERTS)
+    {
+        projectPoly(outMin, outMax, poly, axis);
+    }
+    else
+    {
+        hint->max = extremeVertex(poly, axis, hint->max, 1.0f);
+        hint->min = extremeVertex(poly, axis, hint->min, -1.0f);
+        *outMax = vector2D_dotProduct(axis, poly.verts[hint->max]);
+        *outMin = vector2D_dotProduct(axis, poly.verts[hint->min]);
+    }
+
+    *outMin += offset;
+    *outMax += offset;
+}
+
 // note axis is assumed to be normalized
 static void projectCircle(float *outMin, float *outMax, Vector2D center, float radius, Vector2D axis)
 {
@@ -55,6 +220,13 @@ static void projectCircle(float *outMin, float *outMax, Vector2D center, float r
 
 static int findClosestVertexIndex(Vector2D target, Polygon poly)
 {
+    if (poly.transformed)
+    {
+        target.x -= poly.position.x;
+        target.y -= poly.position.y;
+        target = rotateToLocal(poly, target);
+    }
+
     float distSqr = FLT_MAX;
     int result = 0;
     for (int i = 0; i < poly.count; ++i)
@@ -69,274 +241,1693 @@ static int findClosestVertexIndex(Vector2D target, Polygon poly)
     return result;
 }
 
-// --- COLLISION ---
+// --- FIXED SIZE KERNELS ---
+
+// Most polygons are triangles or quads. For those (and 6 or 8 vertices) collision_polyPoly,
+// collision_circlePoly and their _check variants dispatch once on the vertex counts to the kernels generated below, which
+// project with straight-line code instead of the generic loop (no loop counter, hint or SoA
+// checks per axis). Only the loop over the (deduplicated) axes remains. The operations are the
+// same as in projectPolyHinted, so are the results.
+
+#define PROJECT_VERTEX(i) \
+    do \
+    { \
+        float d = vector2D_dotProduct(axis, v[i]); \
+        if (d < min) \
+            min = d; \
+        if (d > max) \
+            max = d; \
+    } while (0)
+
+#define PROJECT_VERTICES_3 PROJECT_VERTEX(0); PROJECT_VERTEX(1); PROJECT_VERTEX(2)
+#define PROJECT_VERTICES_4 PROJECT_VERTICES_3; PROJECT_VERTEX(3)
+#define PROJECT_VERTICES_6 PROJECT_VERTICES_4; PROJECT_VERTEX(4); PROJECT_VERTEX(5)
+#define PROJECT_VERTICES_8 PROJECT_VERTICES_6; PROJECT_VERTEX(6); PROJECT_VERTEX(7)
+
+#define DEFINE_PROJECT_FIXED(N) \
+    static inline void projectFixed##N(float *outMin, float *outMax, const Polygon *poly, Vector2D axis) \
+    { \
+        float offset = 0; \
+        if (poly->transformed) \
+        { \
+            offset = vector2D_dotProduct(axis, poly->position); \
+            axis = rotateToLocal(*poly, axis); \
+        } \
+        const Vector2D *v = poly->verts; \
+        float min = FLT_MAX; \
+        float max = -FLT_MAX; \
+        PROJECT_VERTICES_##N; \
+        *outMin = min + offset; \
+        *outMax = max + offset; \
+    }
 
-int collision_circleCircle_check(Vector2D centerA, float radiusA, Vector2D centerB, float radiusB)
-{
-    float distSqr = square(centerA.x - centerB.x) + square(centerA.y - centerB.y);
-    if (distSqr >= square(radiusA + radiusB))
-        return 0;
-    return 1;
-}
+DEFINE_PROJECT_FIXED(3)
+DEFINE_PROJECT_FIXED(4)
+DEFINE_PROJECT_FIXED(6)
+DEFINE_PROJECT_FIXED(8)
 
-int collision_circleCircle(Vector2D *resolveDir, float *depth, Vector2D centerA, float radiusA, Vector2D centerB, float radiusB)
+// Overlap on one SAT axis: returns 0 if the projections are apart, otherwise keeps the
+// smallest overlap so far in resolveDir and depth
+static inline int satAxis(Vector2D *resolveDir, float *depth, int *invertResult, Vector2D axis, float minA, float maxA, float minB, float maxB)
 {
-    *depth = square(centerA.x - centerB.x) + square(centerA.y - centerB.y);
-    if (*depth >= square(radiusA + radiusB))
+    STATS_COUNT(STAT_SAT_AXES);
+    if (maxA < minB || maxB < minA)
+    {
+        STATS_COUNT(STAT_AXIS_EXITS);
         return 0;
+    }
 
-    *depth = sqrtf(*depth);
-    resolveDir->x = (centerB.x - centerA.x) / *depth;
-    resolveDir->y = (centerB.y - centerA.y) / *depth;
-    *depth = radiusA + radiusB - *depth;
+    float axisDepth = fminf(maxA - minB, maxB - minA);
+    if (axisDepth < *depth)
+    {
+        *depth = axisDepth;
+        *resolveDir = axis;
+        *invertResult = maxB - minA < maxA - minB;
+    }
     return 1;
 }
 
-
-int collision_polyPoly_check(Polygon polyA, Polygon polyB)
+// Separation test of the _check functions, which only need to know if any axis separates
+static inline int satSeparated(float minA, float maxA, float minB, float maxB)
 {
-    float minA, minB, maxA, maxB;
-    Vector2D edge;
-    Vector2D axis;
-
-    for (int i = 0; i < polyA.count; ++i)
-    {
-        if (polyA.normals == NULL)
-        {
-            polyEdge(&edge, polyA, i);
-
-            if (edge.x == 0 && edge.y == 0)
-                continue;
-
-            vector2D_leftNormal(&axis, edge);
-        }
-        else
-        {
-            axis = polyA.normals[i];
-        }
-        
-        projectPoly(&minA, &maxA, polyA, axis);
-        projectPoly(&minB, &maxB, polyB, axis);
-
-        if (maxA < minB || maxB < minA)
-            return 0;
-    }
-    for (int i = 0; i < polyB.count; ++i)
+    STATS_COUNT(STAT_SAT_AXES);
+    if (maxA < minB || maxB < minA)
     {
-        if (polyB.normals == NULL)
-        {
-            polyEdge(&edge, polyB, i);
-
-            if (edge.x == 0 && edge.y == 0)
-                continue;
-
-            vector2D_leftNormal(&axis, edge);
-        }
-        else
-        {
-            axis = polyB.normals[i];
-        }
-        
-        projectPoly(&minA, &maxA, polyA, axis);
-        projectPoly(&minB, &maxB, polyB, axis);
-
-        if (maxA < minB || maxB < minA)
-            return 0;
+        STATS_COUNT(STAT_AXIS_EXITS);
+        return 1;
     }
-
-    return 1;
+    return 0;
 }
 
-int collision_polyPoly(Vector2D *resolveDir, float *depth, Polygon polyA, Polygon polyB)
+// Axis i as used by the _check functions: edge normals are not normalized, the separation
+// test does not depend on the length
+static inline int polyCheckAxis(Vector2D *axis, Polygon p, int i)
 {
-    float minA, minB, maxA, maxB;
-    *depth = FLT_MAX;
-    int invertResult = 0;
-    Vector2D edge;
-    Vector2D axis;
-
-    for (int i = 0; i < polyA.count; ++i)
+    if (p.normals == NULL)
     {
-        if (polyA.normals == NULL)
-        {
-            polyEdge(&edge, polyA, i);
-
-            if (edge.x == 0 && edge.y == 0)
-                continue;
-
-            vector2D_leftNormal(&axis, edge);
-            vector2D_normalize(&axis);
-        }
-        else
-        {
-            axis = polyA.normals[i];
-        }
-        
-        projectPoly(&minA, &maxA, polyA, axis);
-        projectPoly(&minB, &maxB, polyB, axis);
+        Vector2D edge;
+        polyEdge(&edge, p, i);
 
-        if (maxA < minB || maxB < minA)
+        if (edge.x == 0 && edge.y == 0)
             return 0;
 
-        float axisDepth = fminf(maxA - minB, maxB - minA);
-        if (axisDepth < *depth)
-        {
-            *depth = axisDepth;
-            *resolveDir = axis;
-            invertResult = maxB - minA < maxA - minB;
-        }
+        vector2D_leftNormal(axis, edge);
     }
-    for (int i = 0; i < polyB.count; ++i)
+    else
     {
-        if (polyB.normals == NULL)
-        {
-            polyEdge(&edge, polyB, i);
-
-            if (edge.x == 0 && edge.y == 0)
-                continue;
-
-            vector2D_leftNormal(&axis, edge);
-            vector2D_normalize(&axis);
-        }
-        else
-        {
-            axis = polyB.normals[i];
-        }
-        
-        projectPoly(&minA, &maxA, polyA, axis);
-        projectPoly(&minB, &maxB, polyB, axis);
-
-        if (maxA < minB || maxB < minA)
-            return 0;
-
-        float axisDepth = fminf(maxA - minB, maxB - minA);
-        if (axisDepth < *depth)
-        {
-            *depth = axisDepth;
-            *resolveDir = axis;
-            invertResult = maxB - minA < maxA - minB;
-        }
+        *axis = p.normals[i];
     }
+    if (p.transformed)
+        *axis = rotateToWorld(p, *axis);
+    return 1;
+}
 
+static inline int satResult(Vector2D *resolveDir, int invertResult)
+{
     if (invertResult)
     {
         resolveDir->x *= -1;
         resolveDir->y *= -1;
     }
-
     return 1;
 }
 
-
-int collision_circlePoly_check(Vector2D center, float radius, Polygon poly)
+// Extra axis of the circle tests, from the closest vertex of poly to the center
+static inline void circleAxis(Vector2D *axis, Vector2D center, const Polygon *poly)
 {
-    float minA, minB, maxA, maxB;
-    Vector2D edge;
-    Vector2D axis;
-
-    int index = findClosestVertexIndex(center, poly);
-    vector2D_dirNormalized(&axis, poly.verts[index], center);
+    Vector2D closest;
+    polygon_getVertex(&closest, *poly, findClosestVertexIndex(center, *poly));
+    vector2D_dirNormalized(axis, closest, center);
+}
 
-    projectCircle(&minA, &maxA, center, radius, axis);
-    projectPoly(&minB, &maxB, poly, axis);
+#define DEFINE_SAT_POLY_POLY(NA, NB) \
+    static int satPolyPoly_##NA##_##NB(Vector2D *resolveDir, float *depth, const Polygon *polyA, const Polygon *polyB) \
+    { \
+        float minA, maxA, minB, maxB; \
+        int invertResult = 0; \
+        Vector2D axis; \
+        *depth = FLT_MAX; \
+        for (int i = 0; i < axisCount(*polyA); ++i) \
+        { \
+            if (!polyAxis(&axis, *polyA, i)) \
+                continue; \
+            projectFixed##NA(&minA, &maxA, polyA, axis); \
+            projectFixed##NB(&minB, &maxB, polyB, axis); \
+            if (!satAxis(resolveDir, depth, &invertResult, axis, minA, maxA, minB, maxB)) \
+                return 0; \
+        } \
+        for (int i = 0; i < axisCount(*polyB); ++i) \
+        { \
+            if (!polyAxis(&axis, *polyB, i)) \
+                continue; \
+            projectFixed##NA(&minA, &maxA, polyA, axis); \
+            projectFixed##NB(&minB, &maxB, polyB, axis); \
+            if (!satAxis(resolveDir, depth, &invertResult, axis, minA, maxA, minB, maxB)) \
+                return 0; \
+        } \
+        return satResult(resolveDir, invertResult); \
+    }
 
-    if (maxA < minB || maxB < minA)
-        return 0;
+#define DEFINE_SAT_POLY_POLY_CHECK(NA, NB) \
+    static int satPolyPolyCheck_##NA##_##NB(const Polygon *polyA, const Polygon *polyB) \
+    { \
+        float minA, maxA, minB, maxB; \
+        Vector2D axis; \
+        for (int i = 0; i < axisCount(*polyA); ++i) \
+        { \
+            if (!polyCheckAxis(&axis, *polyA, i)) \
+                continue; \
+            projectFixed##NA(&minA, &maxA, polyA, axis); \
+            projectFixed##NB(&minB, &maxB, polyB, axis); \
+            if (satSeparated(minA, maxA, minB, maxB)) \
+                return 0; \
+        } \
+        for (int i = 0; i < axisCount(*polyB); ++i) \
+        { \
+            if (!polyCheckAxis(&axis, *polyB, i)) \
+                continue; \
+            projectFixed##NA(&minA, &maxA, polyA, axis); \
+            projectFixed##NB(&minB, &maxB, polyB, axis); \
+            if (satSeparated(minA, maxA, minB, maxB)) \
+                return 0; \
+        } \
+        return 1; \
+    }
 
-    for (int i = 0; i < poly.count; ++i)
-    {
-        if (poly.normals == NULL)
-        {
-            polyEdge(&edge, poly, i);
+#define DEFINE_SAT_POLY_POLY_ROW(NA) \
+    DEFINE_SAT_POLY_POLY(NA, 3) \
+    DEFINE_SAT_POLY_POLY(NA, 4) \
+    DEFINE_SAT_POLY_POLY(NA, 6) \
+    DEFINE_SAT_POLY_POLY(NA, 8) \
+    DEFINE_SAT_POLY_POLY_CHECK(NA, 3) \
+    DEFINE_SAT_POLY_POLY_CHECK(NA, 4) \
+    DEFINE_SAT_POLY_POLY_CHECK(NA, 6) \
+    DEFINE_SAT_POLY_POLY_CHECK(NA, 8)
+
+DEFINE_SAT_POLY_POLY_ROW(3)
+DEFINE_SAT_POLY_POLY_ROW(4)
+DEFINE_SAT_POLY_POLY_ROW(6)
+DEFINE_SAT_POLY_POLY_ROW(8)
+
+#define DEFINE_SAT_CIRCLE_POLY(N) \
+    static int satCirclePoly_##N(Vector2D *resolveDir, float *depth, Vector2D center, float radius, const Polygon *poly) \
+    { \
+        float minA, maxA, minB, maxB; \
+        int invertResult = 0; \
+        Vector2D axis; \
+        *depth = FLT_MAX; \
+        circleAxis(&axis, center, poly); \
+        projectCircle(&minA, &maxA, center, radius, axis); \
+        projectFixed##N(&minB, &maxB, poly, axis); \
+        if (!satAxis(resolveDir, depth, &invertResult, axis, minA, maxA, minB, maxB)) \
+            return 0; \
+        for (int i = 0; i < axisCount(*poly); ++i) \
+        { \
+            if (!polyAxis(&axis, *poly, i)) \
+                continue; \
+            projectCircle(&minA, &maxA, center, radius, axis); \
+            projectFixed##N(&minB, &maxB, poly, axis); \
+            if (!satAxis(resolveDir, depth, &invertResult, axis, minA, maxA, minB, maxB)) \
+                return 0; \
+        } \
+        return satResult(resolveDir, invertResult); \
+    }
 
-            if (edge.x == 0 && edge.y == 0)
-                continue;
+// Like collision_circlePoly_check, only the axis to the closest vertex is normalized
+#define DEFINE_SAT_CIRCLE_POLY_CHECK(N) \
+    static int satCirclePolyCheck_##N(Vector2D center, float radius, const Polygon *poly) \
+    { \
+        float minA, maxA, minB, maxB; \
+        Vector2D axis; \
+        circleAxis(&axis, center, poly); \
+        projectCircle(&minA, &maxA, center, radius, axis); \
+        projectFixed##N(&minB, &maxB, poly, axis); \
+        if (satSeparated(minA, maxA, minB, maxB)) \
+            return 0; \
+        for (int i = 0; i < axisCount(*poly); ++i) \
+        { \
+            if (!polyCheckAxis(&axis, *poly, i)) \
+                continue; \
+            projectCircle(&minA, &maxA, center, radius, axis); \
+            projectFixed##N(&minB, &maxB, poly, axis); \
+            if (satSeparated(minA, maxA, minB, maxB)) \
+                return 0; \
+        } \
+        return 1; \
+    }
 
-            vector2D_leftNormal(&axis, edge);
-        }
-        else
-        {
-            axis = poly.normals[i];
-        }
-        
-        projectCircle(&minA, &maxA, center, radius, axis);
-        projectPoly(&minB, &maxB, poly, axis);
+DEFINE_SAT_CIRCLE_POLY(3)
+DEFINE_SAT_CIRCLE_POLY(4)
+DEFINE_SAT_CIRCLE_POLY(6)
+DEFINE_SAT_CIRCLE_POLY(8)
+DEFINE_SAT_CIRCLE_POLY_CHECK(3)
+DEFINE_SAT_CIRCLE_POLY_CHECK(4)
+DEFINE_SAT_CIRCLE_POLY_CHECK(6)
+DEFINE_SAT_CIRCLE_POLY_CHECK(8)
 
-        if (maxA < minB || maxB < minA)
-            return 0;
-    }
+typedef int (*SatPolyPolyKernel)(Vector2D *resolveDir, float *depth, const Polygon *polyA, const Polygon *polyB);
+typedef int (*SatCirclePolyKernel)(Vector2D *resolveDir, float *depth, Vector2D center, float radius, const Polygon *poly);
 
-    return 1;
-}
+// Kernel index by vertex count, -1 for the generic path
+static const signed char fixedKernelIndex[9] = { -1, -1, -1, 0, 1, -1, 2, -1, 3 };
 
-int collision_circlePoly(Vector2D *resolveDir, float *depth, Vector2D center, float radius, Polygon poly)
+static const SatPolyPolyKernel satPolyPolyKernels[4][4] =
 {
-    float minA, minB, maxA, maxB;
-    *depth = FLT_MAX;
-    int invertResult = 0;
-    Vector2D edge;
-    Vector2D axis;
+    { satPolyPoly_3_3, satPolyPoly_3_4, satPolyPoly_3_6, satPolyPoly_3_8 },
+    { satPolyPoly_4_3, satPolyPoly_4_4, satPolyPoly_4_6, satPolyPoly_4_8 },
+    { satPolyPoly_6_3, satPolyPoly_6_4, satPolyPoly_6_6, satPolyPoly_6_8 },
+    { satPolyPoly_8_3, satPolyPoly_8_4, satPolyPoly_8_6, satPolyPoly_8_8 },
+};
 
-    int index = findClosestVertexIndex(center, poly);
-    vector2D_dirNormalized(&axis, poly.verts[index], center);
+static const SatCirclePolyKernel satCirclePolyKernels[4] = { satCirclePoly_3, satCirclePoly_4, satCirclePoly_6, satCirclePoly_8 };
 
-    projectCircle(&minA, &maxA, center, radius, axis);
-    projectPoly(&minB, &maxB, poly, axis);
+typedef int (*SatPolyPolyCheckKernel)(const Polygon *polyA, const Polygon *polyB);
+typedef int (*SatCirclePolyCheckKernel)(Vector2D center, float radius, const Polygon *poly);
 
-    if (maxA < minB || maxB < minA)
-        return 0;
+static const SatPolyPolyCheckKernel satPolyPolyCheckKernels[4][4] =
+{
+    { satPolyPolyCheck_3_3, satPolyPolyCheck_3_4, satPolyPolyCheck_3_6, satPolyPolyCheck_3_8 },
+    { satPolyPolyCheck_4_3, satPolyPolyCheck_4_4, satPolyPolyCheck_4_6, satPolyPolyCheck_4_8 },
+    { satPolyPolyCheck_6_3, satPolyPolyCheck_6_4, satPolyPolyCheck_6_6, satPolyPolyCheck_6_8 },
+    { satPolyPolyCheck_8_3, satPolyPolyCheck_8_4, satPolyPolyCheck_8_6, satPolyPolyCheck_8_8 },
+};
 
-    float axisDepth = fminf(maxA - minB, maxB - minA);
-    if (axisDepth < *depth)
-    {
-        *depth = axisDepth;
-        *resolveDir = axis;
-        invertResult = maxB - minA < maxA - minB;
-    }
+static const SatCirclePolyCheckKernel satCirclePolyCheckKernels[4] = { satCirclePolyCheck_3, satCirclePolyCheck_4, satCirclePolyCheck_6, satCirclePolyCheck_8 };
 
-    for (int i = 0; i < poly.count; ++i)
-    {
-        if (poly.normals == NULL)
-        {
-            polyEdge(&edge, poly, i);
+static inline int fixedKernel(int count)
+{
+    return count >= 0 && count <= 8 ? fixedKernelIndex[count] : -1;
+}
 
-            if (edge.x == 0 && edge.y == 0)
-                continue;
+// --- GENERIC SAT ---
 
-            vector2D_leftNormal(&axis, edge);
-            vector2D_normalize(&axis);
-        }
-        else
-        {
-            axis = poly.normals[i];
-        }
-        
-        projectCircle(&minA, &maxA, center, radius, axis);
-        projectPoly(&minB, &maxB, poly, axis);
+// The loops for all other vertex counts, on the same axis and overlap helpers as the kernels
+// above but projecting with projectPolyHinted. Each tests the axes of owner, which is one of
+// the two shapes.
 
-        if (maxA < minB || maxB < minA)
+static inline int satPolyPolyAxes(Vector2D *resolveDir, float *depth, int *invertResult, const Polygon *owner,
+                                  const Polygon *polyA, ProjectionHint *hintA, const Polygon *polyB, ProjectionHint *hintB)
+{
+    float minA, maxA, minB, maxB;
+    Vector2D axis;
+    for (int i = 0; i < axisCount(*owner); ++i)
+    {
+        if (!polyAxis(&axis, *owner, i))
+            continue;
+        projectPolyHinted(&minA, &maxA, *polyA, axis, hintA);
+        projectPolyHinted(&minB, &maxB, *polyB, axis, hintB);
+        if (!satAxis(resolveDir, depth, invertResult, axis, minA, maxA, minB, maxB))
             return 0;
-
-        float axisDepth = fminf(maxA - minB, maxB - minA);
-        if (axisDepth < *depth)
-        {
-            *depth = axisDepth;
-            *resolveDir = axis;
-            invertResult = maxB - minA < maxA - minB;
-        }
     }
+    return 1;
+}
 
-    if (invertResult)
+static inline int satPolyPolyCheckAxes(const Polygon *owner, const Polygon *polyA, ProjectionHint *hintA, const Polygon *polyB, ProjectionHint *hintB)
+{
+    float minA, maxA, minB, maxB;
+    Vector2D axis;
+    for (int i = 0; i < axisCount(*owner); ++i)
     {
-        resolveDir->x *= -1;
-        resolveDir->y *= -1;
+        if (!polyCheckAxis(&axis, *owner, i))
+            continue;
+        projectPolyHinted(&minA, &maxA, *polyA, axis, hintA);
+        projectPolyHinted(&minB, &maxB, *polyB, axis, hintB);
+        if (satSeparated(minA, maxA, minB, maxB))
+            return 0;
     }
-
     return 1;
 }
 
+static inline int satCirclePolyAxes(Vector2D *resolveDir, float *depth, int *invertResult, Vector2D center, float radius, const Polygon *poly, ProjectionHint *hint)
+{
+    float minA, maxA, minB, maxB;
+    Vector2D axis;
+    for (int i = 0; i < axisCount(*poly); ++i)
+    {
+        if (!polyAxis(&axis, *poly, i))
+            continue;
+        projectCircle(&minA, &maxA, center, radius, axis);
+        projectPolyHinted(&minB, &maxB, *poly, axis, hint);
+        if (!satAxis(resolveDir, depth, invertResult, axis, minA, maxA, minB, maxB))
+            return 0;
+    }
+    return 1;
+}
+
+static inline int satCirclePolyCheckAxes(Vector2D center, float radius, const Polygon *poly, ProjectionHint *hint)
+{
+    float minA, maxA, minB, maxB;
+    Vector2D axis;
+    for (int i = 0; i < axisCount(*poly); ++i)
+    {
+        if (!polyCheckAxis(&axis, *poly, i))
+            continue;
+        projectCircle(&minA, &maxA, center, radius, axis);
+        projectPolyHinted(&minB, &maxB, *poly, axis, hint);
+        if (satSeparated(minA, maxA, minB, maxB))
+            return 0;
+    }
+    return 1;
+}
+
+// --- COLLISION ---
+
+int collision_circleCircle_check(Vector2D centerA, float radiusA, Vector2D centerB, float radiusB)
+{
+    STATS_COUNT(STAT_CIRCLE_CIRCLE);
+    float distSqr = square(centerA.x - centerB.x) + square(centerA.y - centerB.y);
+    if (distSqr >= square(radiusA + radiusB))
+        return 0;
+    return 1;
+}
+
+int collision_circleCircle(Vector2D *resolveDir, float *depth, Vector2D centerA, float radiusA, Vector2D centerB, float radiusB)
+{
+    STATS_COUNT(STAT_CIRCLE_CIRCLE);
+    *depth = square(centerA.x - centerB.x) + square(centerA.y - centerB.y);
+    if (*depth >= square(radiusA + radiusB))
+        return 0;
+
+    *depth = sqrtf(*depth);
+    resolveDir->x = (centerB.x - centerA.x) / *depth;
+    resolveDir->y = (centerB.y - centerA.y) / *depth;
+    *depth = radiusA + radiusB - *depth;
+    return 1;
+}
+
+
+int collision_polyPoly_check(Polygon polyA, Polygon polyB)
+{
+    STATS_COUNT(STAT_POLY_POLY);
+    if (boundsApart(polyA, polyB))
+        return 0;
+    if (polyA.parts != NULL || polyB.parts != NULL)
+        return compound_polyPoly(COLLISION_SAT, NULL, NULL, polyA, polyB);
+
+    int kernelA = fixedKernel(polyA.count);
+    int kernelB = fixedKernel(polyB.count);
+    if (kernelA >= 0 && kernelB >= 0)
+        return satPolyPolyCheckKernels[kernelA][kernelB](&polyA, &polyB);
+
+    ProjectionHint hintA = { 0, 0 };
+    ProjectionHint hintB = { 0, 0 };
+    return satPolyPolyCheckAxes(&polyA, &polyA, &hintA, &polyB, &hintB) && satPolyPolyCheckAxes(&polyB, &polyA, &hintA, &polyB, &hintB);
+}
+
+int collision_polyPoly(Vector2D *resolveDir, float *depth, Polygon polyA, Polygon polyB)
+{
+    STATS_COUNT(STAT_POLY_POLY);
+    if (boundsApart(polyA, polyB))
+        return 0;
+    if (polyA.parts != NULL || polyB.parts != NULL)
+        return compound_polyPoly(COLLISION_SAT, resolveDir, depth, polyA, polyB);
+
+    int kernelA = fixedKernel(polyA.count);
+    int kernelB = fixedKernel(polyB.count);
+    if (kernelA >= 0 && kernelB >= 0)
+        return satPolyPolyKernels[kernelA][kernelB](resolveDir, depth, &polyA, &polyB);
+
+    ProjectionHint hintA = { 0, 0 };
+    ProjectionHint hintB = { 0, 0 };
+    int invertResult = 0;
+    *depth = FLT_MAX;
+    if (!satPolyPolyAxes(resolveDir, depth, &invertResult, &polyA, &polyA, &hintA, &polyB, &hintB) ||
+        !satPolyPolyAxes(resolveDir, depth, &invertResult, &polyB, &polyA, &hintA, &polyB, &hintB))
+        return 0;
+    return satResult(resolveDir, invertResult);
+}
+
+int collision_circlePoly_check(Vector2D center, float radius, Polygon poly)
+{
+    STATS_COUNT(STAT_CIRCLE_POLY);
+    if (circleBoundsApart(center, radius, poly))
+        return 0;
+    if (poly.parts != NULL)
+        return compound_circlePoly(COLLISION_SAT, NULL, NULL, center, radius, poly);
+
+    int kernel = fixedKernel(poly.count);
+    if (kernel >= 0)
+        return satCirclePolyCheckKernels[kernel](center, radius, &poly);
+
+    float minA, maxA, minB, maxB;
+    ProjectionHint hint = { 0, 0 };
+    Vector2D axis;
+    circleAxis(&axis, center, &poly);
+    projectCircle(&minA, &maxA, center, radius, axis);
+    projectPolyHinted(&minB, &maxB, poly, axis, &hint);
+    if (satSeparated(minA, maxA, minB, maxB))
+        return 0;
+    return satCirclePolyCheckAxes(center, radius, &poly, &hint);
+}
+
+int collision_circlePoly(Vector2D *resolveDir, float *depth, Vector2D center, float radius, Polygon poly)
+{
+    STATS_COUNT(STAT_CIRCLE_POLY);
+    if (circleBoundsApart(center, radius, poly))
+        return 0;
+    if (poly.parts != NULL)
+        return compound_circlePoly(COLLISION_SAT, resolveDir, depth, center, radius, poly);
+
+    int kernel = fixedKernel(poly.count);
+    if (kernel >= 0)
+        return satCirclePolyKernels[kernel](resolveDir, depth, center, radius, &poly);
+
+    float minA, maxA, minB, maxB;
+    ProjectionHint hint = { 0, 0 };
+    int invertResult = 0;
+    *depth = FLT_MAX;
+    Vector2D axis;
+    circleAxis(&axis, center, &poly);
+    projectCircle(&minA, &maxA, center, radius, axis);
+    projectPolyHinted(&minB, &maxB, poly, axis, &hint);
+    if (!satAxis(resolveDir, depth, &invertResult, axis, minA, maxA, minB, maxB) ||
+        !satCirclePolyAxes(resolveDir, depth, &invertResult, center, radius, &poly, &hint))
+        return 0;
+    return satResult(resolveDir, invertResult);
+}
+
+// --- SWEPT ---
+
+// World space vertex of p furthest along dir
+static Vector2D polySupport(Polygon p, Vector2D dir)
+{
+    Vector2D local = p.transformed ? rotateToLocal(p, dir) : dir;
+    int best = 0;
+    float bestVal = vector2D_dotProduct(local, p.verts[0]);
+    for (int i = 1; i < p.count; ++i)
+    {
+        float val = vector2D_dotProduct(local, p.verts[i]);
+        if (val > bestVal)
+        {
+            bestVal = val;
+            best = i;
+        }
+    }
+
+    Vector2D result;
+    polygon_getVertex(&result, p, best);
+    return result;
+}
+
+// Cheap rejection of the bounds swept along move against the cached bounds of target
+static inline int sweptBoundsApart(AABB bounds, Vector2D move, Polygon target)
+{
+    if (target.dirty)
+        return 0;
+
+    if (move.x < 0)
+        bounds.minX += move.x;
+    else
+        bounds.maxX += move.x;
+    if (move.y < 0)
+        bounds.minY += move.y;
+    else
+        bounds.maxY += move.y;
+    return !aabb_overlaps(bounds, target.bounds);
+}
+
+// Narrows [tEnter, tExit], the time interval in which A moving with speed along axis
+// overlaps B on this axis. Returns 0 if they never overlap (on this axis or at all).
+static int sweepAxis(float *tEnter, float *tExit, Vector2D *normal, Vector2D axis, float speed,
+        float minA, float maxA, float minB, float maxB)
+{
+    if (speed == 0)
+        return !(maxA < minB || maxB < minA);
+
+    float enter, exit;
+    if (speed > 0)
+    {
+        enter = (minB - maxA) / speed;
+        exit = (maxB - minA) / speed;
+    }
+    else
+    {
+        enter = (maxB - minA) / speed;
+        exit = (minB - maxA) / speed;
+        axis.x = -axis.x;
+        axis.y = -axis.y;
+    }
+
+    if (enter > *tEnter)
+    {
+        *tEnter = enter;
+        *normal = axis;
+    }
+    if (exit < *tExit)
+        *tExit = exit;
+
+    return *tEnter <= *tExit;
+}
+
+int collision_circlePoly_swept(SweepResult *result, Vector2D center, float radius, Vector2D move, Polygon poly)
+{
+    STATS_COUNT(STAT_SWEPT);
+    AABB bounds;
+    aabb_fromCircle(&bounds, center, radius);
+    if (sweptBoundsApart(bounds, move, poly))
+        return 0;
+
+    Vector2D resolveDir;
+    float depth;
+    if (collision_circlePoly(&resolveDir, &depth, center, radius, poly))
+    {
+        result->toi = 0;
+        result->normal = resolveDir;
+        result->point.x = center.x + resolveDir.x * (radius - depth);
+        result->point.y = center.y + resolveDir.y * (radius - depth);
+        return 1;
+    }
+
+    // Moving the center as a ray against the polygon grown by radius: the edges moved
+    // outwards by radius plus circles of radius around the vertices.
+    float best = FLT_MAX;
+    float moveSqr = vector2D_lengthSquared(move);
+    if (moveSqr == 0)
+        return 0;
+
+    for (int i = 0; i < poly.count; ++i)
+    {
+        Vector2D a, b;
+        polygon_getVertex(&a, poly, i);
+        polygon_getVertex(&b, poly, (i + 1) % poly.count);
+
+        Vector2D toCenter = { .x = center.x - a.x, .y = center.y - a.y };
+
+        // vertex
+        float proj = vector2D_dotProduct(toCenter, move);
+        float c = vector2D_lengthSquared(toCenter) - square(radius);
+        float disc = square(proj) - moveSqr * c;
+        if (proj < 0 && c >= 0 && disc >= 0)
+        {
+            float t = (-proj - sqrtf(disc)) / moveSqr;
+            if (t < best)
+            {
+                best = t;
+                result->point = a;
+                result->normal.x = a.x - (center.x + move.x * t);
+                result->normal.y = a.y - (center.y + move.y * t);
+            }
+        }
+
+        // edge, tested from whichever side the center starts on
+        Vector2D edge = { .x = b.x - a.x, .y = b.y - a.y };
+        float edgeSqr = vector2D_lengthSquared(edge);
+        if (edgeSqr == 0)
+            continue;
+
+        Vector2D n;
+        vector2D_leftNormal(&n, edge);
+        vector2D_normalize(&n);
+        float dist = vector2D_dotProduct(toCenter, n);
+        if (dist < 0)
+        {
+            n.x = -n.x;
+            n.y = -n.y;
+            dist = -dist;
+        }
+        float speed = vector2D_dotProduct(move, n);
+        // starting closer than radius to the edge line is handled by the vertex circles
+        if (speed >= 0 || dist < radius)
+            continue;
+
+        float t = (dist - radius) / -speed;
+        if (t >= best)
+            continue;
+
+        Vector2D hit = { .x = center.x + move.x * t - n.x * radius, .y = center.y + move.y * t - n.y * radius };
+        float s = (hit.x - a.x) * edge.x + (hit.y - a.y) * edge.y;
+        if (s < 0 || s > edgeSqr)
+            continue;
+
+        best = t;
+        result->point = hit;
+        result->normal.x = -n.x;
+        result->normal.y = -n.y;
+    }
+
+    if (best > 1)
+        return 0;
+
+    result->toi = best;
+    vector2D_normalize(&result->normal);
+    return 1;
+}
+
+int collision_polyPoly_swept(SweepResult *result, Polygon polyA, Vector2D move, Polygon polyB)
+{
+    STATS_COUNT(STAT_SWEPT);
+    if (!polyA.dirty && sweptBoundsApart(polyA.bounds, move, polyB))
+        return 0;
+
+    float minA, minB, maxA, maxB;
+    ProjectionHint hintA = { 0, 0 };
+    ProjectionHint hintB = { 0, 0 };
+    float tEnter = -FLT_MAX;
+    float tExit = FLT_MAX;
+    Vector2D normal = { 0, 0 };
+    Vector2D axis;
+
+    for (int i = 0; i < axisCount(polyA); ++i)
+    {
+        if (!polyAxis(&axis, polyA, i))
+            continue;
+
+        projectPolyHinted(&minA, &maxA, polyA, axis, &hintA);
+        projectPolyHinted(&minB, &maxB, polyB, axis, &hintB);
+        if (!sweepAxis(&tEnter, &tExit, &normal, axis, vector2D_dotProduct(move, axis), minA, maxA, minB, maxB))
+            return 0;
+    }
+    float tEnterA = tEnter;
+    for (int i = 0; i < axisCount(polyB); ++i)
+    {
+        if (!polyAxis(&axis, polyB, i))
+            continue;
+
+        projectPolyHinted(&minA, &maxA, polyA, axis, &hintA);
+        projectPolyHinted(&minB, &maxB, polyB, axis, &hintB);
+        if (!sweepAxis(&tEnter, &tExit, &normal, axis, vector2D_dotProduct(move, axis), minA, maxA, minB, maxB))
+            return 0;
+    }
+    // the last axis to start overlapping decides which polygon's face is hit
+    int faceB = tEnter > tEnterA;
+
+    if (tEnter > 1 || tExit < 0)
+        return 0;
+
+    if (tEnter <= 0)
+    {
+        float depth;
+        if (!collision_polyPoly(&normal, &depth, polyA, polyB))
+            return 0;
+        tEnter = 0;
+        faceB = 1;
+    }
+
+    result->toi = tEnter;
+    result->normal = normal;
+    if (faceB)
+    {
+        // face of polyB hit by the leading vertex of polyA
+        result->point = polySupport(polyA, normal);
+        result->point.x += move.x * tEnter;
+        result->point.y += move.y * tEnter;
+    }
+    else
+    {
+        // face of polyA hits the leading vertex of polyB
+        Vector2D back = { .x = -normal.x, .y = -normal.y };
+        result->point = polySupport(polyB, back);
+    }
+    return 1;
+}
+
+// --- RAYCAST ---
+
+static inline float cross(Vector2D a, Vector2D b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+static void rayStartsInside(RayHit *hit, Vector2D origin, Vector2D dir)
+{
+    hit->t = 0;
+    hit->point = origin;
+    hit->normal.x = -dir.x;
+    hit->normal.y = -dir.y;
+    vector2D_normalize(&hit->normal);
+}
+
+int collision_rayCircle(RayHit *hit, Vector2D origin, Vector2D dir, float maxT, Vector2D center, float radius)
+{
+    STATS_COUNT(STAT_RAY);
+    Vector2D m = { .x = origin.x - center.x, .y = origin.y - center.y };
+    float c = vector2D_lengthSquared(m) - square(radius);
+    if (c <= 0)
+    {
+        rayStartsInside(hit, origin, dir);
+        return 1;
+    }
+
+    float b = vector2D_dotProduct(m, dir);
+    if (b >= 0)
+        return 0;
+
+    float a = vector2D_lengthSquared(dir);
+    float disc = square(b) - a * c;
+    if (disc < 0)
+        return 0;
+
+    float t = (-b - sqrtf(disc)) / a;
+    if (t > maxT)
+        return 0;
+
+    hit->t = t;
+    hit->point.x = origin.x + dir.x * t;
+    hit->point.y = origin.y + dir.y * t;
+    hit->normal.x = (hit->point.x - center.x) / radius;
+    hit->normal.y = (hit->point.y - center.y) / radius;
+    return 1;
+}
+
+// A ray is a swept point, so it enters a convex polygon when it has entered the slabs of all SAT axes
+static int rayConvexPoly(RayHit *hit, Vector2D origin, Vector2D dir, float maxT, Polygon poly)
+{
+    float minB, maxB;
+    ProjectionHint hint = { 0, 0 };
+    float tEnter = -FLT_MAX;
+    float tExit = FLT_MAX;
+    Vector2D normal = { 0, 0 };
+    Vector2D axis;
+
+    for (int i = 0; i < axisCount(poly); ++i)
+    {
+        if (!polyAxis(&axis, poly, i))
+            continue;
+
+        projectPolyHinted(&minB, &maxB, poly, axis, &hint);
+        float pos = vector2D_dotProduct(origin, axis);
+        if (!sweepAxis(&tEnter, &tExit, &normal, axis, vector2D_dotProduct(dir, axis), pos, pos, minB, maxB))
+            return 0;
+    }
+
+    if (tExit < 0 || tEnter > maxT)
+        return 0;
+
+    if (tEnter <= 0)
+    {
+        rayStartsInside(hit, origin, dir);
+        return 1;
+    }
+
+    hit->t = tEnter;
+    hit->point.x = origin.x + dir.x * tEnter;
+    hit->point.y = origin.y + dir.y * tEnter;
+    // sweepAxis orients the axis along the movement
+    hit->normal.x = -normal.x;
+    hit->normal.y = -normal.y;
+    return 1;
+}
+
+static int rayEdges(RayHit *hit, Vector2D origin, Vector2D dir, float maxT, Polygon poly)
+{
+    float best = FLT_MAX;
+    int inside = 0;
+    Vector2D normal = { 0, 0 };
+
+    for (int i = 0; i < poly.count; ++i)
+    {
+        Vector2D a, b;
+        polygon_getVertex(&a, poly, i);
+        polygon_getVertex(&b, poly, (i + 1) % poly.count);
+        Vector2D edge = { .x = b.x - a.x, .y = b.y - a.y };
+
+        // crossing number, to detect rays starting inside
+        if ((a.y > origin.y) != (b.y > origin.y) && origin.x < a.x + (origin.y - a.y) * edge.x / edge.y)
+            inside = !inside;
+
+        float denom = cross(dir, edge);
+        if (denom == 0)
+            continue;
+
+        Vector2D toEdge = { .x = a.x - origin.x, .y = a.y - origin.y };
+        float t = cross(toEdge, edge) / denom;
+        float s = cross(toEdge, dir) / denom;
+        if (t < 0 || t > maxT || t >= best || s < 0 || s > 1)
+            continue;
+
+        best = t;
+        vector2D_leftNormal(&normal, edge);
+    }
+
+    if (inside)
+    {
+        rayStartsInside(hit, origin, dir);
+        return 1;
+    }
+    if (best == FLT_MAX)
+        return 0;
+
+    vector2D_normalize(&normal);
+    if (vector2D_dotProduct(normal, dir) > 0)
+    {
+        normal.x = -normal.x;
+        normal.y = -normal.y;
+    }
+    hit->t = best;
+    hit->normal = normal;
+    hit->point.x = origin.x + dir.x * best;
+    hit->point.y = origin.y + dir.y * best;
+    return 1;
+}
+
+int collision_rayPoly(RayHit *hit, Vector2D origin, Vector2D dir, float maxT, Polygon poly)
+{
+    STATS_COUNT(STAT_RAY);
+    if (dir.x == 0 && dir.y == 0)
+        return 0;
+
+    float tEnter;
+    if (!poly.dirty && !aabb_raycast(&tEnter, poly.bounds, origin, dir, maxT))
+        return 0;
+
+    if (poly.convex)
+        return rayConvexPoly(hit, origin, dir, maxT, poly);
+    return rayEdges(hit, origin, dir, maxT, poly);
+}
+
+// --- CONTACT MANIFOLD ---
+
+typedef struct
+{
+    Vector2D a;
+    Vector2D b;
+    Vector2D deepest;
+} ClipEdge;
+
+// Of the two edges at the vertex furthest along normal, the one most perpendicular to normal
+static ClipEdge bestEdge(Polygon poly, Vector2D normal)
+{
+    int best = 0;
+    float bestDist = -FLT_MAX;
+    Vector2D v;
+    for (int i = 0; i < poly.count; ++i)
+    {
+        polygon_getVertex(&v, poly, i);
+        float dist = vector2D_dotProduct(v, normal);
+        if (dist > bestDist)
+        {
+            bestDist = dist;
+            best = i;
+        }
+    }
+
+    Vector2D prev, next;
+    polygon_getVertex(&v, poly, best);
+    polygon_getVertex(&prev, poly, (best + poly.count - 1) % poly.count);
+    polygon_getVertex(&next, poly, (best + 1) % poly.count);
+
+    Vector2D toPrev = { .x = v.x - prev.x, .y = v.y - prev.y };
+    Vector2D toNext = { .x = v.x - next.x, .y = v.y - next.y };
+    vector2D_normalize(&toPrev);
+    vector2D_normalize(&toNext);
+
+    ClipEdge edge = { .deepest = v };
+    if (vector2D_dotProduct(toPrev, normal) <= vector2D_dotProduct(toNext, normal))
+    {
+        edge.a = prev;
+        edge.b = v;
+    }
+    else
+    {
+        edge.a = v;
+        edge.b = next;
+    }
+    return edge;
+}
+
+// Keeps the part of segment p0-p1 with dot(dir, p) >= offset, returns the number of points written
+static int clipSegment(Vector2D *out, Vector2D p0, Vector2D p1, Vector2D dir, float offset)
+{
+    int count = 0;
+    float d0 = vector2D_dotProduct(dir, p0) - offset;
+    float d1 = vector2D_dotProduct(dir, p1) - offset;
+
+    if (d0 >= 0)
+        out[count++] = p0;
+    if (d1 >= 0)
+        out[count++] = p1;
+    if (d0 * d1 < 0)
+    {
+        float t = d0 / (d0 - d1);
+        out[count].x = p0.x + (p1.x - p0.x) * t;
+        out[count].y = p0.y + (p1.y - p0.y) * t;
+        ++count;
+    }
+    return count;
+}
+
+int collision_polyPoly_manifold(ContactManifold *manifold, Polygon polyA, Polygon polyB)
+{
+    STATS_COUNT(STAT_MANIFOLD);
+    if (!collision_polyPoly(&manifold->normal, &manifold->depth, polyA, polyB))
+        return 0;
+
+    Vector2D normal = manifold->normal;
+    Vector2D flipped = { .x = -normal.x, .y = -normal.y };
+    ClipEdge edgeA = bestEdge(polyA, normal);
+    ClipEdge edgeB = bestEdge(polyB, flipped);
+
+    // the reference edge is the one more perpendicular to the normal, refNormal points out of it
+    Vector2D dirA = { .x = edgeA.b.x - edgeA.a.x, .y = edgeA.b.y - edgeA.a.y };
+    Vector2D dirB = { .x = edgeB.b.x - edgeB.a.x, .y = edgeB.b.y - edgeB.a.y };
+    vector2D_normalize(&dirA);
+    vector2D_normalize(&dirB);
+
+    ClipEdge ref, inc;
+    Vector2D refDir, refNormal;
+    if (fabsf(vector2D_dotProduct(dirA, normal)) <= fabsf(vector2D_dotProduct(dirB, normal)))
+    {
+        ref = edgeA;
+        inc = edgeB;
+        refDir = dirA;
+        refNormal = normal;
+    }
+    else
+    {
+        ref = edgeB;
+        inc = edgeA;
+        refDir = dirB;
+        refNormal = flipped;
+    }
+
+    // clip the incident edge to the side planes of the reference edge
+    Vector2D clipped[2];
+    Vector2D clipped2[2];
+    Vector2D back = { .x = -refDir.x, .y = -refDir.y };
+    int count = clipSegment(clipped, inc.a, inc.b, refDir, vector2D_dotProduct(refDir, ref.a));
+    if (count == 2)
+        count = clipSegment(clipped2, clipped[0], clipped[1], back, -vector2D_dotProduct(refDir, ref.b));
+    else
+        count = 0;
+
+    // exact face normal of the reference edge, oriented like the collision normal
+    Vector2D faceNormal;
+    vector2D_leftNormal(&faceNormal, refDir);
+    if (vector2D_dotProduct(faceNormal, refNormal) < 0)
+    {
+        faceNormal.x = -faceNormal.x;
+        faceNormal.y = -faceNormal.y;
+    }
+    float faceDist = vector2D_dotProduct(faceNormal, ref.deepest);
+
+    manifold->pointCount = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        float depth = faceDist - vector2D_dotProduct(faceNormal, clipped2[i]);
+        if (depth < 0)
+            continue;
+        manifold->points[manifold->pointCount] = clipped2[i];
+        manifold->depths[manifold->pointCount] = depth;
+        ++manifold->pointCount;
+    }
+
+    // clipping failed numerically (e.g. degenerate edges), fall back to the deepest incident vertex
+    if (manifold->pointCount == 0)
+    {
+        manifold->points[0] = inc.deepest;
+        manifold->depths[0] = manifold->depth;
+        manifold->pointCount = 1;
+    }
+
+    return 1;
+}
+
+// --- PRIMITIVES ---
+
+int collision_aabbAABB(Vector2D *resolveDir, float *depth, AABB boxA, AABB boxB)
+{
+    STATS_COUNT(STAT_PRIMITIVE);
+    // how far B has to move right/left and up/down to get out, like the SAT functions
+    float right = boxA.maxX - boxB.minX;
+    float left = boxB.maxX - boxA.minX;
+    float down = boxA.maxY - boxB.minY;
+    float up = boxB.maxY - boxA.minY;
+    if (right <= 0 || left <= 0 || down <= 0 || up <= 0)
+        return 0;
+
+    float depthX = fminf(right, left);
+    float depthY = fminf(down, up);
+    if (depthX <= depthY)
+    {
+        resolveDir->x = right <= left ? 1.0f : -1.0f;
+        resolveDir->y = 0;
+        *depth = depthX;
+    }
+    else
+    {
+        resolveDir->x = 0;
+        resolveDir->y = down <= up ? 1.0f : -1.0f;
+        *depth = depthY;
+    }
+    return 1;
+}
+
+int collision_aabbCircle(Vector2D *resolveDir, float *depth, AABB box, Vector2D center, float radius)
+{
+    STATS_COUNT(STAT_PRIMITIVE);
+    Vector2D closest = {
+        .x = fminf(fmaxf(center.x, box.minX), box.maxX),
+        .y = fminf(fmaxf(center.y, box.minY), box.maxY)
+    };
+    Vector2D diff = { .x = center.x - closest.x, .y = center.y - closest.y };
+    float distSq = vector2D_lengthSquared(diff);
+
+    if (distSq > 0)
+    {
+        if (distSq >= square(radius))
+            return 0;
+
+        float dist = sqrtf(distSq);
+        resolveDir->x = diff.x / dist;
+        resolveDir->y = diff.y / dist;
+        *depth = radius - dist;
+        return 1;
+    }
+
+    // center inside the box, push out through the closest side
+    float left = center.x - box.minX;
+    float right = box.maxX - center.x;
+    float top = center.y - box.minY;
+    float bottom = box.maxY - center.y;
+    float minDist = fminf(fminf(left, right), fminf(top, bottom));
+
+    resolveDir->x = 0;
+    resolveDir->y = 0;
+    if (minDist == left)
+        resolveDir->x = -1.0f;
+    else if (minDist == right)
+        resolveDir->x = 1.0f;
+    else if (minDist == top)
+        resolveDir->y = -1.0f;
+    else
+        resolveDir->y = 1.0f;
+    *depth = minDist + radius;
+    return 1;
+}
+
+// Point on segment a-b closest to p
+static Vector2D closestOnSegment(Vector2D p, Vector2D a, Vector2D b)
+{
+    Vector2D ab = { .x = b.x - a.x, .y = b.y - a.y };
+    float lengthSq = vector2D_lengthSquared(ab);
+    float t = 0;
+    if (lengthSq > 0)
+    {
+        Vector2D ap = { .x = p.x - a.x, .y = p.y - a.y };
+        t = fminf(fmaxf(vector2D_dotProduct(ap, ab) / lengthSq, 0), 1);
+    }
+    Vector2D result = { .x = a.x + ab.x * t, .y = a.y + ab.y * t };
+    return result;
+}
+
+// Closest points of the segments a1-b1 and a2-b2 (Ericson, Real-Time Collision Detection 5.1.9)
+static void closestSegmentSegment(Vector2D *c1, Vector2D *c2, Vector2D a1, Vector2D b1, Vector2D a2, Vector2D b2)
+{
+    Vector2D d1 = { .x = b1.x - a1.x, .y = b1.y - a1.y };
+    Vector2D d2 = { .x = b2.x - a2.x, .y = b2.y - a2.y };
+    Vector2D r = { .x = a1.x - a2.x, .y = a1.y - a2.y };
+    float a = vector2D_lengthSquared(d1);
+    float e = vector2D_lengthSquared(d2);
+    float f = vector2D_dotProduct(d2, r);
+    float s, t;
+
+    if (a == 0 && e == 0)
+    {
+        s = t = 0;
+    }
+    else if (a == 0)
+    {
+        s = 0;
+        t = fminf(fmaxf(f / e, 0), 1);
+    }
+    else
+    {
+        float c = vector2D_dotProduct(d1, r);
+        if (e == 0)
+        {
+            t = 0;
+            s = fminf(fmaxf(-c / a, 0), 1);
+        }
+        else
+        {
+            float b = vector2D_dotProduct(d1, d2);
+            float denom = a * e - b * b;
+            s = denom != 0 ? fminf(fmaxf((b * f - c * e) / denom, 0), 1) : 0;
+            t = (b * s + f) / e;
+            if (t < 0)
+            {
+                t = 0;
+                s = fminf(fmaxf(-c / a, 0), 1);
+            }
+            else if (t > 1)
+            {
+                t = 1;
+                s = fminf(fmaxf((b - c) / a, 0), 1);
+            }
+        }
+    }
+
+    c1->x = a1.x + d1.x * s;
+    c1->y = a1.y + d1.y * s;
+    c2->x = a2.x + d2.x * t;
+    c2->y = a2.y + d2.y * t;
+}
+
+int collision_capsuleCircle(Vector2D *resolveDir, float *depth, Capsule capsule, Vector2D center, float radius)
+{
+    STATS_COUNT(STAT_PRIMITIVE);
+    Vector2D closest = closestOnSegment(center, capsule.a, capsule.b);
+    if (closest.x != center.x || closest.y != center.y)
+        return collision_circleCircle(resolveDir, depth, closest, capsule.radius, center, radius);
+
+    // center on the capsule axis, push out sideways
+    Vector2D axis = { .x = capsule.b.x - capsule.a.x, .y = capsule.b.y - capsule.a.y };
+    if (axis.x == 0 && axis.y == 0)
+        axis.x = 1.0f;
+    vector2D_leftNormal(resolveDir, axis);
+    vector2D_normalize(resolveDir);
+    *depth = capsule.radius + radius;
+    return 1;
+}
+
+int collision_capsuleCapsule(Vector2D *resolveDir, float *depth, Capsule capsuleA, Capsule capsuleB)
+{
+    STATS_COUNT(STAT_PRIMITIVE);
+    Vector2D dirA = { .x = capsuleA.b.x - capsuleA.a.x, .y = capsuleA.b.y - capsuleA.a.y };
+    Vector2D dirB = { .x = capsuleB.b.x - capsuleB.a.x, .y = capsuleB.b.y - capsuleB.a.y };
+    Vector2D toA1 = { .x = capsuleA.a.x - capsuleB.a.x, .y = capsuleA.a.y - capsuleB.a.y };
+    Vector2D toA2 = { .x = capsuleA.b.x - capsuleB.a.x, .y = capsuleA.b.y - capsuleB.a.y };
+    Vector2D toB1 = { .x = capsuleB.a.x - capsuleA.a.x, .y = capsuleB.a.y - capsuleA.a.y };
+    Vector2D toB2 = { .x = capsuleB.b.x - capsuleA.a.x, .y = capsuleB.b.y - capsuleA.a.y };
+    int crossing = cross(dirB, toA1) * cross(dirB, toA2) < 0 && cross(dirA, toB1) * cross(dirA, toB2) < 0;
+
+    // with separate axes the closest points give the exact penetration
+    if (!crossing)
+    {
+        Vector2D closestA, closestB;
+        closestSegmentSegment(&closestA, &closestB, capsuleA.a, capsuleA.b, capsuleB.a, capsuleB.b);
+        if (closestA.x != closestB.x || closestA.y != closestB.y)
+            return collision_circleCircle(resolveDir, depth, closestA, capsuleA.radius, closestB, capsuleB.radius);
+    }
+
+    // crossing (or touching) axes, the closest points do not give a direction
+    Vector2D pointsA[2] = { capsuleA.a, capsuleA.b };
+    Vector2D pointsB[2] = { capsuleB.a, capsuleB.b };
+    SupportShape shapeA, shapeB;
+    supportShape_fromPoints(&shapeA, pointsA, 2, capsuleA.radius);
+    supportShape_fromPoints(&shapeB, pointsB, 2, capsuleB.radius);
+    return gjk_collide(resolveDir, depth, shapeA, shapeB);
+}
+
+// SAT with only two projections for the segment and one extra axis
+int collision_segmentPoly(Vector2D *resolveDir, float *depth, Segment segment, Polygon poly)
+{
+    STATS_COUNT(STAT_PRIMITIVE);
+    if (!poly.dirty)
+    {
+        AABB bounds;
+        aabb_fromCapsule(&bounds, segment.a, segment.b, 0);
+        if (!aabb_overlaps(bounds, poly.bounds))
+            return 0;
+    }
+    if (poly.parts != NULL)
+        return compound_segmentPoly(resolveDir, depth, segment, poly);
+
+    float minB, maxB;
+    ProjectionHint hint = { 0, 0 };
+    *depth = FLT_MAX;
+    int invertResult = 0;
+    Vector2D axis;
+    Vector2D edge = { .x = segment.b.x - segment.a.x, .y = segment.b.y - segment.a.y };
+
+    for (int i = -1; i < axisCount(poly); ++i)
+    {
+        if (i < 0)
+        {
+            // segment normal
+            if (edge.x == 0 && edge.y == 0)
+                continue;
+            vector2D_leftNormal(&axis, edge);
+            vector2D_normalize(&axis);
+        }
+        else if (!polyAxis(&axis, poly, i))
+        {
+            continue;
+        }
+
+        float projA = vector2D_dotProduct(segment.a, axis);
+        float projB = vector2D_dotProduct(segment.b, axis);
+        float minA = fminf(projA, projB);
+        float maxA = fmaxf(projA, projB);
+        projectPolyHinted(&minB, &maxB, poly, axis, &hint);
+
+        STATS_COUNT(STAT_SAT_AXES);
+        if (maxA < minB || maxB < minA)
+        {
+            STATS_COUNT(STAT_AXIS_EXITS);
+            return 0;
+        }
+
+        float axisDepth = fminf(maxA - minB, maxB - minA);
+        if (axisDepth < *depth)
+        {
+            *depth = axisDepth;
+            *resolveDir = axis;
+            invertResult = maxB - minA < maxA - minB;
+        }
+    }
+
+    if (invertResult)
+    {
+        resolveDir->x *= -1;
+        resolveDir->y *= -1;
+    }
+    return 1;
+}
+
+// --- GJK ---
+
+int collision_polyPoly_gjk_check(Polygon polyA, Polygon polyB)
+{
+    STATS_COUNT(STAT_GJK);
+    if (boundsApart(polyA, polyB))
+        return 0;
+    if (polyA.parts != NULL || polyB.parts != NULL)
+        return compound_polyPoly(COLLISION_GJK, NULL, NULL, polyA, polyB);
+
+    SupportShape a, b;
+    supportShape_fromPoly(&a, polyA);
+    supportShape_fromPoly(&b, polyB);
+    return gjk_check(a, b);
+}
+
+int collision_circlePoly_gjk_check(Vector2D center, float radius, Polygon poly)
+{
+    STATS_COUNT(STAT_GJK);
+    if (circleBoundsApart(center, radius, poly))
+        return 0;
+    if (poly.parts != NULL)
+        return compound_circlePoly(COLLISION_GJK, NULL, NULL, center, radius, poly);
+
+    SupportShape a, b;
+    supportShape_fromCircle(&a, center, radius);
+    supportShape_fromPoly(&b, poly);
+    return gjk_check(a, b);
+}
+
+int collision_polyPoly_gjk(Vector2D *resolveDir, float *depth, Polygon polyA, Polygon polyB)
+{
+    STATS_COUNT(STAT_GJK);
+    if (boundsApart(polyA, polyB))
+        return 0;
+    if (polyA.parts != NULL || polyB.parts != NULL)
+        return compound_polyPoly(COLLISION_GJK, resolveDir, depth, polyA, polyB);
+
+    SupportShape a, b;
+    supportShape_fromPoly(&a, polyA);
+    supportShape_fromPoly(&b, polyB);
+    return gjk_collide(resolveDir, depth, a, b);
+}
+
+int collision_circlePoly_gjk(Vector2D *resolveDir, float *depth, Vector2D center, float radius, Polygon poly)
+{
+    STATS_COUNT(STAT_GJK);
+    if (circleBoundsApart(center, radius, poly))
+        return 0;
+    if (poly.parts != NULL)
+        return compound_circlePoly(COLLISION_GJK, resolveDir, depth, center, radius, poly);
+
+    SupportShape a, b;
+    supportShape_fromCircle(&a, center, radius);
+    supportShape_fromPoly(&b, poly);
+    return gjk_collide(resolveDir, depth, a, b);
+}
+
+static inline int polyPolyWith(CollisionMethod method, Vector2D *resolveDir, float *depth, Polygon polyA, Polygon polyB)
+{
+    if (method == COLLISION_GJK)
+        return collision_polyPoly_gjk(resolveDir, depth, polyA, polyB);
+    return collision_polyPoly(resolveDir, depth, polyA, polyB);
+}
+
+static inline int circlePolyWith(CollisionMethod method, Vector2D *resolveDir, float *depth, Vector2D center, float radius, Polygon poly)
+{
+    if (method == COLLISION_GJK)
+        return collision_circlePoly_gjk(resolveDir, depth, center, radius, poly);
+    return collision_circlePoly(resolveDir, depth, center, radius, poly);
+}
+
+// --- COMPOUND ---
+
+// Overlapping pairs kept per call, the deepest ones if more parts overlap
+#define COMPOUND_MAX_RESULTS 16
+
+typedef enum
+{
+    COMPOUND_POLY,
+    COMPOUND_CIRCLE,
+    COMPOUND_SEGMENT
+} CompoundKind;
+
+// The shapes of one call and the pairs of parts that overlap (part -1: the shape itself)
+typedef struct
+{
+    CompoundKind kind;
+    Polygon polyA;
+    Vector2D center;
+    float radius;
+    Segment segment;
+    Polygon polyB;
+
+    Vector2D dirs[COMPOUND_MAX_RESULTS];
+    float depths[COMPOUND_MAX_RESULTS];
+    int partsA[COMPOUND_MAX_RESULTS];
+    int partsB[COMPOUND_MAX_RESULTS];
+    int count;
+} CompoundResult;
+
+// A part as seen through the current transform of its polygon, which might not have
+// been passed to the parts yet (see polygon_updateCache)
+static inline Polygon compoundPart(Polygon poly, int index)
+{
+    if (index < 0)
+        return poly;
+
+    Polygon part = poly.parts[index];
+    part.transformed = poly.transformed;
+    part.position = poly.position;
+    part.rotation = poly.rotation;
+    part.cosRot = poly.cosRot;
+    part.sinRot = poly.sinRot;
+    if (poly.dirty)
+        part.dirty |= POLY_DIRTY_BOUNDS;
+    return part;
+}
+
+static void compound_add(CompoundResult *result, int partA, int partB, Vector2D resolveDir, float depth)
+{
+    int index = result->count;
+    if (index == COMPOUND_MAX_RESULTS)
+    {
+        index = 0;
+        for (int i = 1; i < result->count; ++i)
+        {
+            if (result->depths[i] < result->depths[index])
+                index = i;
+        }
+        if (result->depths[index] >= depth)
+            return;
+    }
+    else
+    {
+        ++result->count;
+    }
+    result->dirs[index] = resolveDir;
+    result->depths[index] = depth;
+    result->partsA[index] = partA;
+    result->partsB[index] = partB;
+}
+
+// How far the second part has to move along dir to separate the pair
+static float compound_overlap(const CompoundResult *result, int index, Vector2D dir)
+{
+    float minA, maxA, minB, maxB;
+    ProjectionHint hint = { 0, 0 };
+    if (result->kind == COMPOUND_POLY)
+    {
+        projectPolyHinted(&minA, &maxA, compoundPart(result->polyA, result->partsA[index]), dir, &hint);
+        hint.min = hint.max = 0;
+    }
+    else if (result->kind == COMPOUND_CIRCLE)
+    {
+        projectCircle(&minA, &maxA, result->center, result->radius, dir);
+    }
+    else
+    {
+        maxA = fmaxf(vector2D_dotProduct(result->segment.a, dir), vector2D_dotProduct(result->segment.b, dir));
+    }
+    projectPolyHinted(&minB, &maxB, compoundPart(result->polyB, result->partsB[index]), dir, &hint);
+    return maxA - minB;
+}
+
+// One direction for all overlapping pairs: of the directions of the pairs and their depth
+// weighted average, the one that separates every pair with the shortest move
+static int compound_merge(Vector2D *resolveDir, float *depth, const CompoundResult *result)
+{
+    if (result->count == 0)
+        return 0;
+
+    *resolveDir = result->dirs[0];
+    *depth = result->depths[0];
+    if (result->count == 1)
+        return 1;
+
+    Vector2D average = { 0, 0 };
+    for (int i = 0; i < result->count; ++i)
+    {
+        average.x += result->dirs[i].x * result->depths[i];
+        average.y += result->dirs[i].y * result->depths[i];
+    }
+    int hasAverage = vector2D_lengthSquared(average) > 0;
+    if (hasAverage)
+        vector2D_normalize(&average);
+
+    *depth = FLT_MAX;
+    for (int c = 0; c <= result->count; ++c)
+    {
+        Vector2D dir = c < result->count ? result->dirs[c] : average;
+        if (c == result->count && !hasAverage)
+            break;
+
+        float needed = 0;
+        for (int i = 0; i < result->count && needed < *depth; ++i)
+            needed = fmaxf(needed, compound_overlap(result, i, dir));
+
+        if (needed < *depth)
+        {
+            *resolveDir = dir;
+            *depth = needed;
+        }
+    }
+    return 1;
+}
+
+// resolveDir NULL: only test for overlap
+static int compound_polyPoly(CollisionMethod method, Vector2D *resolveDir, float *depth, Polygon polyA, Polygon polyB)
+{
+    CompoundResult result = { .kind = COMPOUND_POLY, .polyA = polyA, .polyB = polyB, .count = 0 };
+    int countA = polyA.parts != NULL ? polyA.partCount : 1;
+    int countB = polyB.parts != NULL ? polyB.partCount : 1;
+
+    for (int i = 0; i < countA; ++i)
+    {
+        int indexA = polyA.parts != NULL ? i : -1;
+        Polygon partA = compoundPart(polyA, indexA);
+        if (!partA.dirty && !polyB.dirty && !aabb_overlaps(partA.bounds, polyB.bounds))
+            continue;
+
+        for (int k = 0; k < countB; ++k)
+        {
+            int indexB = polyB.parts != NULL ? k : -1;
+            Polygon partB = compoundPart(polyB, indexB);
+            STATS_COUNT(STAT_COMPOUND_PARTS);
+            if (resolveDir == NULL)
+            {
+                int hit = method == COLLISION_GJK ? collision_polyPoly_gjk_check(partA, partB) : collision_polyPoly_check(partA, partB);
+                if (hit)
+                    return 1;
+                continue;
+            }
+
+            Vector2D partDir;
+            float partDepth;
+            if (polyPolyWith(method, &partDir, &partDepth, partA, partB))
+                compound_add(&result, indexA, indexB, partDir, partDepth);
+        }
+    }
+
+    return compound_merge(resolveDir, depth, &result);
+}
+
+static int compound_circlePoly(CollisionMethod method, Vector2D *resolveDir, float *depth, Vector2D center, float radius, Polygon poly)
+{
+    CompoundResult result = { .kind = COMPOUND_CIRCLE, .center = center, .radius = radius, .polyB = poly, .count = 0 };
+    for (int i = 0; i < poly.partCount; ++i)
+    {
+        Polygon part = compoundPart(poly, i);
+        STATS_COUNT(STAT_COMPOUND_PARTS);
+        if (resolveDir == NULL)
+        {
+            int hit = method == COLLISION_GJK ? collision_circlePoly_gjk_check(center, radius, part) : collision_circlePoly_check(center, radius, part);
+            if (hit)
+                return 1;
+            continue;
+        }
+
+        Vector2D partDir;
+        float partDepth;
+        if (circlePolyWith(method, &partDir, &partDepth, center, radius, part))
+            compound_add(&result, -1, i, partDir, partDepth);
+    }
+
+    return compound_merge(resolveDir, depth, &result);
+}
+
+static int compound_segmentPoly(Vector2D *resolveDir, float *depth, Segment segment, Polygon poly)
+{
+    CompoundResult result = { .kind = COMPOUND_SEGMENT, .segment = segment, .polyB = poly, .count = 0 };
+    for (int i = 0; i < poly.partCount; ++i)
+    {
+        Vector2D partDir;
+        float partDepth;
+        STATS_COUNT(STAT_COMPOUND_PARTS);
+        if (collision_segmentPoly(&partDir, &partDepth, segment, compoundPart(poly, i)))
+            compound_add(&result, -1, i, partDir, partDepth);
+    }
+
+    return compound_merge(resolveDir, depth, &result);
+}
+
+// --- BATCH ---
+
+static inline void addResult(CollisionResult *results, int maxResults, int *count, int a, int b, Vector2D resolveDir, float depth)
+{
+    if (*count < maxResults)
+    {
+        CollisionResult *res = &results[*count];
+        res->a = a;
+        res->b = b;
+        res->resolveDir = resolveDir;
+        res->depth = depth;
+    }
+    ++*count;
+}
+
+int collision_circleCircle_batch(CollisionResult *results, int maxResults, const float *x, const float *y, const float *r, int count)
+{
+    int hits = 0;
+    Vector2D resolveDir;
+    float depth;
+    STATS_TIMER_START(TIMER_NARROWPHASE);
+
+    int candidates[BATCH_CANDIDATE_BLOCK];
+
+    for (int i = 0; i < count; ++i)
+    {
+        Vector2D centerA = { .x = x[i], .y = y[i] };
+        for (int first = i + 1; first < count; first += BATCH_CANDIDATE_BLOCK)
+        {
+            // cheap vectorised rejection of a block, only the candidates build vectors
+            int blockSize = count - first < BATCH_CANDIDATE_BLOCK ? count - first : BATCH_CANDIDATE_BLOCK;
+            int found = simd_circleCandidates(candidates, x[i], y[i], r[i], &x[first], &y[first], &r[first], blockSize);
+            for (int c = 0; c < found; ++c)
+            {
+                int k = first + candidates[c];
+                Vector2D centerB = { .x = x[k], .y = y[k] };
+                if (collision_circleCircle(&resolveDir, &depth, centerA, r[i], centerB, r[k]))
+                    addResult(results, maxResults, &hits, i, k, resolveDir, depth);
+            }
+        }
+    }
+
+    STATS_TIMER_STOP(TIMER_NARROWPHASE);
+    return hits;
+}
+
+int collision_circleCircle_batchPairs(CollisionResult *results, int maxResults, const float *x, const float *y, const float *r, const CollisionPair *pairs, int pairCount)
+{
+    int hits = 0;
+    Vector2D resolveDir;
+    float depth;
+    STATS_TIMER_START(TIMER_NARROWPHASE);
+
+    for (int p = 0; p < pairCount; ++p)
+    {
+        int i = pairs[p].a;
+        int k = pairs[p].b;
+        Vector2D centerA = { .x = x[i], .y = y[i] };
+        Vector2D centerB = { .x = x[k], .y = y[k] };
+        if (collision_circleCircle(&resolveDir, &depth, centerA, r[i], centerB, r[k]))
+            addResult(results, maxResults, &hits, i, k, resolveDir, depth);
+    }
+
+    STATS_TIMER_STOP(TIMER_NARROWPHASE);
+    return hits;
+}
+
+int collision_circlePoly_batch(CollisionResult *results, int maxResults, const float *x, const float *y, const float *r, int circleCount, Polygon *const *polys, int polyCount, CollisionMethod method)
+{
+    int hits = 0;
+    Vector2D resolveDir;
+    float depth;
+    STATS_TIMER_START(TIMER_NARROWPHASE);
+
+    for (int i = 0; i < circleCount; ++i)
+    {
+        Vector2D center = { .x = x[i], .y = y[i] };
+        for (int k = 0; k < polyCount; ++k)
+        {
+            if (circlePolyWith(method, &resolveDir, &depth, center, r[i], *polys[k]))
+                addResult(results, maxResults, &hits, i, k, resolveDir, depth);
+        }
+    }
+
+    STATS_TIMER_STOP(TIMER_NARROWPHASE);
+    return hits;
+}
+
+int collision_polyPoly_batch(CollisionResult *results, int maxResults, Polygon *const *polys, int count, CollisionMethod method)
+{
+    int hits = 0;
+    Vector2D resolveDir;
+    float depth;
+    STATS_TIMER_START(TIMER_NARROWPHASE);
+
+    for (int i = 0; i < count; ++i)
+    {
+        for (int k = i + 1; k < count; ++k)
+        {
+            if (polyPolyWith(method, &resolveDir, &depth, *polys[i], *polys[k]))
+                addResult(results, maxResults, &hits, i, k, resolveDir, depth);
+        }
+    }
+
+    STATS_TIMER_STOP(TIMER_NARROWPHASE);
+    return hits;
+}
+
+int collision_polyPoly_batchPairs(CollisionResult *results, int maxResults, Polygon *const *polys, const CollisionPair *pairs, int pairCount, CollisionMethod method)
+{
+    int hits = 0;
+    Vector2D resolveDir;
+    float depth;
+    STATS_TIMER_START(TIMER_NARROWPHASE);
+
+    for (int p = 0; p < pairCount; ++p)
+    {
+        int i = pairs[p].a;
+        int k = pairs[p].b;
+        if (polyPolyWith(method, &resolveDir, &depth, *polys[i], *polys[k]))
+            addResult(results, maxResults, &hits, i, k, resolveDir, depth);
+    }
+
+    STATS_TIMER_STOP(TIMER_NARROWPHASE);
+    return hits;
+}
+
 // --- LUA HOOKS ---
 
+// Flags of a recorded query, see trace.h
+static inline int traceFlags(CollisionMethod method, int check)
+{
+    return (method == COLLISION_GJK ? TRACE_FLAG_GJK : 0) | (check ? TRACE_FLAG_CHECK : 0);
+}
+
+// Optional "sat" or "gjk" argument at pos selecting the polygon narrowphase, SAT when missing
+CollisionMethod collision_getMethodArg(int pos)
+{
+    const char *className = NULL;
+    if (pd->lua->getArgType(pos, &className) != kTypeString)
+        return COLLISION_SAT;
+
+    const char *name = pd->lua->getArgString(pos);
+    if (strcmp(name, "gjk") == 0)
+        return COLLISION_GJK;
+    if (strcmp(name, "sat") != 0)
+        pd->system->error("%s:%i: unknown collision method %s, expected sat or gjk", __FILE__, __LINE__, name);
+    return COLLISION_SAT;
+}
+
 static int lua_collision_circleCircle_check(lua_State *L)
 {
 	Vector2D *centerA = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
@@ -344,99 +1935,458 @@ static int lua_collision_circleCircle_check(lua_State *L)
 	Vector2D *centerB = pd->lua->getArgObject(3, VECTOR_TYPE_NAME, NULL);
 	float radiusB = pd->lua->getArgFloat(4);
 
-    int collides = collision_circleCircle_check(*centerA, radiusA, *centerB, radiusB);
+    int collides = collision_circleCircle_check(*centerA, radiusA, *centerB, radiusB);
+    if (trace_isRecording())
+        trace_circleCircle(TRACE_FLAG_CHECK, *centerA, radiusA, *centerB, radiusB, collides, NULL, NULL);
+
+    pd->lua->pushBool(collides);
+    return 1;
+}
+
+static int lua_collision_circleCircle(lua_State *L)
+{
+	Vector2D *centerA = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
+	float radiusA = pd->lua->getArgFloat(2);
+	Vector2D *centerB = pd->lua->getArgObject(3, VECTOR_TYPE_NAME, NULL);
+	float radiusB = pd->lua->getArgFloat(4);
+
+    Vector2D resolveDir;
+    float depth;
+
+    int collides = collision_circleCircle(&resolveDir, &depth, *centerA, radiusA, *centerB, radiusB);
+    if (trace_isRecording())
+        trace_circleCircle(0, *centerA, radiusA, *centerB, radiusB, collides, &resolveDir, &depth);
+
+    if (!collides)
+        return 0;
+
+    Vector2D *result = pd->system->realloc(NULL, sizeof(Vector2D));
+    STATS_COUNT(STAT_ALLOCS);
+    *result = resolveDir;
+    
+    pd->lua->pushObject(result, VECTOR_TYPE_NAME, 0);
+    pd->lua->pushFloat(depth);
+	return 2;
+}
+
+// Allocation-free variant: collision.circleCircle_into(out, centerA, radiusA, centerB, radiusB)
+// Writes the resolve direction into the collision.vector2D out and returns only depth (nil when not colliding).
+// Unlike circleCircle no new vector is created, so this does not produce garbage.
+static int lua_collision_circleCircle_into(lua_State *L)
+{
+    Vector2D *resolveDir = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
+    Vector2D *centerA = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
+    float radiusA = pd->lua->getArgFloat(3);
+    Vector2D *centerB = pd->lua->getArgObject(4, VECTOR_TYPE_NAME, NULL);
+    float radiusB = pd->lua->getArgFloat(5);
+    Vector2D dir;
+    float depth;
+
+    int collides = collision_circleCircle(&dir, &depth, *centerA, radiusA, *centerB, radiusB);
+    if (trace_isRecording())
+        trace_circleCircle(0, *centerA, radiusA, *centerB, radiusB, collides, &dir, &depth);
+
+    // out stays untouched when not colliding
+    if (!collides)
+        return 0;
+
+    *resolveDir = dir;
+    pd->lua->pushFloat(depth);
+    return 1;
+}
+
+// The polygon hooks take an optional last argument "sat" (default) or "gjk" selecting the narrowphase
+static int lua_collision_polyPoly_check(lua_State *L)
+{
+    Polygon* polyA = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
+    Polygon* polyB = pd->lua->getArgObject(2, POLY_TYPE_NAME, NULL);
+    polygon_updateCache(polyA);
+    polygon_updateCache(polyB);
+
+    CollisionMethod method = collision_getMethodArg(3);
+    int collides = method == COLLISION_GJK
+            ? collision_polyPoly_gjk_check(*polyA, *polyB)
+            : collision_polyPoly_check(*polyA, *polyB);
+    if (trace_isRecording())
+        trace_polyPoly(traceFlags(method, 1), polyA, polyB, collides, NULL, NULL);
+
+    pd->lua->pushBool(collides);
+    return 1;
+}
+
+static int lua_collision_polyPoly(lua_State *L)
+{
+	Polygon* polyA = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
+	Polygon* polyB = pd->lua->getArgObject(2, POLY_TYPE_NAME, NULL);
+    polygon_updateCache(polyA);
+    polygon_updateCache(polyB);
+
+    Vector2D resolveDir;
+    float depth;
+
+    CollisionMethod method = collision_getMethodArg(3);
+    int collides = polyPolyWith(method, &resolveDir, &depth, *polyA, *polyB);
+    if (trace_isRecording())
+        trace_polyPoly(traceFlags(method, 0), polyA, polyB, collides, &resolveDir, &depth);
+
+    if (!collides)
+        return 0;
+
+    Vector2D *result = pd->system->realloc(NULL, sizeof(Vector2D));
+    STATS_COUNT(STAT_ALLOCS);
+    *result = resolveDir;
+
+    pd->lua->pushObject(result, VECTOR_TYPE_NAME, 0);
+    pd->lua->pushFloat(depth);
+	return 2;
+}
+
+// Allocation-free variant: collision.polyPoly_into(out, polyA, polyB, [method]), see circleCircle_into
+static int lua_collision_polyPoly_into(lua_State *L)
+{
+    Vector2D *resolveDir = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
+    Polygon* polyA = pd->lua->getArgObject(2, POLY_TYPE_NAME, NULL);
+    Polygon* polyB = pd->lua->getArgObject(3, POLY_TYPE_NAME, NULL);
+    polygon_updateCache(polyA);
+    polygon_updateCache(polyB);
+    Vector2D dir;
+    float depth;
+
+    CollisionMethod method = collision_getMethodArg(4);
+    int collides = polyPolyWith(method, &dir, &depth, *polyA, *polyB);
+    if (trace_isRecording())
+        trace_polyPoly(traceFlags(method, 0), polyA, polyB, collides, &dir, &depth);
+
+    if (!collides)
+        return 0;
+
+    *resolveDir = dir;
+    pd->lua->pushFloat(depth);
+    return 1;
+}
+
+// collision.polyPoly_manifold(polyA, polyB) -> resolveX, resolveY, depth, pointCount, x1, y1, depth1, [x2, y2, depth2]
+// (nil when not colliding), see collision_polyPoly_manifold
+static int lua_collision_polyPoly_manifold(lua_State *L)
+{
+    Polygon* polyA = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
+    Polygon* polyB = pd->lua->getArgObject(2, POLY_TYPE_NAME, NULL);
+    polygon_updateCache(polyA);
+    polygon_updateCache(polyB);
+    ContactManifold manifold;
+
+    int collides = collision_polyPoly_manifold(&manifold, *polyA, *polyB);
+    if (trace_isRecording())
+        trace_polyPolyManifold(polyA, polyB, collides, &manifold);
+
+    if (!collides)
+        return 0;
+
+    pd->lua->pushFloat(manifold.normal.x);
+    pd->lua->pushFloat(manifold.normal.y);
+    pd->lua->pushFloat(manifold.depth);
+    pd->lua->pushInt(manifold.pointCount);
+    for (int i = 0; i < manifold.pointCount; ++i)
+    {
+        pd->lua->pushFloat(manifold.points[i].x);
+        pd->lua->pushFloat(manifold.points[i].y);
+        pd->lua->pushFloat(manifold.depths[i]);
+    }
+    return 4 + 3 * manifold.pointCount;
+}
+
+static int lua_collision_circlePoly_check(lua_State *L)
+{
+    Vector2D* center = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(2);
+    Polygon* poly = pd->lua->getArgObject(3, POLY_TYPE_NAME, NULL);
+    polygon_updateCache(poly);
+
+    CollisionMethod method = collision_getMethodArg(4);
+    int collides = method == COLLISION_GJK
+            ? collision_circlePoly_gjk_check(*center, radius, *poly)
+            : collision_circlePoly_check(*center, radius, *poly);
+    if (trace_isRecording())
+        trace_circlePoly(traceFlags(method, 1), *center, radius, poly, collides, NULL, NULL);
+
+    pd->lua->pushBool(collides);
+    return 1;
+}
+
+static int lua_collision_circlePoly(lua_State *L)
+{
+	Vector2D* center = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
+	float radius = pd->lua->getArgFloat(2);
+	Polygon* poly = pd->lua->getArgObject(3, POLY_TYPE_NAME, NULL);
+    polygon_updateCache(poly);
+
+    Vector2D resolveDir;
+    float depth;
+
+    CollisionMethod method = collision_getMethodArg(4);
+    int collides = circlePolyWith(method, &resolveDir, &depth, *center, radius, *poly);
+    if (trace_isRecording())
+        trace_circlePoly(traceFlags(method, 0), *center, radius, poly, collides, &resolveDir, &depth);
+
+    if (!collides)
+        return 0;
+
+    Vector2D *result = pd->system->realloc(NULL, sizeof(Vector2D));
+    STATS_COUNT(STAT_ALLOCS);
+    *result = resolveDir;
+
+    pd->lua->pushObject(result, VECTOR_TYPE_NAME, 0);
+    pd->lua->pushFloat(depth);
+	return 2;
+}
+
+// Allocation-free variant: collision.circlePoly_into(out, center, radius, poly, [method]), see circleCircle_into
+static int lua_collision_circlePoly_into(lua_State *L)
+{
+    Vector2D *resolveDir = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
+    Vector2D* center = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(3);
+    Polygon* poly = pd->lua->getArgObject(4, POLY_TYPE_NAME, NULL);
+    polygon_updateCache(poly);
+    Vector2D dir;
+    float depth;
+
+    CollisionMethod method = collision_getMethodArg(5);
+    int collides = circlePolyWith(method, &dir, &depth, *center, radius, *poly);
+    if (trace_isRecording())
+        trace_circlePoly(traceFlags(method, 0), *center, radius, poly, collides, &dir, &depth);
+
+    if (!collides)
+        return 0;
+
+    *resolveDir = dir;
+    pd->lua->pushFloat(depth);
+    return 1;
+}
+
+static int pushSweepResult(const SweepResult *result)
+{
+    pd->lua->pushFloat(result->toi);
+    pd->lua->pushFloat(result->normal.x);
+    pd->lua->pushFloat(result->normal.y);
+    pd->lua->pushFloat(result->point.x);
+    pd->lua->pushFloat(result->point.y);
+    return 5;
+}
+
+// collision.circlePoly_swept(center, radius, move, poly) -> toi, normalX, normalY, pointX, pointY
+// (nil when not touching during the movement), see collision_circlePoly_swept
+static int lua_collision_circlePoly_swept(lua_State *L)
+{
+    Vector2D* center = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(2);
+    Vector2D* move = pd->lua->getArgObject(3, VECTOR_TYPE_NAME, NULL);
+    Polygon* poly = pd->lua->getArgObject(4, POLY_TYPE_NAME, NULL);
+    polygon_updateCache(poly);
+    SweepResult result;
+
+    int collides = collision_circlePoly_swept(&result, *center, radius, *move, *poly);
+    if (trace_isRecording())
+        trace_circlePolySwept(*center, radius, *move, poly, collides, &result);
+
+    if (!collides)
+        return 0;
+
+    return pushSweepResult(&result);
+}
+
+// collision.polyPoly_swept(polyA, move, polyB) -> toi, normalX, normalY, pointX, pointY, polyA moves
+static int lua_collision_polyPoly_swept(lua_State *L)
+{
+    Polygon* polyA = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
+    Vector2D* move = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
+    Polygon* polyB = pd->lua->getArgObject(3, POLY_TYPE_NAME, NULL);
+    polygon_updateCache(polyA);
+    polygon_updateCache(polyB);
+    SweepResult result;
+
+    int collides = collision_polyPoly_swept(&result, *polyA, *move, *polyB);
+    if (trace_isRecording())
+        trace_polyPolySwept(polyA, *move, polyB, collides, &result);
+
+    if (!collides)
+        return 0;
 
-    pd->lua->pushBool(collides);
-    return 1;
+    return pushSweepResult(&result);
 }
 
-static int lua_collision_circleCircle(lua_State *L)
+// --- PRIMITIVE LUA HOOKS ---
+// Boxes are passed as x, y, width, height. All return resolveX, resolveY, depth (nil when not
+// colliding), no objects are created.
+
+static void getArgBox(AABB *box, int pos)
 {
-	Vector2D *centerA = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
-	float radiusA = pd->lua->getArgFloat(2);
-	Vector2D *centerB = pd->lua->getArgObject(3, VECTOR_TYPE_NAME, NULL);
-	float radiusB = pd->lua->getArgFloat(4);
+    box->minX = pd->lua->getArgFloat(pos);
+    box->minY = pd->lua->getArgFloat(pos + 1);
+    box->maxX = box->minX + pd->lua->getArgFloat(pos + 2);
+    box->maxY = box->minY + pd->lua->getArgFloat(pos + 3);
+}
+
+static int pushResolve(Vector2D resolveDir, float depth)
+{
+    pd->lua->pushFloat(resolveDir.x);
+    pd->lua->pushFloat(resolveDir.y);
+    pd->lua->pushFloat(depth);
+    return 3;
+}
 
-    Vector2D *resolveDir = pd->system->realloc(NULL, sizeof(Vector2D));
+// collision.aabbAABB(xA, yA, widthA, heightA, xB, yB, widthB, heightB)
+static int lua_collision_aabbAABB(lua_State *L)
+{
+    AABB boxA, boxB;
+    getArgBox(&boxA, 1);
+    getArgBox(&boxB, 5);
+    Vector2D resolveDir;
     float depth;
 
-    int collides = collision_circleCircle(resolveDir, &depth, *centerA, radiusA, *centerB, radiusB);
+    int collides = collision_aabbAABB(&resolveDir, &depth, boxA, boxB);
+    if (trace_isRecording())
+        trace_aabbAABB(boxA, boxB, collides, &resolveDir, &depth);
 
     if (!collides)
-    {
-        pd->system->realloc(resolveDir, 0);
         return 0;
-    }
-    
-    pd->lua->pushObject(resolveDir, VECTOR_TYPE_NAME, 0);
-    pd->lua->pushFloat(depth);
-	return 2;
+
+    return pushResolve(resolveDir, depth);
 }
 
-static int lua_collision_polyPoly_check(lua_State *L)
+// collision.aabbCircle(x, y, width, height, center, radius)
+static int lua_collision_aabbCircle(lua_State *L)
 {
-    Polygon* polyA = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
-    Polygon* polyB = pd->lua->getArgObject(2, POLY_TYPE_NAME, NULL);
+    AABB box;
+    getArgBox(&box, 1);
+    Vector2D* center = pd->lua->getArgObject(5, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(6);
+    Vector2D resolveDir;
+    float depth;
 
-    int collides = collision_polyPoly_check(*polyA, *polyB);
+    int collides = collision_aabbCircle(&resolveDir, &depth, box, *center, radius);
+    if (trace_isRecording())
+        trace_aabbCircle(box, *center, radius, collides, &resolveDir, &depth);
 
-    pd->lua->pushBool(collides);
-    return 1;
+    if (!collides)
+        return 0;
+
+    return pushResolve(resolveDir, depth);
 }
 
-static int lua_collision_polyPoly(lua_State *L)
+// collision.capsuleCircle(a, b, capsuleRadius, center, radius), the capsule goes from vector a to vector b
+static int lua_collision_capsuleCircle(lua_State *L)
 {
-	Polygon* polyA = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
-	Polygon* polyB = pd->lua->getArgObject(2, POLY_TYPE_NAME, NULL);
+    Vector2D* a = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
+    Vector2D* b = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
+    Capsule capsule = { .a = *a, .b = *b, .radius = pd->lua->getArgFloat(3) };
+    Vector2D* center = pd->lua->getArgObject(4, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(5);
+    Vector2D resolveDir;
+    float depth;
+
+    int collides = collision_capsuleCircle(&resolveDir, &depth, capsule, *center, radius);
+    if (trace_isRecording())
+        trace_capsuleCircle(capsule, *center, radius, collides, &resolveDir, &depth);
+
+    if (!collides)
+        return 0;
 
-    Vector2D *resolveDir = pd->system->realloc(NULL, sizeof(Vector2D));
+    return pushResolve(resolveDir, depth);
+}
+
+// collision.capsuleCapsule(aA, bA, radiusA, aB, bB, radiusB)
+static int lua_collision_capsuleCapsule(lua_State *L)
+{
+    Vector2D* aA = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
+    Vector2D* bA = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
+    Capsule capsuleA = { .a = *aA, .b = *bA, .radius = pd->lua->getArgFloat(3) };
+    Vector2D* aB = pd->lua->getArgObject(4, VECTOR_TYPE_NAME, NULL);
+    Vector2D* bB = pd->lua->getArgObject(5, VECTOR_TYPE_NAME, NULL);
+    Capsule capsuleB = { .a = *aB, .b = *bB, .radius = pd->lua->getArgFloat(6) };
+    Vector2D resolveDir;
     float depth;
 
-    int collides = collision_polyPoly(resolveDir, &depth, *polyA, *polyB);
+    int collides = collision_capsuleCapsule(&resolveDir, &depth, capsuleA, capsuleB);
+    if (trace_isRecording())
+        trace_capsuleCapsule(capsuleA, capsuleB, collides, &resolveDir, &depth);
 
     if (!collides)
-    {
-        pd->system->realloc(resolveDir, 0);
         return 0;
-    }
 
-    pd->lua->pushObject(resolveDir, VECTOR_TYPE_NAME, 0);
-    pd->lua->pushFloat(depth);
-	return 2;
+    return pushResolve(resolveDir, depth);
 }
 
-static int lua_collision_circlePoly_check(lua_State *L)
+// collision.segmentPoly(a, b, poly), e.g. a sword from a to b
+static int lua_collision_segmentPoly(lua_State *L)
 {
-    Vector2D* center = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
-    float radius = pd->lua->getArgFloat(2);
+    Vector2D* a = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
+    Vector2D* b = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
     Polygon* poly = pd->lua->getArgObject(3, POLY_TYPE_NAME, NULL);
+    polygon_updateCache(poly);
+    Segment segment = { .a = *a, .b = *b };
+    Vector2D resolveDir;
+    float depth;
 
-    int collides = collision_circlePoly_check(*center, radius, *poly);
+    int collides = collision_segmentPoly(&resolveDir, &depth, segment, *poly);
+    if (trace_isRecording())
+        trace_segmentPoly(segment, poly, collides, &resolveDir, &depth);
 
-    pd->lua->pushBool(collides);
-    return 1;
+    if (!collides)
+        return 0;
+
+    return pushResolve(resolveDir, depth);
 }
 
-static int lua_collision_circlePoly(lua_State *L)
+static int pushRayHit(const RayHit *hit)
 {
-	Vector2D* center = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
-	float radius = pd->lua->getArgFloat(2);
-	Polygon* poly = pd->lua->getArgObject(3, POLY_TYPE_NAME, NULL);
+    pd->lua->pushFloat(hit->t);
+    pd->lua->pushFloat(hit->normal.x);
+    pd->lua->pushFloat(hit->normal.y);
+    pd->lua->pushFloat(hit->point.x);
+    pd->lua->pushFloat(hit->point.y);
+    return 5;
+}
 
-    Vector2D *resolveDir = pd->system->realloc(NULL, sizeof(Vector2D));
-    float depth;
+// collision.rayCircle(origin, dir, maxT, center, radius) -> t, normalX, normalY, pointX, pointY
+// (nil when missing), see collision_rayCircle. For a segment pass dir = end - start and maxT = 1.
+static int lua_collision_rayCircle(lua_State *L)
+{
+    Vector2D* origin = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
+    Vector2D* dir = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
+    float maxT = pd->lua->getArgFloat(3);
+    Vector2D* center = pd->lua->getArgObject(4, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(5);
+    RayHit hit;
+
+    int hits = collision_rayCircle(&hit, *origin, *dir, maxT, *center, radius);
+    if (trace_isRecording())
+        trace_rayCircle(*origin, *dir, maxT, *center, radius, hits, &hit);
+
+    if (!hits)
+        return 0;
 
-    int collides = collision_circlePoly(resolveDir, &depth, *center, radius, *poly);
-    
-    if (!collides)
-    {
-        pd->system->realloc(resolveDir, 0);
+    return pushRayHit(&hit);
+}
+
+// collision.rayPoly(origin, dir, maxT, poly) -> t, normalX, normalY, pointX, pointY, see rayCircle
+static int lua_collision_rayPoly(lua_State *L)
+{
+    Vector2D* origin = pd->lua->getArgObject(1, VECTOR_TYPE_NAME, NULL);
+    Vector2D* dir = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
+    float maxT = pd->lua->getArgFloat(3);
+    Polygon* poly = pd->lua->getArgObject(4, POLY_TYPE_NAME, NULL);
+    polygon_updateCache(poly);
+    RayHit hit;
+
+    int hits = collision_rayPoly(&hit, *origin, *dir, maxT, *poly);
+    if (trace_isRecording())
+        trace_rayPoly(*origin, *dir, maxT, poly, hits, &hit);
+
+    if (!hits)
         return 0;
-    }
 
-    pd->lua->pushObject(resolveDir, VECTOR_TYPE_NAME, 0);
-    pd->lua->pushFloat(depth);
-	return 2;
+    return pushRayHit(&hit);
 }
 
 static int lua_collision_swordResolution(lua_State *L)
@@ -447,13 +2397,18 @@ static int lua_collision_swordResolution(lua_State *L)
 
     float minA, maxB;
 
+    Vector2D v0, v1;
+    polygon_getVertex(&v0, *poly, 0);
+    polygon_getVertex(&v1, *poly, 1);
+
     Vector2D *axis = pd->system->realloc(NULL, sizeof(Vector2D));
-    vector2D_dirNormalized(axis, poly->verts[1], poly->verts[0]);
+    STATS_COUNT(STAT_ALLOCS);
+    vector2D_dirNormalized(axis, v1, v0);
     vector2D_leftNormal(axis, *axis);
 
     // we don't need maxB from this call, but cannot pass NULL at the moment
     projectCircle(&minA, &maxB, *center, radius, *axis);
-    maxB = vector2D_dotProduct(*axis, poly->verts[0]);
+    maxB = vector2D_dotProduct(*axis, v0);
     axis->x *= -1;
     axis->y *= -1;
     
@@ -462,6 +2417,483 @@ static int lua_collision_swordResolution(lua_State *L)
 	return 2;
 }
 
+// --- BATCH LUA HOOKS ---
+
+static int lua_batch_new(lua_State *L)
+{
+    CollisionBatch *batch = pd->system->realloc(NULL, sizeof(CollisionBatch));
+    STATS_COUNT(STAT_ALLOCS);
+    memset(batch, 0, sizeof(CollisionBatch));
+
+    pd->lua->pushObject(batch, BATCH_TYPE_NAME, 0);
+    return 1;
+}
+
+static void batch_releasePolys(CollisionBatch *batch)
+{
+    for (int i = 0; i < batch->polyCount; ++i)
+    {
+        if (batch->polyRefs[i] != NULL)
+            pd->lua->releaseObject(batch->polyRefs[i]);
+    }
+    batch->polyCount = 0;
+}
+
+static int lua_batch_free(lua_State *L)
+{
+    CollisionBatch *batch = pd->lua->getArgObject(1, BATCH_TYPE_NAME, NULL);
+
+    batch_releasePolys(batch);
+    pd->system->realloc(batch->x, 0);
+    pd->system->realloc(batch->y, 0);
+    pd->system->realloc(batch->r, 0);
+    pd->system->realloc(batch->polys, 0);
+    pd->system->realloc(batch->polyRefs, 0);
+    pd->system->realloc(batch->results, 0);
+    pd->system->realloc(batch->rayHits, 0);
+    pd->system->realloc(batch, 0);
+    return 0;
+}
+
+// batch:setCircle(i, center, radius), i is 1-based. Setting i > count grows the batch to i circles.
+static int lua_batch_setCircle(lua_State *L)
+{
+    CollisionBatch *batch = pd->lua->getArgObject(1, BATCH_TYPE_NAME, NULL);
+    int i = pd->lua->getArgInt(2) - 1;
+    Vector2D *center = pd->lua->getArgObject(3, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(4);
+
+    if (i < 0)
+        return 0;
+
+    if (i >= batch->circleCount)
+    {
+        int capacity = batch->circleCapacity;
+        batch->x = ensureCapacity(pd->system->realloc, batch->x, &capacity, i + 1, sizeof(float));
+        capacity = batch->circleCapacity;
+        batch->y = ensureCapacity(pd->system->realloc, batch->y, &capacity, i + 1, sizeof(float));
+        batch->r = ensureCapacity(pd->system->realloc, batch->r, &batch->circleCapacity, i + 1, sizeof(float));
+        for (int k = batch->circleCount; k < i; ++k)
+            batch->x[k] = batch->y[k] = batch->r[k] = 0.0f;
+        batch->circleCount = i + 1;
+    }
+
+    batch->x[i] = center->x;
+    batch->y[i] = center->y;
+    batch->r[i] = radius;
+    return 0;
+}
+
+// batch:setPoly(i, poly), i is 1-based. The batch keeps a reference to poly.
+static int lua_batch_setPoly(lua_State *L)
+{
+    CollisionBatch *batch = pd->lua->getArgObject(1, BATCH_TYPE_NAME, NULL);
+    int i = pd->lua->getArgInt(2) - 1;
+    LuaUDObject *ref = NULL;
+    Polygon *poly = pd->lua->getArgObject(3, POLY_TYPE_NAME, &ref);
+
+    if (i < 0 || poly == NULL)
+        return 0;
+
+    if (i >= batch->polyCount)
+    {
+        int capacity = batch->polyCapacity;
+        batch->polys = ensureCapacity(pd->system->realloc, batch->polys, &capacity, i + 1, sizeof(Polygon *));
+        batch->polyRefs = ensureCapacity(pd->system->realloc, batch->polyRefs, &batch->polyCapacity, i + 1, sizeof(LuaUDObject *));
+        for (int k = batch->polyCount; k <= i; ++k)
+        {
+            batch->polys[k] = NULL;
+            batch->polyRefs[k] = NULL;
+        }
+        batch->polyCount = i + 1;
+    }
+
+    if (batch->polyRefs[i] != NULL)
+        pd->lua->releaseObject(batch->polyRefs[i]);
+    batch->polys[i] = poly;
+    batch->polyRefs[i] = pd->lua->retainObject(ref);
+    return 0;
+}
+
+static int lua_batch_clear(lua_State *L)
+{
+    CollisionBatch *batch = pd->lua->getArgObject(1, BATCH_TYPE_NAME, NULL);
+
+    batch->circleCount = 0;
+    batch->resultCount = 0;
+    batch->rayHitCount = 0;
+    batch_releasePolys(batch);
+    return 0;
+}
+
+// Returns the candidate pairs of the last findPairs call of the broadphase object
+// (grid, tree or sap) at Lua stack position pos, NULL if there is none.
+static const CollisionPair *getBroadphasePairs(int pos, int *outCount)
+{
+    const char *className = NULL;
+    if (pd->lua->getArgType(pos, &className) != kTypeObject || className == NULL)
+        return NULL;
+
+    if (strcmp(className, GRID_TYPE_NAME) == 0)
+    {
+        SpatialGrid *grid = pd->lua->getArgObject(pos, GRID_TYPE_NAME, NULL);
+        *outCount = grid->pairCount;
+        return grid->pairs;
+    }
+    if (strcmp(className, TREE_TYPE_NAME) == 0)
+    {
+        AABBTree *tree = pd->lua->getArgObject(pos, TREE_TYPE_NAME, NULL);
+        *outCount = tree->pairCount;
+        return tree->pairs;
+    }
+    if (strcmp(className, SAP_TYPE_NAME) == 0)
+    {
+        SweepPrune *sap = pd->lua->getArgObject(pos, SAP_TYPE_NAME, NULL);
+        *outCount = sap->pairCount;
+        return sap->pairs;
+    }
+    return NULL;
+}
+
+static int validPairs(const CollisionPair *pairs, int pairCount, int bodyCount)
+{
+    for (int i = 0; i < pairCount; ++i)
+    {
+        if (pairs[i].a >= bodyCount || pairs[i].b >= bodyCount)
+        {
+            pd->system->error("%s:%i: broadphase id %d out of range for batch with %d bodies",
+                    __FILE__, __LINE__, (pairs[i].a > pairs[i].b ? pairs[i].a : pairs[i].b) + 1, bodyCount);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Grows the result buffer if the last call found more results than fit. Returns 1 if the call needs to be repeated.
+static int batch_growResults(CollisionBatch *batch, int count)
+{
+    batch->resultCount = count;
+    if (count <= batch->resultCapacity)
+        return 0;
+
+    batch->results = ensureCapacity(pd->system->realloc, batch->results, &batch->resultCapacity, count, sizeof(CollisionResult));
+    return 1;
+}
+
+// batch:setMethod("sat" or "gjk"), narrowphase used by circlePoly and polyPoly of this batch
+static int lua_batch_setMethod(lua_State *L)
+{
+    CollisionBatch *batch = pd->lua->getArgObject(1, BATCH_TYPE_NAME, NULL);
+    batch->method = collision_getMethodArg(2);
+    return 0;
+}
+
+// batch:circleCircle([broadphase]) -> number of collisions
+// Tests all pairs of circles, or only the pairs of the last broadphase:findPairs() call.
+static int lua_batch_circleCircle(lua_State *L)
+{
+    CollisionBatch *batch = pd->lua->getArgObject(1, BATCH_TYPE_NAME, NULL);
+    int pairCount = 0;
+    const CollisionPair *pairs = getBroadphasePairs(2, &pairCount);
+    int count;
+
+    if (pairs != NULL)
+    {
+        if (!validPairs(pairs, pairCount, batch->circleCount))
+            return 0;
+        do
+        {
+            count = collision_circleCircle_batchPairs(batch->results, batch->resultCapacity,
+                    batch->x, batch->y, batch->r, pairs, pairCount);
+        } while (batch_growResults(batch, count));
+    }
+    else
+    {
+        do
+        {
+            count = collision_circleCircle_batch(batch->results, batch->resultCapacity,
+                    batch->x, batch->y, batch->r, batch->circleCount);
+        } while (batch_growResults(batch, count));
+    }
+
+    if (trace_isRecording())
+        trace_circleCircleBatch(batch->x, batch->y, batch->r, batch->circleCount, pairs, pairCount, batch->results, count);
+    pd->lua->pushInt(count);
+    return 1;
+}
+
+// batch:circlePoly() -> number of collisions, tests every circle against every polygon
+static int lua_batch_circlePoly(lua_State *L)
+{
+    CollisionBatch *batch = pd->lua->getArgObject(1, BATCH_TYPE_NAME, NULL);
+    int count;
+
+    for (int i = 0; i < batch->polyCount; ++i)
+    {
+        if (batch->polys[i] == NULL)
+        {
+            pd->system->error("%s:%i: batch polygon %d not set", __FILE__, __LINE__, i + 1);
+            return 0;
+        }
+        polygon_updateCache(batch->polys[i]);
+    }
+
+    do
+    {
+        count = collision_circlePoly_batch(batch->results, batch->resultCapacity,
+                batch->x, batch->y, batch->r, batch->circleCount, batch->polys, batch->polyCount, batch->method);
+    } while (batch_growResults(batch, count));
+
+    if (trace_isRecording())
+        trace_circlePolyBatch(traceFlags(batch->method, 0), batch->x, batch->y, batch->r, batch->circleCount,
+                batch->polys, batch->polyCount, batch->results, count);
+    pd->lua->pushInt(count);
+    return 1;
+}
+
+// batch:polyPoly([broadphase]) -> number of collisions
+// Tests all pairs of polygons, or only the pairs of the last broadphase:findPairs() call.
+static int lua_batch_polyPoly(lua_State *L)
+{
+    CollisionBatch *batch = pd->lua->getArgObject(1, BATCH_TYPE_NAME, NULL);
+    int pairCount = 0;
+    const CollisionPair *pairs = getBroadphasePairs(2, &pairCount);
+    int count;
+
+    for (int i = 0; i < batch->polyCount; ++i)
+    {
+        if (batch->polys[i] == NULL)
+        {
+            pd->system->error("%s:%i: batch polygon %d not set", __FILE__, __LINE__, i + 1);
+            return 0;
+        }
+        polygon_updateCache(batch->polys[i]);
+    }
+
+    if (pairs != NULL)
+    {
+        if (!validPairs(pairs, pairCount, batch->polyCount))
+            return 0;
+        do
+        {
+            count = collision_polyPoly_batchPairs(batch->results, batch->resultCapacity,
+                    batch->polys, pairs, pairCount, batch->method);
+        } while (batch_growResults(batch, count));
+    }
+    else
+    {
+        do
+        {
+            count = collision_polyPoly_batch(batch->results, batch->resultCapacity,
+                    batch->polys, batch->polyCount, batch->method);
+        } while (batch_growResults(batch, count));
+    }
+
+    if (trace_isRecording())
+        trace_polyPolyBatch(traceFlags(batch->method, 0), batch->polys, batch->polyCount, pairs, pairCount, batch->results, count);
+    pd->lua->pushInt(count);
+    return 1;
+}
+
+typedef struct
+{
+    CollisionBatch *batch;
+    int polys;
+    int all;
+    int found;
+    BatchRayHit first;
+} RayQuery;
+
+static float rayQueryCallback(void *userData, int id, Vector2D origin, Vector2D dir, float maxT)
+{
+    RayQuery *query = userData;
+    CollisionBatch *batch = query->batch;
+    RayHit hit;
+
+    if (query->polys)
+    {
+        if (id >= batch->polyCount || !collision_rayPoly(&hit, origin, dir, maxT, *batch->polys[id]))
+            return maxT;
+    }
+    else
+    {
+        if (id >= batch->circleCount)
+            return maxT;
+        Vector2D center = { .x = batch->x[id], .y = batch->y[id] };
+        if (!collision_rayCircle(&hit, origin, dir, maxT, center, batch->r[id]))
+            return maxT;
+    }
+
+    if (query->all)
+    {
+        batch->rayHits = ensureCapacity(pd->system->realloc, batch->rayHits, &batch->rayHitCapacity, batch->rayHitCount + 1, sizeof(BatchRayHit));
+        batch->rayHits[batch->rayHitCount].index = id;
+        batch->rayHits[batch->rayHitCount].hit = hit;
+        ++batch->rayHitCount;
+        return maxT;
+    }
+
+    // closer hits only from now on
+    query->found = 1;
+    query->first.index = id;
+    query->first.hit = hit;
+    return hit.t;
+}
+
+// Casts the ray through the broadphase object (grid, tree or sap) at Lua stack position pos,
+// or through all bodies of the batch if there is none
+static void batch_raycast(RayQuery *query, int pos, Vector2D origin, Vector2D dir, float maxT)
+{
+    CollisionBatch *batch = query->batch;
+    const char *className = NULL;
+    if (pd->lua->getArgType(pos, &className) == kTypeObject && className != NULL)
+    {
+        if (strcmp(className, GRID_TYPE_NAME) == 0)
+        {
+            spatialGrid_raycast(pd->lua->getArgObject(pos, GRID_TYPE_NAME, NULL), origin, dir, maxT, rayQueryCallback, query);
+            return;
+        }
+        if (strcmp(className, TREE_TYPE_NAME) == 0)
+        {
+            aabbTree_raycast(pd->lua->getArgObject(pos, TREE_TYPE_NAME, NULL), origin, dir, maxT, rayQueryCallback, query);
+            return;
+        }
+        if (strcmp(className, SAP_TYPE_NAME) == 0)
+        {
+            sweepPrune_raycast(pd->lua->getArgObject(pos, SAP_TYPE_NAME, NULL), origin, dir, maxT, rayQueryCallback, query);
+            return;
+        }
+    }
+
+    int count = query->polys ? batch->polyCount : batch->circleCount;
+    for (int i = 0; i < count; ++i)
+        maxT = rayQueryCallback(query, i, origin, dir, maxT);
+}
+
+static int compareRayHits(const void *a, const void *b)
+{
+    float ta = ((const BatchRayHit *)a)->hit.t;
+    float tb = ((const BatchRayHit *)b)->hit.t;
+    return (ta > tb) - (ta < tb);
+}
+
+// Shared by the batch ray queries: batch:rayX(origin, dir, maxT, [broadphase])
+static int batch_rayQuery(int polys, int all)
+{
+    CollisionBatch *batch = pd->lua->getArgObject(1, BATCH_TYPE_NAME, NULL);
+    Vector2D *origin = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
+    Vector2D *dir = pd->lua->getArgObject(3, VECTOR_TYPE_NAME, NULL);
+    float maxT = pd->lua->getArgFloat(4);
+    RayQuery query = { .batch = batch, .polys = polys, .all = all };
+
+    if (polys)
+    {
+        for (int i = 0; i < batch->polyCount; ++i)
+        {
+            if (batch->polys[i] == NULL)
+            {
+                pd->system->error("%s:%i: batch polygon %d not set", __FILE__, __LINE__, i + 1);
+                return 0;
+            }
+            polygon_updateCache(batch->polys[i]);
+        }
+    }
+
+    batch->rayHitCount = 0;
+    batch_raycast(&query, 5, *origin, *dir, maxT);
+
+    if (all)
+    {
+        qsort(batch->rayHits, batch->rayHitCount, sizeof(BatchRayHit), compareRayHits);
+        pd->lua->pushInt(batch->rayHitCount);
+        return 1;
+    }
+
+    if (!query.found)
+        return 0;
+
+    pd->lua->pushInt(query.first.index + 1);
+    return 1 + pushRayHit(&query.first.hit);
+}
+
+// batch:rayCircles(origin, dir, maxT, [broadphase]) -> index, t, normalX, normalY, pointX, pointY
+// First circle hit by the ray (nil when none). With a broadphase only the bodies along the ray are tested,
+// its ids must match the batch indices.
+static int lua_batch_rayCircles(lua_State *L)
+{
+    return batch_rayQuery(0, 0);
+}
+
+// batch:rayPolys(origin, dir, maxT, [broadphase]), see rayCircles
+static int lua_batch_rayPolys(lua_State *L)
+{
+    return batch_rayQuery(1, 0);
+}
+
+// batch:rayCirclesAll(origin, dir, maxT, [broadphase]) -> number of hits, read them with getRayHit
+static int lua_batch_rayCirclesAll(lua_State *L)
+{
+    return batch_rayQuery(0, 1);
+}
+
+// batch:rayPolysAll(origin, dir, maxT, [broadphase]) -> number of hits, read them with getRayHit
+static int lua_batch_rayPolysAll(lua_State *L)
+{
+    return batch_rayQuery(1, 1);
+}
+
+// batch:getRayHit(i) -> index, t, normalX, normalY, pointX, pointY of hit i (1-based, sorted by t)
+// of the last rayCirclesAll / rayPolysAll call
+static int lua_batch_getRayHit(lua_State *L)
+{
+    CollisionBatch *batch = pd->lua->getArgObject(1, BATCH_TYPE_NAME, NULL);
+    int i = pd->lua->getArgInt(2) - 1;
+
+    if (i < 0 || i >= batch->rayHitCount)
+        return 0;
+
+    pd->lua->pushInt(batch->rayHits[i].index + 1);
+    return 1 + pushRayHit(&batch->rayHits[i].hit);
+}
+
+// batch:getResult(i) -> a, b, resolveX, resolveY, depth of collision i (1-based) of the last call
+static int lua_batch_getResult(lua_State *L)
+{
+    CollisionBatch *batch = pd->lua->getArgObject(1, BATCH_TYPE_NAME, NULL);
+    int i = pd->lua->getArgInt(2) - 1;
+
+    if (i < 0 || i >= batch->resultCount)
+        return 0;
+
+    CollisionResult *res = &batch->results[i];
+    pd->lua->pushInt(res->a + 1);
+    pd->lua->pushInt(res->b + 1);
+    pd->lua->pushFloat(res->resolveDir.x);
+    pd->lua->pushFloat(res->resolveDir.y);
+    pd->lua->pushFloat(res->depth);
+    return 5;
+}
+
+static const lua_reg batchlib[] =
+{
+    { "new",            lua_batch_new },
+    { "__gc",           lua_batch_free },
+    { "setCircle",      lua_batch_setCircle },
+    { "setPoly",        lua_batch_setPoly },
+    { "clear",          lua_batch_clear },
+    { "setMethod",      lua_batch_setMethod },
+    { "circleCircle",   lua_batch_circleCircle },
+    { "circlePoly",     lua_batch_circlePoly },
+    { "polyPoly",       lua_batch_polyPoly },
+    { "getResult",      lua_batch_getResult },
+    { "rayCircles",     lua_batch_rayCircles },
+    { "rayPolys",       lua_batch_rayPolys },
+    { "rayCirclesAll",  lua_batch_rayCirclesAll },
+    { "rayPolysAll",    lua_batch_rayPolysAll },
+    { "getRayHit",      lua_batch_getRayHit },
+    { NULL, NULL }
+};
+
 static const lua_reg collisionlib[] =
 {
 	{ "circleCircle_check", lua_collision_circleCircle_check },
@@ -470,6 +2902,19 @@ static const lua_reg collisionlib[] =
 	{ "circleCircle", lua_collision_circleCircle },
 	{ "circlePoly", lua_collision_circlePoly },
 	{ "polyPoly", lua_collision_polyPoly },
+	{ "circleCircle_into", lua_collision_circleCircle_into },
+	{ "circlePoly_into", lua_collision_circlePoly_into },
+	{ "polyPoly_into", lua_collision_polyPoly_into },
+	{ "polyPoly_manifold", lua_collision_polyPoly_manifold },
+	{ "circlePoly_swept", lua_collision_circlePoly_swept },
+	{ "polyPoly_swept", lua_collision_polyPoly_swept },
+	{ "rayCircle", lua_collision_rayCircle },
+	{ "rayPoly", lua_collision_rayPoly },
+	{ "aabbAABB", lua_collision_aabbAABB },
+	{ "aabbCircle", lua_collision_aabbCircle },
+	{ "capsuleCircle", lua_collision_capsuleCircle },
+	{ "capsuleCapsule", lua_collision_capsuleCapsule },
+	{ "segmentPoly", lua_collision_segmentPoly },
 	{ "swordRes", lua_collision_swordResolution },
 	{ NULL, NULL }
 };
@@ -482,4 +2927,7 @@ void registerCollision(PlaydateAPI* playdate)
 	
 	if (!pd->lua->registerClass(COLLISION_TYPE_NAME, collisionlib, NULL, 0, &err))
 		pd->system->error("%s:%i: registerClass failed, %s", __FILE__, __LINE__, err);
+
+	if (!pd->lua->registerClass(BATCH_TYPE_NAME, batchlib, NULL, 0, &err))
+		pd->system->error("%s:%i: registerClass failed, %s", __FILE__, __LINE__, err);
 }
\ No newline at end of file
@@ -4,8 +4,109 @@
 #include "pd_api.h"
 #include "vector2d.h"
 #include "polygon.h"
+#include "broadphase.h"
 
 #define COLLISION_TYPE_NAME "collision"
+#define BATCH_TYPE_NAME "collision.batch"
+
+// Narrowphase algorithm for polygons (circleCircle is always closed form).
+// SAT tests every edge normal, GJK/EPA (see gjk.h) only walks the support points.
+typedef enum
+{
+    COLLISION_SAT,
+    COLLISION_GJK
+} CollisionMethod;
+
+// Result of a batched collision call. a and b are indices into the input arrays
+// (for circlePoly a is the circle, b the polygon), resolveDir and depth are the
+// same as returned by the single collision functions.
+typedef struct
+{
+    int a;
+    int b;
+    Vector2D resolveDir;
+    float depth;
+} CollisionResult;
+
+// Result of a swept collision function. toi (time of impact) is the fraction of the
+// movement at which the shapes first touch, normal points from the moving shape to the
+// other (like resolveDir) and point is the contact point at that time.
+typedef struct
+{
+    float toi;
+    Vector2D normal;
+    Vector2D point;
+} SweepResult;
+
+// Primitive shapes with their own closed form collision functions. A capsule is every
+// point within radius of the segment a-b (e.g. a character), a segment has no radius
+// (e.g. a sword or a laser). Axis-aligned boxes use AABB from aabb.h.
+typedef struct
+{
+    Vector2D a;
+    Vector2D b;
+    float radius;
+} Capsule;
+
+typedef struct
+{
+    Vector2D a;
+    Vector2D b;
+} Segment;
+
+// Contact points of two overlapping polygons. normal and depth are the same as the
+// resolveDir and depth of collision_polyPoly, points[i] are the (1 or 2) points of the
+// incident polygon inside the other one, depths[i] their penetration along normal.
+typedef struct
+{
+    Vector2D normal;
+    float depth;
+    int pointCount;
+    Vector2D points[2];
+    float depths[2];
+} ContactManifold;
+
+// Hit of a ray origin + dir * t with a shape. point = origin + dir * t, normal is the
+// surface normal of the shape at point (pointing back towards the ray).
+typedef struct
+{
+    float t;
+    Vector2D normal;
+    Vector2D point;
+} RayHit;
+
+// Ray hit of a batch query, index is the circle or polygon index in the batch
+typedef struct
+{
+    int index;
+    RayHit hit;
+} BatchRayHit;
+
+// Collision bodies as structure of arrays, used by the batch functions
+typedef struct
+{
+    float *x;
+    float *y;
+    float *r;
+    int circleCount;
+    int circleCapacity;
+
+    Polygon **polys;
+    LuaUDObject **polyRefs;
+    int polyCount;
+    int polyCapacity;
+
+    CollisionResult *results;
+    int resultCount;
+    int resultCapacity;
+
+    // sorted by t, result of the last rayCirclesAll / rayPolysAll
+    BatchRayHit *rayHits;
+    int rayHitCount;
+    int rayHitCapacity;
+
+    CollisionMethod method;
+} CollisionBatch;
 
 int collision_circleCircle_check(Vector2D centerA, float radiusA, Vector2D centerB, float radiusB);
 int collision_polyPoly_check(Polygon polyA, Polygon polyB);
@@ -15,6 +116,57 @@ int collision_circleCircle(Vector2D *resolveDir, float *depth, Vector2D centerA,
 int collision_polyPoly(Vector2D *resolveDir, float *depth, Polygon polyA, Polygon polyB);
 int collision_circlePoly(Vector2D *resolveDir, float *depth, Vector2D center, float radius, Polygon poly);
 
+// collision_polyPoly plus the contact manifold, found by clipping the incident edge against
+// the reference edge on the minimum penetration axis. Both polygons need to be convex.
+int collision_polyPoly_manifold(ContactManifold *manifold, Polygon polyA, Polygon polyB);
+
+// Closed form functions for the primitive shapes, same contract as the functions above
+// (resolveDir points from the first to the second shape)
+int collision_aabbAABB(Vector2D *resolveDir, float *depth, AABB boxA, AABB boxB);
+int collision_aabbCircle(Vector2D *resolveDir, float *depth, AABB box, Vector2D center, float radius);
+int collision_capsuleCircle(Vector2D *resolveDir, float *depth, Capsule capsule, Vector2D center, float radius);
+int collision_capsuleCapsule(Vector2D *resolveDir, float *depth, Capsule capsuleA, Capsule capsuleB);
+int collision_segmentPoly(Vector2D *resolveDir, float *depth, Segment segment, Polygon poly);
+
+// Same results using GJK/EPA instead of SAT
+int collision_polyPoly_gjk_check(Polygon polyA, Polygon polyB);
+int collision_circlePoly_gjk_check(Vector2D center, float radius, Polygon poly);
+int collision_polyPoly_gjk(Vector2D *resolveDir, float *depth, Polygon polyA, Polygon polyB);
+int collision_circlePoly_gjk(Vector2D *resolveDir, float *depth, Vector2D center, float radius, Polygon poly);
+
+// Swept (continuous) tests of a shape moving by move against a static polygon, so fast
+// shapes do not tunnel through thin geometry. Return 0 if they do not touch during the
+// movement. Shapes already overlapping at the start return toi = 0 and the normal of
+// collision_circlePoly / collision_polyPoly.
+int collision_circlePoly_swept(SweepResult *result, Vector2D center, float radius, Vector2D move, Polygon poly);
+// polyA moves, both polygons need to be convex
+int collision_polyPoly_swept(SweepResult *result, Polygon polyA, Vector2D move, Polygon polyB);
+
+// Ray casts: the ray is origin + dir * t for 0 <= t <= maxT, so with a normalized dir t is
+// the distance, and a segment from start to end is dir = end - start with maxT = 1.
+// Rays starting inside the shape hit at t = 0 with the normal opposite to dir.
+int collision_rayCircle(RayHit *hit, Vector2D origin, Vector2D dir, float maxT, Vector2D center, float radius);
+// Uses the (cached) SAT axes for convex polygons, tests every edge for others
+int collision_rayPoly(RayHit *hit, Vector2D origin, Vector2D dir, float maxT, Polygon poly);
+
+// Batch functions test many shapes in one call and write all collisions to results.
+// They return the total number of collisions found, but write at most maxResults
+// entries. If the return value is > maxResults, call again with a bigger buffer.
+
+// all pairs of circles
+int collision_circleCircle_batch(CollisionResult *results, int maxResults, const float *x, const float *y, const float *r, int count);
+// only the given candidate pairs (e.g. from a broadphase), indices into x/y/r
+int collision_circleCircle_batchPairs(CollisionResult *results, int maxResults, const float *x, const float *y, const float *r, const CollisionPair *pairs, int pairCount);
+// every circle against every polygon
+int collision_circlePoly_batch(CollisionResult *results, int maxResults, const float *x, const float *y, const float *r, int circleCount, Polygon *const *polys, int polyCount, CollisionMethod method);
+// all pairs of polygons
+int collision_polyPoly_batch(CollisionResult *results, int maxResults, Polygon *const *polys, int count, CollisionMethod method);
+// only the given candidate pairs (e.g. from a broadphase), indices into polys
+int collision_polyPoly_batchPairs(CollisionResult *results, int maxResults, Polygon *const *polys, const CollisionPair *pairs, int pairCount, CollisionMethod method);
+
+// Reads the optional "sat" or "gjk" Lua argument at pos, SAT when missing
+CollisionMethod collision_getMethodArg(int pos);
+
 void registerCollision(PlaydateAPI *playdate);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,387 @@
+#include "gjk.h"
+#include "util.h"
+
+#define GJK_MAX_ITERATIONS 32
+#define EPA_MAX_ITERATIONS 32
+#define EPA_MAX_POINTS (EPA_MAX_ITERATIONS + 3)
+// relative tolerance of the GJK distance, absolute tolerance (in pixels) of the EPA depth
+#define GJK_TOLERANCE 1e-5f
+#define EPA_TOLERANCE 1e-3f
+
+// Points of the Minkowski difference b - a, which contains the origin when a and b overlap
+typedef struct
+{
+    Vector2D v[3];
+    int count;
+} Simplex;
+
+// -- HELPER ---
+
+static inline Vector2D sub(Vector2D a, Vector2D b)
+{
+    Vector2D r = { a.x - b.x, a.y - b.y };
+    return r;
+}
+
+static inline Vector2D lerp(Vector2D a, Vector2D b, float t)
+{
+    Vector2D r = { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t };
+    return r;
+}
+
+static inline float square(float v)
+{
+    return v * v;
+}
+
+static inline float cross(Vector2D a, Vector2D b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+static Vector2D support(const SupportShape *shape, Vector2D dir)
+{
+    if (shape->count == 0)
+        return shape->center;
+
+    // search the local vertices with the direction rotated into local space
+    if (shape->transformed)
+    {
+        Vector2D local = {
+            .x = dir.x * shape->cosRot + dir.y * shape->sinRot,
+            .y = dir.y * shape->cosRot - dir.x * shape->sinRot
+        };
+        dir = local;
+    }
+
+    int best = 0;
+    float bestDot = vector2D_dotProduct(shape->verts[0], dir);
+    for (int i = 1; i < shape->count; ++i)
+    {
+        float d = vector2D_dotProduct(shape->verts[i], dir);
+        if (d > bestDot)
+        {
+            bestDot = d;
+            best = i;
+        }
+    }
+    if (!shape->transformed)
+        return shape->verts[best];
+
+    Vector2D v = shape->verts[best];
+    Vector2D result = {
+        .x = shape->position.x + v.x * shape->cosRot - v.y * shape->sinRot,
+        .y = shape->position.y + v.x * shape->sinRot + v.y * shape->cosRot
+    };
+    return result;
+}
+
+// Support point of the Minkowski difference b - a (ignoring the radii)
+static inline Vector2D supportDiff(const SupportShape *a, const SupportShape *b, Vector2D dir)
+{
+    Vector2D negDir = { -dir.x, -dir.y };
+    return sub(support(b, dir), support(a, negDir));
+}
+
+// Reduces the simplex to the feature closest to the origin and returns the closest point.
+// Returns 1 if the origin is inside the simplex (triangle).
+static int closestToOrigin(Simplex *s, Vector2D *closest)
+{
+    Vector2D a = s->v[0];
+    if (s->count == 1)
+    {
+        *closest = a;
+        return 0;
+    }
+
+    Vector2D b = s->v[1];
+    Vector2D ab = sub(b, a);
+    if (s->count == 2)
+    {
+        float t = -vector2D_dotProduct(a, ab);
+        float len = vector2D_lengthSquared(ab);
+        if (t <= 0 || len == 0)
+        {
+            s->count = 1;
+            *closest = a;
+        }
+        else if (t >= len)
+        {
+            s->v[0] = b;
+            s->count = 1;
+            *closest = b;
+        }
+        else
+        {
+            *closest = lerp(a, b, t / len);
+        }
+        return 0;
+    }
+
+    // triangle, voronoi regions as in Ericson, Real-Time Collision Detection 5.1.5
+    Vector2D c = s->v[2];
+    Vector2D ac = sub(c, a);
+    float d1 = -vector2D_dotProduct(ab, a);
+    float d2 = -vector2D_dotProduct(ac, a);
+    if (d1 <= 0 && d2 <= 0)
+    {
+        s->count = 1;
+        *closest = a;
+        return 0;
+    }
+
+    float d3 = -vector2D_dotProduct(ab, b);
+    float d4 = -vector2D_dotProduct(ac, b);
+    if (d3 >= 0 && d4 <= d3)
+    {
+        s->v[0] = b;
+        s->count = 1;
+        *closest = b;
+        return 0;
+    }
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+    {
+        s->count = 2;
+        *closest = lerp(a, b, d1 / (d1 - d3));
+        return 0;
+    }
+
+    float d5 = -vector2D_dotProduct(ab, c);
+    float d6 = -vector2D_dotProduct(ac, c);
+    if (d6 >= 0 && d5 <= d6)
+    {
+        s->v[0] = c;
+        s->count = 1;
+        *closest = c;
+        return 0;
+    }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+    {
+        s->v[1] = c;
+        s->count = 2;
+        *closest = lerp(a, c, d2 / (d2 - d6));
+        return 0;
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+    {
+        s->v[0] = c;
+        s->count = 2;
+        *closest = lerp(b, c, (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        return 0;
+    }
+
+    closest->x = 0;
+    closest->y = 0;
+    return 1;
+}
+
+// Runs GJK on the shapes without radius. Returns 1 if they overlap, otherwise closest
+// is the point of b - a closest to the origin. Stops early (returning 0) once the
+// distance is known to be larger than maxDist.
+static int gjk(Vector2D *closest, Simplex *s, const SupportShape *a, const SupportShape *b, float maxDist)
+{
+    Vector2D dir = { 1, 0 };
+
+    s->v[0] = supportDiff(a, b, dir);
+    s->count = 1;
+
+    for (int iter = 0; iter < GJK_MAX_ITERATIONS; ++iter)
+    {
+        if (closestToOrigin(s, closest))
+            return 1;
+
+        float distSqr = vector2D_lengthSquared(*closest);
+        if (distSqr == 0)
+            return 1;
+
+        Vector2D negClosest = { -closest->x, -closest->y };
+        Vector2D w = supportDiff(a, b, negClosest);
+
+        // w is the furthest point towards the origin, its projection is a lower bound of the distance
+        float proj = vector2D_dotProduct(*closest, w);
+        if (proj > 0 && square(proj) > square(maxDist) * distSqr)
+            return 0;
+
+        if (distSqr - proj <= GJK_TOLERANCE * distSqr)
+            return 0;
+
+        s->v[s->count++] = w;
+    }
+
+    return 0;
+}
+
+// Expands the GJK simplex to the face of b - a closest to the origin.
+// normal is the outward normal of that face, depth its distance to the origin.
+static void epa(Vector2D *normal, float *depth, const Simplex *s, const SupportShape *a, const SupportShape *b)
+{
+    Vector2D points[EPA_MAX_POINTS];
+    int count = s->count;
+    for (int i = 0; i < count; ++i)
+        points[i] = s->v[i];
+
+    // GJK can stop with the origin on a vertex or edge, grow that into a triangle first
+    if (count == 1)
+    {
+        Vector2D dir = { 1, 0 };
+        points[1] = supportDiff(a, b, dir);
+        if (points[1].x == points[0].x && points[1].y == points[0].y)
+        {
+            dir.x = -1;
+            points[1] = supportDiff(a, b, dir);
+        }
+        count = 2;
+    }
+    if (count == 2)
+    {
+        Vector2D edge = sub(points[1], points[0]);
+        Vector2D dir;
+        vector2D_leftNormal(&dir, edge);
+        points[2] = supportDiff(a, b, dir);
+        if (fabsf(cross(edge, sub(points[2], points[0]))) <= EPA_TOLERANCE)
+        {
+            dir.x = -dir.x;
+            dir.y = -dir.y;
+            points[2] = supportDiff(a, b, dir);
+        }
+        count = 3;
+    }
+
+    // winding decides which edge normal points outwards
+    float winding = cross(sub(points[1], points[0]), sub(points[2], points[0]));
+    if (fabsf(winding) <= EPA_TOLERANCE)
+    {
+        // b - a has no area (both shapes are points or segments), any normal of it works
+        Vector2D edge = sub(points[1], points[0]);
+        if (edge.x == 0 && edge.y == 0)
+            edge = sub(points[2], points[0]);
+        vector2D_leftNormal(normal, edge);
+        if (normal->x == 0 && normal->y == 0)
+            normal->x = 1;
+        vector2D_normalize(normal);
+        *depth = 0;
+        return;
+    }
+    float sign = winding > 0 ? 1.0f : -1.0f;
+
+    for (int iter = 0; iter < EPA_MAX_ITERATIONS; ++iter)
+    {
+        int closestEdge = -1;
+        float closestDist = FLT_MAX;
+        Vector2D closestNormal = { 0, 0 };
+
+        for (int i = 0; i < count; ++i)
+        {
+            Vector2D p = points[i];
+            Vector2D edge = sub(points[(i + 1) % count], p);
+            if (edge.x == 0 && edge.y == 0)
+                continue;
+
+            Vector2D n = { edge.y * sign, -edge.x * sign };
+            vector2D_normalize(&n);
+            float dist = vector2D_dotProduct(n, p);
+            if (dist < closestDist)
+            {
+                closestDist = dist;
+                closestEdge = i;
+                closestNormal = n;
+            }
+        }
+
+        *normal = closestNormal;
+        *depth = closestDist;
+
+        Vector2D w = supportDiff(a, b, closestNormal);
+        if (vector2D_dotProduct(w, closestNormal) - closestDist <= EPA_TOLERANCE || count == EPA_MAX_POINTS)
+            return;
+
+        // insert the new point between the ends of the closest edge
+        for (int i = count; i > closestEdge + 1; --i)
+            points[i] = points[i - 1];
+        points[closestEdge + 1] = w;
+        ++count;
+    }
+}
+
+// --- SHAPES ---
+
+void supportShape_fromPoly(SupportShape *shape, Polygon poly)
+{
+    shape->verts = poly.verts;
+    shape->count = poly.count;
+    shape->center.x = 0;
+    shape->center.y = 0;
+    shape->radius = 0;
+    shape->transformed = poly.transformed;
+    shape->position = poly.position;
+    shape->cosRot = poly.cosRot;
+    shape->sinRot = poly.sinRot;
+}
+
+void supportShape_fromCircle(SupportShape *shape, Vector2D center, float radius)
+{
+    shape->verts = NULL;
+    shape->count = 0;
+    shape->center = center;
+    shape->radius = radius;
+    shape->transformed = 0;
+}
+
+void supportShape_fromPoints(SupportShape *shape, const Vector2D *verts, int count, float radius)
+{
+    shape->verts = verts;
+    shape->count = count;
+    shape->center.x = 0;
+    shape->center.y = 0;
+    shape->radius = radius;
+    shape->transformed = 0;
+}
+
+// --- GJK ---
+
+int gjk_check(SupportShape a, SupportShape b)
+{
+    Simplex s;
+    Vector2D closest;
+    float radius = a.radius + b.radius;
+
+    if (gjk(&closest, &s, &a, &b, radius))
+        return 1;
+
+    return vector2D_lengthSquared(closest) < square(radius);
+}
+
+int gjk_collide(Vector2D *resolveDir, float *depth, SupportShape a, SupportShape b)
+{
+    Simplex s;
+    Vector2D closest;
+    float radius = a.radius + b.radius;
+
+    if (!gjk(&closest, &s, &a, &b, radius))
+    {
+        // cores apart, only the rounded parts can overlap
+        float dist = vector2D_length(closest);
+        if (dist >= radius)
+            return 0;
+
+        resolveDir->x = closest.x / dist;
+        resolveDir->y = closest.y / dist;
+        *depth = radius - dist;
+        return 1;
+    }
+
+    Vector2D normal;
+    epa(&normal, depth, &s, &a, &b);
+
+    // moving b against the outward normal of b - a separates the shapes
+    resolveDir->x = -normal.x;
+    resolveDir->y = -normal.y;
+    *depth += radius;
+    return 1;
+}
@@ -0,0 +1,37 @@
+#ifndef _GJK_H
+#define _GJK_H
+
+#include "vector2d.h"
+#include "polygon.h"
+
+// GJK (boolean test and distance) and EPA (penetration depth) on convex shapes,
+// alternative to the SAT based functions in collision.h.
+// Shapes are only accessed through their support function, so any convex hull of
+// points rounded by a radius works: a circle is a single point with radius, a
+// capsule a segment with radius, a polygon a hull without radius.
+
+typedef struct
+{
+    const Vector2D *verts;
+    int count;          // 0 uses center as the only point
+    Vector2D center;
+    float radius;
+    // verts in local space, see Polygon.transformed
+    int transformed;
+    Vector2D position;
+    float cosRot;
+    float sinRot;
+} SupportShape;
+
+void supportShape_fromPoly(SupportShape *shape, Polygon poly);
+void supportShape_fromCircle(SupportShape *shape, Vector2D center, float radius);
+// Hull of count world space points rounded by radius, e.g. a capsule or a box
+void supportShape_fromPoints(SupportShape *shape, const Vector2D *verts, int count, float radius);
+
+// Boolean test, same as the collision_*_check functions
+int gjk_check(SupportShape a, SupportShape b);
+// Same contract as collision_polyPoly: resolveDir (length 1) points from a to b,
+// depth > 0. Returns 0 when not colliding.
+int gjk_collide(Vector2D *resolveDir, float *depth, SupportShape a, SupportShape b);
+
+#endif // _GJK_H
@@ -0,0 +1,306 @@
+#include "parallel.h"
+
+#if COLLISION_THREADS
+
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "util.h"
+
+static PlaydateAPI* pd = NULL;
+
+// Pairs per chunk: small enough to even out expensive pairs, big enough to keep stealing rare
+#define PARALLEL_CHUNK_SIZE 64
+// Below this many pairs waking the threads costs more than it saves
+#define PARALLEL_MIN_PAIRS 256
+
+typedef void (*ChunkFn)(void *job, int chunk);
+
+// Chunks [begin, end) of one thread, packed into one word (end in the upper half) so taking
+// a chunk is a single compare and swap. The owner takes from the front, thieves from the back.
+typedef struct
+{
+    _Atomic uint64_t range;
+    char padding[56];       // one queue per cache line
+} ChunkQueue;
+
+typedef struct
+{
+    struct ParallelPool *pool;
+    int index;
+} Worker;
+
+struct ParallelPool
+{
+    int threadCount;
+    // threads 1 to threadCount - 1, the calling thread is worker 0
+    pthread_t *threads;
+    Worker *workers;
+    ChunkQueue *queues;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t finished;
+    int generation;         // incremented for every call, wakes the workers
+    int busy;               // workers still running the current call
+    int quit;
+
+    ChunkFn fn;
+    void *job;
+
+    // PARALLEL_CHUNK_SIZE results per chunk and the number of collisions each chunk found
+    CollisionResult *chunkResults;
+    int chunkResultCapacity;
+    int *chunkHits;
+    int chunkHitCapacity;
+};
+
+typedef struct
+{
+    ParallelPool *pool;
+    const CollisionPair *pairs;
+    int pairCount;
+    const float *x;
+    const float *y;
+    const float *r;
+    Polygon *const *polys;
+    CollisionMethod method;
+} PairJob;
+
+// -- HELPER ---
+
+static inline uint64_t packRange(uint32_t begin, uint32_t end)
+{
+    return (uint64_t)end << 32 | begin;
+}
+
+// --- WORK STEALING ---
+
+static int takeFront(ChunkQueue *queue)
+{
+    uint64_t range = atomic_load_explicit(&queue->range, memory_order_relaxed);
+    for (;;)
+    {
+        uint32_t begin = (uint32_t)range;
+        uint32_t end = (uint32_t)(range >> 32);
+        if (begin >= end)
+            return -1;
+        if (atomic_compare_exchange_weak(&queue->range, &range, packRange(begin + 1, end)))
+            return (int)begin;
+    }
+}
+
+static int takeBack(ChunkQueue *queue)
+{
+    uint64_t range = atomic_load_explicit(&queue->range, memory_order_relaxed);
+    for (;;)
+    {
+        uint32_t begin = (uint32_t)range;
+        uint32_t end = (uint32_t)(range >> 32);
+        if (begin >= end)
+            return -1;
+        if (atomic_compare_exchange_weak(&queue->range, &range, packRange(begin, end - 1)))
+            return (int)end - 1;
+    }
+}
+
+// Runs chunks until every queue is empty. Chunks are never added during a call, so an empty
+// round means the remaining chunks are already being worked on.
+static void work(ParallelPool *pool, int self)
+{
+    for (;;)
+    {
+        int chunk = takeFront(&pool->queues[self]);
+        for (int i = 1; chunk < 0 && i < pool->threadCount; ++i)
+            chunk = takeBack(&pool->queues[(self + i) % pool->threadCount]);
+        if (chunk < 0)
+            return;
+        pool->fn(pool->job, chunk);
+    }
+}
+
+static void *workerMain(void *arg)
+{
+    Worker *worker = arg;
+    ParallelPool *pool = worker->pool;
+    int seen = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;)
+    {
+        while (pool->generation == seen && !pool->quit)
+            pthread_cond_wait(&pool->wake, &pool->mutex);
+        if (pool->quit)
+            break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+
+        work(pool, worker->index);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->busy == 0)
+            pthread_cond_signal(&pool->finished);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+// Splits chunks evenly over the queues, runs them on all threads and returns when all are done
+static void run(ParallelPool *pool, int chunkCount, ChunkFn fn, void *job)
+{
+    for (int t = 0; t < pool->threadCount; ++t)
+    {
+        uint32_t begin = (uint32_t)((long)chunkCount * t / pool->threadCount);
+        uint32_t end = (uint32_t)((long)chunkCount * (t + 1) / pool->threadCount);
+        atomic_store_explicit(&pool->queues[t].range, packRange(begin, end), memory_order_relaxed);
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->fn = fn;
+    pool->job = job;
+    pool->busy = pool->threadCount - 1;
+    ++pool->generation;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+
+    work(pool, 0);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->busy > 0)
+        pthread_cond_wait(&pool->finished, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+// --- POOL ---
+
+ParallelPool *parallel_newPool(int threadCount)
+{
+    if (threadCount <= 0)
+        threadCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threadCount <= 0)
+        threadCount = 1;
+
+    ParallelPool *pool = pd->system->realloc(NULL, sizeof(ParallelPool));
+    memset(pool, 0, sizeof(ParallelPool));
+    pool->threadCount = threadCount;
+    pool->threads = pd->system->realloc(NULL, sizeof(pthread_t) * threadCount);
+    pool->workers = pd->system->realloc(NULL, sizeof(Worker) * threadCount);
+    pool->queues = pd->system->realloc(NULL, sizeof(ChunkQueue) * threadCount);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->finished, NULL);
+
+    for (int t = 0; t < threadCount; ++t)
+    {
+        pool->workers[t].pool = pool;
+        pool->workers[t].index = t;
+        atomic_init(&pool->queues[t].range, 0);
+    }
+
+    for (int t = 1; t < threadCount; ++t)
+    {
+        if (pthread_create(&pool->threads[t], NULL, workerMain, &pool->workers[t]) != 0)
+        {
+            pd->system->logToConsole("%s:%i: starting thread %d failed", __FILE__, __LINE__, t);
+            pool->threadCount = t;
+            parallel_freePool(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+void parallel_freePool(ParallelPool *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int t = 1; t < pool->threadCount; ++t)
+        pthread_join(pool->threads[t], NULL);
+
+    pthread_cond_destroy(&pool->finished);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->mutex);
+    pd->system->realloc(pool->chunkResults, 0);
+    pd->system->realloc(pool->chunkHits, 0);
+    pd->system->realloc(pool->queues, 0);
+    pd->system->realloc(pool->workers, 0);
+    pd->system->realloc(pool->threads, 0);
+    pd->system->realloc(pool, 0);
+}
+
+int parallel_threadCount(const ParallelPool *pool)
+{
+    return pool->threadCount;
+}
+
+// --- BATCH ---
+
+static void circleCircleChunk(void *data, int chunk)
+{
+    PairJob *job = data;
+    int first = chunk * PARALLEL_CHUNK_SIZE;
+    int count = job->pairCount - first < PARALLEL_CHUNK_SIZE ? job->pairCount - first : PARALLEL_CHUNK_SIZE;
+    job->pool->chunkHits[chunk] = collision_circleCircle_batchPairs(&job->pool->chunkResults[first], count,
+                                                                    job->x, job->y, job->r, &job->pairs[first], count);
+}
+
+static void polyPolyChunk(void *data, int chunk)
+{
+    PairJob *job = data;
+    int first = chunk * PARALLEL_CHUNK_SIZE;
+    int count = job->pairCount - first < PARALLEL_CHUNK_SIZE ? job->pairCount - first : PARALLEL_CHUNK_SIZE;
+    job->pool->chunkHits[chunk] = collision_polyPoly_batchPairs(&job->pool->chunkResults[first], count,
+                                                                job->polys, &job->pairs[first], count, job->method);
+}
+
+// A chunk finds at most one collision per pair, so its results fit into its own slice
+static int runPairs(ParallelPool *pool, PairJob *job, ChunkFn fn, CollisionResult *results, int maxResults)
+{
+    int chunkCount = (job->pairCount + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+    pool->chunkResults = ensureCapacity(pd->system->realloc, pool->chunkResults, &pool->chunkResultCapacity, chunkCount * PARALLEL_CHUNK_SIZE, sizeof(CollisionResult));
+    pool->chunkHits = ensureCapacity(pd->system->realloc, pool->chunkHits, &pool->chunkHitCapacity, chunkCount, sizeof(int));
+
+    run(pool, chunkCount, fn, job);
+
+    int hits = 0;
+    for (int c = 0; c < chunkCount; ++c)
+    {
+        int count = pool->chunkHits[c];
+        int room = maxResults - hits;
+        if (room > 0)
+            memcpy(&results[hits], &pool->chunkResults[c * PARALLEL_CHUNK_SIZE], sizeof(CollisionResult) * (count < room ? count : room));
+        hits += count;
+    }
+    return hits;
+}
+
+int parallel_circleCircle_batchPairs(ParallelPool *pool, CollisionResult *results, int maxResults, const float *x, const float *y, const float *r, const CollisionPair *pairs, int pairCount)
+{
+    if (pool->threadCount == 1 || pairCount < PARALLEL_MIN_PAIRS)
+        return collision_circleCircle_batchPairs(results, maxResults, x, y, r, pairs, pairCount);
+
+    PairJob job = { .pool = pool, .pairs = pairs, .pairCount = pairCount, .x = x, .y = y, .r = r };
+    return runPairs(pool, &job, circleCircleChunk, results, maxResults);
+}
+
+int parallel_polyPoly_batchPairs(ParallelPool *pool, CollisionResult *results, int maxResults, Polygon *const *polys, const CollisionPair *pairs, int pairCount, CollisionMethod method)
+{
+    if (pool->threadCount == 1 || pairCount < PARALLEL_MIN_PAIRS)
+        return collision_polyPoly_batchPairs(results, maxResults, polys, pairs, pairCount, method);
+
+    PairJob job = { .pool = pool, .pairs = pairs, .pairCount = pairCount, .polys = polys, .method = method };
+    return runPairs(pool, &job, polyPolyChunk, results, maxResults);
+}
+
+void registerParallel(PlaydateAPI* playdate)
+{
+    pd = playdate;
+}
+
+#endif // COLLISION_THREADS
@@ -0,0 +1,49 @@
+#ifndef _PARALLEL_H
+#define _PARALLEL_H
+
+#include "pd_api.h"
+#include "polygon.h"
+#include "collision.h"
+#include "broadphase.h"
+
+// Multithreaded batch narrowphase for host and server builds (POSIX threads). Only compiled
+// in with COLLISION_THREADS=1 (CMake option COLLISION_THREADS of the host build), the device
+// build does not include it and stays single threaded.
+//
+// The candidate pairs are split into chunks. Every thread of the pool takes chunks from its
+// own queue and steals from the other queues once it runs empty. Each chunk collects its
+// collisions separately and they are concatenated in chunk order, so the results are the
+// same, in the same order, as from the single-threaded batchPairs functions.
+//
+// The collision kernels only read the shapes and keep no state of their own, the static pd
+// pointers are set once by the registerX functions (before any pool is created) and only read
+// afterwards. Shapes must not be changed while a parallel call runs, and a pool runs one call
+// at a time. With COLLISION_STATS every chunk counts as one narrowphase call.
+#ifndef COLLISION_THREADS
+#define COLLISION_THREADS 0
+#endif
+
+#if COLLISION_THREADS
+
+typedef struct ParallelPool ParallelPool;
+
+// threadCount includes the calling thread, which works on the chunks as well. 0 uses one
+// thread per core. Returns NULL if the threads could not be started.
+ParallelPool *parallel_newPool(int threadCount);
+void parallel_freePool(ParallelPool *pool);
+int parallel_threadCount(const ParallelPool *pool);
+
+// Same contract and results as collision_circleCircle_batchPairs / collision_polyPoly_batchPairs
+int parallel_circleCircle_batchPairs(ParallelPool *pool, CollisionResult *results, int maxResults, const float *x, const float *y, const float *r, const CollisionPair *pairs, int pairCount);
+int parallel_polyPoly_batchPairs(ParallelPool *pool, CollisionResult *results, int maxResults, Polygon *const *polys, const CollisionPair *pairs, int pairCount, CollisionMethod method);
+
+// Only stores the API for allocations, there are no Lua hooks
+void registerParallel(PlaydateAPI *playdate);
+
+#else
+
+#define registerParallel(playdate) ((void)(playdate))
+
+#endif // COLLISION_THREADS
+
+#endif // _PARALLEL_H
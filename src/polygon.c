@@ -1,26 +1,589 @@
 #include "polygon.h"
+#include "stats.h"
+#include "simd.h"
+#include "util.h"
 #include <stdio.h>
 
 static PlaydateAPI* pd = NULL;
 
+// max. cross product of two unit normals still considered parallel
+#define PARALLEL_EPSILON 1e-5f
+#define DEG_TO_RAD 0.017453292519943295f
+// poly:unpack() pushes 2 values per vertex, the Lua stack of a C function only guarantees
+// 20 free slots. Bigger polygons go through poly:pack().
+#define UNPACK_MAX_VERTS 8
+
+// scratch of poly:pack()
+static float *packBuffer = NULL;
+static int packCapacity = 0;
+
 static inline float square(float v)
 {
     return v * v;
 }
 
+static inline Vector2D worldVertex(Polygon p, int i)
+{
+    if (!p.transformed)
+        return p.verts[i];
+
+    Vector2D v = p.verts[i];
+    Vector2D result = {
+        .x = p.position.x + v.x * p.cosRot - v.y * p.sinRot,
+        .y = p.position.y + v.x * p.sinRot + v.y * p.cosRot
+    };
+    return result;
+}
+
 static void polygon_middle(Vector2D *dest, Polygon p)
 {
     float sumX = 0.0f;
     float sumY = 0.0f;
     for (int i=0; i < p.count; ++i)
     {
-        sumX += p.verts[i].x;
-        sumY += p.verts[i].y;
+        Vector2D v = worldVertex(p, i);
+        sumX += v.x;
+        sumY += v.y;
     }
     dest->x = sumX / p.count;
     dest->y = sumY / p.count;
 }
 
+Polygon *polygon_new(int count)
+{
+    Polygon *p = pd->system->realloc(NULL, sizeof(Polygon));
+    STATS_COUNT(STAT_ALLOCS);
+    p->count = count;
+    p->verts = pd->system->realloc(NULL, sizeof(Vector2D) * p->count);
+    memset(p->verts, 0, sizeof(Vector2D) * p->count);
+    p->normals = NULL;
+    p->normalCount = 0;
+    p->convex = 0;
+    p->transformed = 0;
+    p->position.x = p->position.y = 0;
+    p->rotation = 0;
+    p->cosRot = 1;
+    p->sinRot = 0;
+    p->dirty = POLY_DIRTY_ALL;
+    p->parts = NULL;
+    p->partCount = 0;
+    p->partVerts = NULL;
+    p->partNormals = NULL;
+    p->partBuffer = NULL;
+    p->partCapacity = 0;
+    p->partVertCapacity = 0;
+    p->scratch = NULL;
+    p->scratchCapacity = 0;
+    p->soa = NULL;
+    p->soaCount = 0;
+    return p;
+}
+
+// Only detaches the parts, their buffers are reused by the next decompose
+static void clearParts(Polygon *p)
+{
+    p->parts = NULL;
+    p->partCount = 0;
+}
+
+void polygon_free(Polygon *p)
+{
+    pd->system->realloc(p->partBuffer, 0);
+    pd->system->realloc(p->partVerts, 0);
+    pd->system->realloc(p->partNormals, 0);
+    pd->system->realloc(p->scratch, 0);
+    pd->system->realloc(p->soa, 0);
+    pd->system->realloc(p->verts, 0);
+    pd->system->realloc(p->normals, 0);
+    pd->system->realloc(p, 0);
+}
+
+void polygon_cacheNormals(Polygon *p)
+{
+    STATS_COUNT(STAT_NORMALS);
+    if (p->normals == NULL)
+    {
+        p->normals = pd->system->realloc(NULL, sizeof(Vector2D) * p->count);
+        STATS_COUNT(STAT_ALLOCS);
+    }
+
+    p->normalCount = 0;
+    for (int i = 0; i < p->count; ++i)
+    {
+        Vector2D edge = p->verts[(i + 1) % p->count];
+        edge.x -= p->verts[i].x;
+        edge.y -= p->verts[i].y;
+        if (edge.x == 0 && edge.y == 0)
+            continue;
+
+        Vector2D normal;
+        vector2D_leftNormal(&normal, edge);
+        vector2D_normalize(&normal);
+
+        int unique = 1;
+        for (int k = 0; k < p->normalCount; ++k)
+        {
+            if (fabsf(normal.x * p->normals[k].y - normal.y * p->normals[k].x) <= PARALLEL_EPSILON)
+            {
+                unique = 0;
+                break;
+            }
+        }
+        if (unique)
+            p->normals[p->normalCount++] = normal;
+    }
+}
+
+void polygon_clearNormals(Polygon *p)
+{
+    pd->system->realloc(p->normals, 0);
+    p->normals = NULL;
+    p->normalCount = 0;
+}
+
+// --- CONVEX DECOMPOSITION ---
+
+// > 0 for a left turn a -> b -> c
+static inline float turn(Vector2D a, Vector2D b, Vector2D c)
+{
+    return (b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x);
+}
+
+// Convex pieces as lists of vertex indices, each with room for the whole polygon.
+// ring and merged are the work lists of triangulate and mergePieces.
+typedef struct
+{
+    int *indices;
+    int *counts;
+    int *ring;
+    int *merged;
+    int pieceCount;
+    int stride;
+} Pieces;
+
+static int isEar(Polygon *p, const int *ring, int ringCount, int i, float sign)
+{
+    Vector2D a = p->verts[ring[(i + ringCount - 1) % ringCount]];
+    Vector2D b = p->verts[ring[i]];
+    Vector2D c = p->verts[ring[(i + 1) % ringCount]];
+
+    for (int k = 0; k < ringCount; ++k)
+    {
+        Vector2D v = p->verts[ring[k]];
+        if ((v.x == a.x && v.y == a.y) || (v.x == b.x && v.y == b.y) || (v.x == c.x && v.y == c.y))
+            continue;
+        if (turn(a, b, v) * sign >= 0 && turn(b, c, v) * sign >= 0 && turn(c, a, v) * sign >= 0)
+            return 0;
+    }
+    return 1;
+}
+
+// Ear clipping, writes n - 2 triangles at most. Returns 0 if the polygon is self-intersecting.
+static int triangulate(Polygon *p, Pieces *pieces, float sign)
+{
+    int *ring = pieces->ring;
+    int ringCount = p->count;
+    for (int i = 0; i < ringCount; ++i)
+        ring[i] = i;
+
+    while (ringCount >= 3)
+    {
+        int clipped = -1;
+        for (int i = 0; i < ringCount && clipped < 0; ++i)
+        {
+            Vector2D a = p->verts[ring[(i + ringCount - 1) % ringCount]];
+            Vector2D b = p->verts[ring[i]];
+            Vector2D c = p->verts[ring[(i + 1) % ringCount]];
+            float t = turn(a, b, c) * sign;
+            // collinear vertices are dropped without a triangle
+            if (t == 0)
+            {
+                clipped = i;
+            }
+            else if (t > 0 && isEar(p, ring, ringCount, i, sign))
+            {
+                int *tri = &pieces->indices[pieces->pieceCount * pieces->stride];
+                tri[0] = ring[(i + ringCount - 1) % ringCount];
+                tri[1] = ring[i];
+                tri[2] = ring[(i + 1) % ringCount];
+                pieces->counts[pieces->pieceCount++] = 3;
+                clipped = i;
+            }
+        }
+
+        if (clipped < 0)
+            return 0;
+        memmove(&ring[clipped], &ring[clipped + 1], sizeof(int) * (ringCount - clipped - 1));
+        --ringCount;
+    }
+
+    return pieces->pieceCount > 0;
+}
+
+static int isConvexPiece(Polygon *p, const int *piece, int count, float sign)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        if (turn(p->verts[piece[i]], p->verts[piece[(i + 1) % count]], p->verts[piece[(i + 2) % count]]) * sign < 0)
+            return 0;
+    }
+    return 1;
+}
+
+// Hertel-Mehlhorn: removes diagonals between two pieces as long as the merged piece stays convex
+static void mergePieces(Polygon *p, Pieces *pieces, float sign)
+{
+    int *merged = pieces->merged;
+    int changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (int a = 0; a < pieces->pieceCount && !changed; ++a)
+        {
+            int *pieceA = &pieces->indices[a * pieces->stride];
+            int countA = pieces->counts[a];
+            for (int b = a + 1; b < pieces->pieceCount && !changed; ++b)
+            {
+                int *pieceB = &pieces->indices[b * pieces->stride];
+                int countB = pieces->counts[b];
+                if (countA + countB - 2 > pieces->stride)
+                    continue;
+
+                // shared diagonal u -> w in a is w -> u in b
+                for (int ia = 0; ia < countA && !changed; ++ia)
+                {
+                    int u = pieceA[ia];
+                    int w = pieceA[(ia + 1) % countA];
+                    for (int ib = 0; ib < countB; ++ib)
+                    {
+                        if (pieceB[ib] != w || pieceB[(ib + 1) % countB] != u)
+                            continue;
+
+                        // a from w around to u, then the rest of b
+                        int count = 0;
+                        for (int k = 1; k <= countA; ++k)
+                            merged[count++] = pieceA[(ia + k) % countA];
+                        for (int k = 2; k < countB; ++k)
+                            merged[count++] = pieceB[(ib + k) % countB];
+
+                        if (isConvexPiece(p, merged, count, sign))
+                        {
+                            memcpy(pieceA, merged, sizeof(int) * count);
+                            pieces->counts[a] = count;
+                            int last = pieces->pieceCount - 1;
+                            memcpy(pieceB, &pieces->indices[last * pieces->stride], sizeof(int) * pieces->counts[last]);
+                            pieces->counts[b] = pieces->counts[last];
+                            --pieces->pieceCount;
+                            changed = 1;
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Splits a concave polygon into convex parts, stored contiguously in p->parts
+static void decompose(Polygon *p)
+{
+    float area = 0;
+    for (int i = 0; i < p->count; ++i)
+    {
+        Vector2D a = p->verts[i];
+        Vector2D b = p->verts[(i + 1) % p->count];
+        area += a.x * b.y - b.x * a.y;
+    }
+    if (area == 0)
+        return;
+    float sign = area > 0 ? 1.0f : -1.0f;
+
+    // indices, counts, ring and merged in one scratch buffer
+    int maxPieces = p->count - 2;
+    p->scratch = ensureCapacity(pd->system->realloc, p->scratch, &p->scratchCapacity, (p->count + 1) * maxPieces + 2 * p->count, sizeof(int));
+    Pieces pieces = { .stride = p->count };
+    pieces.indices = p->scratch;
+    pieces.counts = &pieces.indices[p->count * maxPieces];
+    pieces.ring = &pieces.counts[maxPieces];
+    pieces.merged = &pieces.ring[p->count];
+
+    if (triangulate(p, &pieces, sign))
+    {
+        mergePieces(p, &pieces, sign);
+
+        int vertCount = 0;
+        for (int i = 0; i < pieces.pieceCount; ++i)
+            vertCount += pieces.counts[i];
+
+        STATS_COUNT(STAT_DECOMPOSITIONS);
+        p->partBuffer = ensureCapacity(pd->system->realloc, p->partBuffer, &p->partCapacity, pieces.pieceCount, sizeof(Polygon));
+        int vertCapacity = p->partVertCapacity;
+        p->partVerts = ensureCapacity(pd->system->realloc, p->partVerts, &vertCapacity, vertCount, sizeof(Vector2D));
+        p->partNormals = ensureCapacity(pd->system->realloc, p->partNormals, &p->partVertCapacity, vertCount, sizeof(Vector2D));
+        p->parts = p->partBuffer;
+        p->partCount = pieces.pieceCount;
+
+        int offset = 0;
+        for (int i = 0; i < p->partCount; ++i)
+        {
+            Polygon *part = &p->parts[i];
+            memset(part, 0, sizeof(Polygon));
+            part->count = pieces.counts[i];
+            part->verts = &p->partVerts[offset];
+            part->normals = &p->partNormals[offset];
+            for (int k = 0; k < part->count; ++k)
+                part->verts[k] = p->verts[pieces.indices[i * pieces.stride + k]];
+            offset += part->count;
+
+            part->convex = 1;
+            part->cosRot = 1;
+            // normals are in local space like the vertices, only the bounds follow the polygon
+            polygon_cacheNormals(part);
+            part->dirty = POLY_DIRTY_BOUNDS;
+        }
+    }
+}
+
+static int isConvex(Polygon *p)
+{
+    if (p->count < 3)
+        return 0;
+
+    // All turns have to go in the same direction and the edges may only change
+    // their x and y direction twice each (which rules out self-intersecting stars).
+    int turnSign = 0;
+    int xChanges = 0, yChanges = 0;
+    int xSign = 0, ySign = 0;
+    int xFirst = 0, yFirst = 0;
+    for (int i = 0; i < p->count; ++i)
+    {
+        Vector2D a = p->verts[i];
+        Vector2D b = p->verts[(i + 1) % p->count];
+        Vector2D c = p->verts[(i + 2) % p->count];
+        float cross = (b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x);
+        int sign = (cross > 0) - (cross < 0);
+        if (sign != 0)
+        {
+            if (turnSign != 0 && sign != turnSign)
+                return 0;
+            turnSign = sign;
+        }
+
+        float dx = b.x - a.x;
+        float dy = b.y - a.y;
+        int sx = (dx > 0) - (dx < 0);
+        int sy = (dy > 0) - (dy < 0);
+        if (sx != 0)
+        {
+            if (xSign == 0)
+                xFirst = sx;
+            else if (sx != xSign)
+                ++xChanges;
+            xSign = sx;
+        }
+        if (sy != 0)
+        {
+            if (ySign == 0)
+                yFirst = sy;
+            else if (sy != ySign)
+                ++yChanges;
+            ySign = sy;
+        }
+    }
+    // wrap around from the last edge to the first
+    if (xSign != 0 && xSign != xFirst)
+        ++xChanges;
+    if (ySign != 0 && ySign != yFirst)
+        ++yChanges;
+
+    return turnSign != 0 && xChanges <= 2 && yChanges <= 2;
+}
+
+// Parts keep their vertices in the local space of the polygon and share its transform
+static void syncPartTransforms(Polygon *p)
+{
+    for (int i = 0; i < p->partCount; ++i)
+    {
+        Polygon *part = &p->parts[i];
+        part->transformed = p->transformed;
+        part->position = p->position;
+        part->rotation = p->rotation;
+        part->cosRot = p->cosRot;
+        part->sinRot = p->sinRot;
+        part->dirty |= POLY_DIRTY_BOUNDS;
+    }
+}
+
+void polygon_updateConvex(Polygon *p)
+{
+    clearParts(p);
+    p->convex = isConvex(p);
+    if (!p->convex && p->count > 3)
+        decompose(p);
+    syncPartTransforms(p);
+}
+
+void polygon_bounds(AABB *target, Polygon p)
+{
+    Vector2D v = worldVertex(p, 0);
+    target->minX = target->maxX = v.x;
+    target->minY = target->maxY = v.y;
+    for (int i = 1; i < p.count; ++i)
+    {
+        v = worldVertex(p, i);
+        if (v.x < target->minX)
+            target->minX = v.x;
+        else if (v.x > target->maxX)
+            target->maxX = v.x;
+        if (v.y < target->minY)
+            target->minY = v.y;
+        else if (v.y > target->maxY)
+            target->maxY = v.y;
+    }
+}
+
+// Padding repeats the first vertex, so it never changes a projection
+static void updateSoA(Polygon *p)
+{
+    if (p->count == 0)
+        return;
+    if (p->soa == NULL)
+    {
+        p->soaCount = simd_paddedCount(p->count);
+        p->soa = pd->system->realloc(NULL, sizeof(float) * p->soaCount * 2);
+        STATS_COUNT(STAT_ALLOCS);
+    }
+
+    float *xs = p->soa;
+    float *ys = p->soa + p->soaCount;
+    for (int i = 0; i < p->soaCount; ++i)
+    {
+        Vector2D v = p->verts[i < p->count ? i : 0];
+        xs[i] = v.x;
+        ys[i] = v.y;
+    }
+}
+
+void polygon_updateCache(Polygon *p)
+{
+    if (!p->dirty)
+        return;
+    STATS_COUNT(STAT_CACHE_UPDATES);
+
+    if (p->count > 0)
+    {
+        polygon_bounds(&p->bounds, *p);
+        polygon_middle(&p->centroid, *p);
+    }
+    float maxDist = 0;
+    for (int i = 0; i < p->count; ++i)
+    {
+        Vector2D v = worldVertex(*p, i);
+        float dist = square(v.x - p->centroid.x) + square(v.y - p->centroid.y);
+        if (dist > maxDist)
+            maxDist = dist;
+    }
+    p->radius = sqrtf(maxDist);
+
+    // normals of transformed polygons are in local space, moving or rotating does not change them
+    if (p->normals != NULL && (p->dirty & POLY_DIRTY_SHAPE))
+        polygon_cacheNormals(p);
+    if (p->dirty & POLY_DIRTY_SHAPE)
+        updateSoA(p);
+
+    syncPartTransforms(p);
+    for (int i = 0; i < p->partCount; ++i)
+        polygon_updateCache(&p->parts[i]);
+
+    p->dirty = 0;
+}
+
+void polygon_markDirty(Polygon *p)
+{
+    p->dirty = POLY_DIRTY_ALL;
+}
+
+void polygon_translate(Polygon *p, Vector2D offset)
+{
+    if (p->transformed)
+    {
+        p->position.x += offset.x;
+        p->position.y += offset.y;
+    }
+    else
+    {
+        for (int i = 0; i < p->count; ++i)
+        {
+            p->verts[i].x += offset.x;
+            p->verts[i].y += offset.y;
+        }
+        for (int i = 0; i < p->soaCount; ++i)
+        {
+            p->soa[i] += offset.x;
+            p->soa[p->soaCount + i] += offset.y;
+        }
+    }
+
+    // normals and radius do not change
+    p->bounds.minX += offset.x;
+    p->bounds.maxX += offset.x;
+    p->bounds.minY += offset.y;
+    p->bounds.maxY += offset.y;
+    p->centroid.x += offset.x;
+    p->centroid.y += offset.y;
+
+    // parts of a transformed polygon only follow its position, their vertices are local
+    for (int i = 0; i < p->partCount; ++i)
+    {
+        Polygon *part = &p->parts[i];
+        if (p->transformed)
+        {
+            part->position = p->position;
+            part->bounds.minX += offset.x;
+            part->bounds.maxX += offset.x;
+            part->bounds.minY += offset.y;
+            part->bounds.maxY += offset.y;
+            part->centroid.x += offset.x;
+            part->centroid.y += offset.y;
+        }
+        else
+        {
+            polygon_translate(part, offset);
+        }
+    }
+}
+
+void polygon_setTransform(Polygon *p, Vector2D position, float rotation)
+{
+    p->transformed = 1;
+    p->position = position;
+    polygon_setRotation(p, rotation);
+}
+
+void polygon_setRotation(Polygon *p, float rotation)
+{
+    p->rotation = rotation;
+    p->cosRot = cosf(rotation);
+    p->sinRot = sinf(rotation);
+    p->dirty |= POLY_DIRTY_BOUNDS;
+    syncPartTransforms(p);
+}
+
+void polygon_getVertex(Vector2D *target, Polygon p, int i)
+{
+    *target = worldVertex(p, i);
+}
+
+void polygon_exportVertices(float *dest, Polygon p)
+{
+    for (int i = 0; i < p.count; ++i)
+    {
+        Vector2D v = worldVertex(p, i);
+        dest[i * 2] = v.x;
+        dest[i * 2 + 1] = v.y;
+    }
+}
+
 // --- LUA HOOKS ---
 
 static int lua_polygon_new(lua_State *L)
@@ -29,11 +592,7 @@ static int lua_polygon_new(lua_State *L)
     Polygon *p;
     if (argc == 1)
     {
-        int count = pd->lua->getArgInt(1);
-        p = pd->system->realloc(NULL, sizeof(Polygon));
-        p->count = count;
-        p->verts = pd->system->realloc(NULL, sizeof(Vector2D) * p->count);
-        memset(p->verts, 0, sizeof(Vector2D) * p->count);
+        p = polygon_new(pd->lua->getArgInt(1));
     }
     else
     {
@@ -44,17 +603,15 @@ static int lua_polygon_new(lua_State *L)
             return 0;
         }
 
-        p = pd->system->realloc(NULL, sizeof(Polygon));
-        p->count = argc / 2;
-        p->verts = pd->system->realloc(NULL, sizeof(Vector2D) * p->count);
+        p = polygon_new(argc / 2);
         for (int i = 1; i <= argc; i += 2)
         {
             Vector2D *v = (Vector2D*)p->verts + (i-1)/2;
             v->x = pd->lua->getArgFloat(i);
             v->y = pd->lua->getArgFloat(i+1);
         }
+        polygon_updateConvex(p);
     }
-    p->normals = NULL;
 
 	pd->lua->pushObject(p, POLY_TYPE_NAME, 0);
 	return 1;
@@ -63,9 +620,7 @@ static int lua_polygon_new(lua_State *L)
 static int lua_polygon_free(lua_State *L)
 {
 	Polygon* p = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
-    pd->system->realloc(p->verts, 0);
-    pd->system->realloc(p->normals, 0);
-	pd->system->realloc(p, 0);
+    polygon_free(p);
 	return 0;
 }
 
@@ -83,12 +638,62 @@ static int lua_polygon_index(lua_State *L)
         return 0;
 
     // Need to create a new object for now, since we don't have reference counting implemented in Vector2D
+    // Use poly:getVertex(i) or poly:unpack() instead to avoid the allocation
     Vector2D* v = pd->system->realloc(NULL, sizeof(Vector2D));
-    *v = p->verts[i];
+    STATS_COUNT(STAT_ALLOCS);
+    *v = worldVertex(*p, i);
     pd->lua->pushObject(v, VECTOR_TYPE_NAME, 0);
     return 1;
 }
 
+// poly:getVertex(i) -> x, y of vertex i (1-based), without creating a vector
+static int lua_polygon_getVertex(lua_State *L)
+{
+    Polygon* p = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
+    int i = pd->lua->getArgInt(2) - 1;
+
+    if (i >= p->count || i < 0)
+        return 0;
+
+    Vector2D v = worldVertex(*p, i);
+    pd->lua->pushFloat(v.x);
+    pd->lua->pushFloat(v.y);
+    return 2;
+}
+
+// poly:unpack() -> x1, y1, x2, y2, ... of all vertices, for polygons with up to UNPACK_MAX_VERTS
+// vertices. Can be passed straight to playdate.graphics.drawPolygon or wrapped in {} to get a table.
+static int lua_polygon_unpack(lua_State *L)
+{
+    Polygon* p = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
+
+    if (p->count > UNPACK_MAX_VERTS)
+    {
+        pd->system->error("%s:%i: unpack supports up to %d vertices, use poly:pack() for %d", __FILE__, __LINE__, UNPACK_MAX_VERTS, p->count);
+        return 0;
+    }
+
+    for (int i = 0; i < p->count; ++i)
+    {
+        Vector2D v = worldVertex(*p, i);
+        pd->lua->pushFloat(v.x);
+        pd->lua->pushFloat(v.y);
+    }
+    return p->count * 2;
+}
+
+// poly:pack() -> string of x1, y1, x2, y2, ... of all vertices as native floats, read with
+// string.unpack("ff", s, pos) or string.unpack(string.rep("f", 2 * #poly), s) at once
+static int lua_polygon_pack(lua_State *L)
+{
+    Polygon* p = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
+
+    packBuffer = ensureCapacity(pd->system->realloc, packBuffer, &packCapacity, p->count * 2, sizeof(float));
+    polygon_exportVertices(packBuffer, *p);
+    pd->lua->pushBytes((const char *)packBuffer, sizeof(float) * 2 * p->count);
+    return 1;
+}
+
 static int lua_polygon_len(lua_State *L)
 {
     Polygon* p = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
@@ -143,6 +748,8 @@ static int lua_polygon_set(lua_State *L)
         v->x = pd->lua->getArgFloat(i);
         v->y = pd->lua->getArgFloat(i+1);
     }
+    polygon_updateConvex(p);
+    polygon_markDirty(p);
 
     return 0;
 }
@@ -153,10 +760,8 @@ static int lua_polygon_addScaled(lua_State *L)
     Vector2D* v = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
     float scale = pd->lua->getArgFloat(3);
 
-    for (int i = 0; i < p->count; ++i)
-    {
-        vector2D_addVecScaled(&p->verts[i], *v, scale);
-    }
+    Vector2D offset = { .x = v->x * scale, .y = v->y * scale };
+    polygon_translate(p, offset);
 
     return 0;
 }
@@ -165,20 +770,14 @@ static int lua_polygon_boundingCircle(lua_State *L)
 {
     Polygon* p = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
 
-    Vector2D *middle = pd->system->realloc(NULL, sizeof(Vector2D));
+    polygon_updateCache(p);
 
-    polygon_middle(middle, *p);
-    float minDist = 0;
-    for (int i = 0; i < p->count; ++i)
-    {
-        float dist = square(p->verts[i].x - middle->x) + square(p->verts[i].y - middle->y);
-        if (dist > minDist)
-            minDist = dist;
-    }
-    minDist = sqrtf(minDist);
+    Vector2D *middle = pd->system->realloc(NULL, sizeof(Vector2D));
+    STATS_COUNT(STAT_ALLOCS);
+    *middle = p->centroid;
 
 	pd->lua->pushObject(middle, VECTOR_TYPE_NAME, 0);
-    pd->lua->pushFloat(minDist);
+    pd->lua->pushFloat(p->radius);
     return 2;
 }
 
@@ -186,24 +785,86 @@ static int lua_polygon_cacheNormals(lua_State *L)
 {
     Polygon* p = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
 
-    if (p->normals == NULL)
-        p->normals = pd->system->realloc(NULL, sizeof(Vector2D) * p->count);
+    polygon_cacheNormals(p);
 
-    for (int i = 0; i < p->count; ++i)
+    return 0;
+}
+
+static int lua_polygon_isConvex(lua_State *L)
+{
+    Polygon* p = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
+
+    pd->lua->pushBool(p->convex);
+    return 1;
+}
+
+// Number of convex parts of a concave polygon, 0 for convex or self-intersecting ones
+static int lua_polygon_getPartCount(lua_State *L)
+{
+    Polygon* p = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
+
+    pd->lua->pushInt(p->partCount);
+    return 1;
+}
+
+// poly:setTransform(x, y, [rotation]), rotation in degrees
+// From now on the vertices (given to new/set) are in local space around x, y.
+static int lua_polygon_setTransform(lua_State *L)
+{
+    Polygon* p = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
+    Vector2D position = { .x = pd->lua->getArgFloat(2), .y = pd->lua->getArgFloat(3) };
+    float rotation = pd->lua->getArgFloat(4);
+
+    polygon_setTransform(p, position, rotation * DEG_TO_RAD);
+    return 0;
+}
+
+static int lua_polygon_setPosition(lua_State *L)
+{
+    Polygon* p = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
+    Vector2D offset = { .x = pd->lua->getArgFloat(2) - p->position.x, .y = pd->lua->getArgFloat(3) - p->position.y };
+
+    if (!p->transformed)
     {
-        vector2D_dirNormalized(&p->normals[i], p->verts[(i + 1) % p->count], p->verts[i]);
-        vector2D_leftNormal(&p->normals[i], p->normals[i]);
+        pd->system->error("%s:%i: poly:setPosition() needs a transform, call poly:setTransform() first", __FILE__, __LINE__);
+        return 0;
     }
 
+    polygon_translate(p, offset);
     return 0;
 }
 
+// poly:setRotation(rotation), rotation in degrees
+static int lua_polygon_setRotation(lua_State *L)
+{
+    Polygon* p = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
+
+    if (!p->transformed)
+    {
+        pd->system->error("%s:%i: poly:setRotation() needs a transform, call poly:setTransform() first", __FILE__, __LINE__);
+        return 0;
+    }
+
+    polygon_setRotation(p, pd->lua->getArgFloat(2) * DEG_TO_RAD);
+    return 0;
+}
+
+// poly:getTransform() -> x, y, rotation (degrees)
+static int lua_polygon_getTransform(lua_State *L)
+{
+    Polygon* p = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
+
+    pd->lua->pushFloat(p->position.x);
+    pd->lua->pushFloat(p->position.y);
+    pd->lua->pushFloat(p->rotation / DEG_TO_RAD);
+    return 3;
+}
+
 static int lua_polygon_clearNormals(lua_State *L)
 {
     Polygon* p = pd->lua->getArgObject(1, POLY_TYPE_NAME, NULL);
 
-    pd->system->realloc(p->normals, 0);
-    p->normals = NULL;
+    polygon_clearNormals(p);
 
     return 0;
 }
@@ -217,9 +878,18 @@ static const lua_reg polylib[] =
     { "__tostring",	lua_polygon_print },
 	{ "set",		lua_polygon_set },
     { "addScaled",	lua_polygon_addScaled },
+    { "getVertex",	lua_polygon_getVertex },
+    { "unpack",		lua_polygon_unpack },
+    { "pack",		lua_polygon_pack },
     { "getBoundingCircle", lua_polygon_boundingCircle },
     { "cacheNormals", lua_polygon_cacheNormals },
     { "clearNormals", lua_polygon_clearNormals },
+    { "isConvex",	lua_polygon_isConvex },
+    { "getPartCount", lua_polygon_getPartCount },
+    { "setTransform", lua_polygon_setTransform },
+    { "setPosition", lua_polygon_setPosition },
+    { "setRotation", lua_polygon_setRotation },
+    { "getTransform", lua_polygon_getTransform },
 	{ NULL, NULL }
 };
 
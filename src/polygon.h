@@ -3,18 +3,90 @@
 
 #include "pd_api.h"
 #include "vector2d.h"
+#include "aabb.h"
 
 #define POLY_TYPE_NAME "collision.polygon"
 
-// TODO: Add C API
+// Polygon.dirty flags
+#define POLY_DIRTY_SHAPE 1      // vertices changed, normals need to be recomputed
+#define POLY_DIRTY_BOUNDS 2     // moved or rotated, only the world space data is stale
+#define POLY_DIRTY_ALL (POLY_DIRTY_SHAPE | POLY_DIRTY_BOUNDS)
 
-typedef struct
+typedef struct Polygon
 {
     int count;
     Vector2D *verts;
+    // unique edge normals, see polygon_cacheNormals
     Vector2D *normals;
+    int normalCount;
+    // set by polygon_updateConvex, enables faster projection in the collision functions
+    int convex;
+
+    // Optional transform (see polygon_setTransform). If set, verts and normals are in
+    // local space and a vertex is at position + verts[i] rotated by rotation (radians).
+    int transformed;
+    Vector2D position;
+    float rotation;
+    float cosRot;
+    float sinRot;
+
+    // Derived data in world space, only valid while dirty is 0 (see polygon_updateCache).
+    // centroid is the average of the vertices, radius the bounding circle around it.
+    AABB bounds;
+    Vector2D centroid;
+    float radius;
+    int dirty;
+
+    // Convex parts of a concave polygon (see polygon_updateConvex), NULL for convex ones.
+    // Their vertices and normals are stored contiguously in partVerts / partNormals, they
+    // share the transform of the polygon and have their own cached bounds.
+    struct Polygon *parts;
+    int partCount;
+    Vector2D *partVerts;
+    Vector2D *partNormals;
+    // Storage behind parts / partVerts / partNormals and the index scratch of the decomposition,
+    // kept when the polygon turns convex so that set() only grows them.
+    struct Polygon *partBuffer;
+    int partCapacity;
+    int partVertCapacity;
+    int *scratch;
+    int scratchCapacity;
+
+    // Copy of verts as all x followed by all y, padded to soaCount (see simd.h), for the
+    // vectorised projection. Built by polygon_updateCache, only valid without POLY_DIRTY_SHAPE.
+    float *soa;
+    int soaCount;
 } Polygon;
 
+// Allocates a new polygon with count vertices (all set to 0,0), no cached normals and marked dirty
+Polygon *polygon_new(int count);
+void polygon_free(Polygon *p);
+// Caches the normalized edge normals for the collision functions. Zero-length edges are
+// skipped and parallel or opposite edges share one normal (SAT tests the axis both ways),
+// so normalCount can be less than count (e.g. 2 for a rectangle).
+void polygon_cacheNormals(Polygon *p);
+void polygon_clearNormals(Polygon *p);
+// Checks if the polygon is convex (and not self-intersecting) and stores the result in p->convex.
+// Concave (simple) polygons are split into convex parts, which the collision functions test
+// instead of the whole polygon. Needs to be called again when vertices are changed other than
+// by translation.
+void polygon_updateConvex(Polygon *p);
+void polygon_bounds(AABB *target, Polygon p);
+// Recomputes bounds, bounding circle and cached normals if the polygon is dirty.
+// The collision functions skip the bounds test for dirty polygons, so after changing
+// vertices directly call polygon_markDirty (or polygon_translate for a pure move).
+void polygon_updateCache(Polygon *p);
+void polygon_markDirty(Polygon *p);
+// Moves the polygon by offset, keeping the cached data valid. O(1) for transformed polygons.
+void polygon_translate(Polygon *p, Vector2D offset);
+// Turns the current vertices into local space vertices placed at position, rotated by
+// rotation (radians). Afterwards moving and rotating does not touch the vertices.
+void polygon_setTransform(Polygon *p, Vector2D position, float rotation);
+void polygon_setRotation(Polygon *p, float rotation);
+// World space position of vertex i
+void polygon_getVertex(Vector2D *target, Polygon p, int i);
+// Writes all (world space) vertices as x1,y1,x2,y2,... into dest, which needs room for 2 * p.count floats
+void polygon_exportVertices(float *dest, Polygon p);
 
 void registerPoly(PlaydateAPI *playdate);
 
@@ -0,0 +1,703 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "scenario.h"
+#include "vector2d.h"
+#include "polygon.h"
+#include "collision.h"
+#include "world.h"
+#include "stats.h"
+#include "util.h"
+
+static PlaydateAPI* pd = NULL;
+
+#define SCENARIO_CELL_SIZE 16.0f
+#define SCENARIO_LINE_SIZE 160
+#define SCENARIO_CONFIRM_RUNS 2
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// keep in order of ScenarioKind
+static const char *scenarioNames[SCENARIO_COUNT] =
+{
+    "circleSwarm",
+    "polyHeavy",
+    "staticPolys",
+    "fastMovers",
+    "idle",
+};
+
+static const int suiteBodyCounts[] = { 20, 200, 2000 };
+
+// Velocities are in pixels per frame, every frame is a world_step with dt 1
+typedef struct
+{
+    World *world;
+    // circle centers, the world keeps pointers to them, so there is room for every body up front
+    Vector2D *centers;
+    int circleCount;
+    // owned by the scene, the world only moves them
+    Polygon **polys;
+    int polyCount;
+    float width;
+    float height;
+    uint32_t seed;
+} Scene;
+
+// -- HELPER ---
+
+// Own generator, so the scenes are the same on every platform
+static float randomFloat(Scene *s, float min, float max)
+{
+    s->seed = s->seed * 1664525u + 1013904223u;
+    return min + (float)(s->seed >> 8) * (1.0f / 16777216.0f) * (max - min);
+}
+
+static Vector2D randomVelocity(Scene *s, float minSpeed, float maxSpeed)
+{
+    float angle = randomFloat(s, 0.0f, (float)(2.0 * M_PI));
+    float speed = randomFloat(s, minSpeed, maxSpeed);
+    Vector2D vel = { .x = cosf(angle) * speed, .y = sinf(angle) * speed };
+    return vel;
+}
+
+static Vector2D randomPosition(Scene *s, float margin)
+{
+    Vector2D pos = { .x = randomFloat(s, margin, s->width - margin), .y = randomFloat(s, margin, s->height - margin) };
+    return pos;
+}
+
+// --- SCENE ---
+
+// The world is 5:3 like the screen, with areaPerBody square pixels for every body
+static void scene_init(Scene *s, int bodyCount, float areaPerBody)
+{
+    s->width = sqrtf(bodyCount * areaPerBody * 5.0f / 3.0f);
+    s->height = s->width * 3.0f / 5.0f;
+    s->seed = 1234;
+
+    s->world = world_new(SCENARIO_CELL_SIZE);
+    s->world->hasBounds = 1;
+    s->world->bounds.minX = 0.0f;
+    s->world->bounds.minY = 0.0f;
+    s->world->bounds.maxX = s->width;
+    s->world->bounds.maxY = s->height;
+
+    s->centers = pd->system->realloc(NULL, sizeof(Vector2D) * bodyCount);
+    s->circleCount = 0;
+    s->polys = pd->system->realloc(NULL, sizeof(Polygon *) * bodyCount);
+    s->polyCount = 0;
+}
+
+static void scene_free(Scene *s)
+{
+    world_free(s->world);
+    for (int i = 0; i < s->polyCount; ++i)
+        polygon_free(s->polys[i]);
+    pd->system->realloc(s->polys, 0);
+    pd->system->realloc(s->centers, 0);
+}
+
+// mass 0 for static bodies, all bodies bounce without losing energy
+static void addCircle(Scene *s, Vector2D pos, Vector2D vel, float radius, float mass)
+{
+    Vector2D *center = &s->centers[s->circleCount++];
+    *center = pos;
+    int index = world_addCircle(s->world, center, radius, mass, 1.0f);
+    s->world->bodies[index].velocity = vel;
+}
+
+// poly holds local vertices around 0,0 in CW order
+static void addPoly(Scene *s, Polygon *poly, Vector2D pos, float rotation, Vector2D vel, float mass)
+{
+    polygon_cacheNormals(poly);
+    polygon_updateConvex(poly);
+    polygon_setTransform(poly, pos, rotation);
+
+    s->polys[s->polyCount++] = poly;
+    int index = world_addPoly(s->world, poly, mass, 1.0f);
+    s->world->bodies[index].velocity = vel;
+}
+
+static Polygon *regularPoly(int count, float radius)
+{
+    Polygon *p = polygon_new(count);
+    for (int i = 0; i < count; ++i)
+    {
+        float angle = (float)(2.0 * M_PI * i / count);
+        p->verts[i].x = cosf(angle) * radius;
+        p->verts[i].y = sinf(angle) * radius;
+    }
+    return p;
+}
+
+static Polygon *starPoly(int points, float outer, float inner)
+{
+    Polygon *p = polygon_new(points * 2);
+    for (int i = 0; i < points * 2; ++i)
+    {
+        float angle = (float)(M_PI * i / points);
+        float radius = i % 2 == 0 ? outer : inner;
+        p->verts[i].x = cosf(angle) * radius;
+        p->verts[i].y = sinf(angle) * radius;
+    }
+    return p;
+}
+
+static Polygon *boxPoly(float width, float height)
+{
+    Polygon *p = polygon_new(4);
+    p->verts[0].x = -width / 2;
+    p->verts[0].y = -height / 2;
+    p->verts[1].x = width / 2;
+    p->verts[1].y = -height / 2;
+    p->verts[2].x = width / 2;
+    p->verts[2].y = height / 2;
+    p->verts[3].x = -width / 2;
+    p->verts[3].y = height / 2;
+    return p;
+}
+
+// --- SCENARIOS ---
+
+static void build_circleSwarm(Scene *s, int bodyCount)
+{
+    scene_init(s, bodyCount, 250.0f);
+    for (int i = 0; i < bodyCount; ++i)
+    {
+        float radius = randomFloat(s, 4.0f, 6.0f);
+        addCircle(s, randomPosition(s, radius), randomVelocity(s, 0.5f, 3.0f), radius, 1.0f);
+    }
+}
+
+static void build_polyHeavy(Scene *s, int bodyCount)
+{
+    scene_init(s, bodyCount, 700.0f);
+    for (int i = 0; i < bodyCount; ++i)
+    {
+        float radius = randomFloat(s, 6.0f, 10.0f);
+        Vector2D pos = randomPosition(s, radius);
+        Vector2D vel = randomVelocity(s, 0.5f, 2.5f);
+        if (i % 4 == 3)
+        {
+            addCircle(s, pos, vel, radius, 1.0f);
+            continue;
+        }
+        int verts = 3 + (int)randomFloat(s, 0.0f, 5.99f);
+        addPoly(s, regularPoly(verts, radius), pos, randomFloat(s, 0.0f, (float)M_PI), vel, 1.0f);
+    }
+}
+
+// One large static polygon per 50 bodies, on a grid with room between them
+static void build_staticPolys(Scene *s, int bodyCount)
+{
+    scene_init(s, bodyCount, 400.0f);
+    int polyCount = bodyCount / 50 > 1 ? bodyCount / 50 : 1;
+    int columns = (int)ceilf(sqrtf(polyCount * 5.0f / 3.0f));
+    int rows = (polyCount + columns - 1) / columns;
+    float cellWidth = s->width / columns;
+    float cellHeight = s->height / rows;
+    float radius = fminf(fminf(cellWidth, cellHeight) * 0.35f, 60.0f);
+
+    for (int i = 0; i < polyCount; ++i)
+    {
+        Vector2D pos = { .x = (i % columns + 0.5f) * cellWidth, .y = (i / columns + 0.5f) * cellHeight };
+        Polygon *poly = i % 2 == 0 ? regularPoly(12, radius) : starPoly(5, radius, radius * 0.5f);
+        Vector2D still = { .x = 0.0f, .y = 0.0f };
+        addPoly(s, poly, pos, randomFloat(s, 0.0f, (float)M_PI), still, 0.0f);
+    }
+
+    for (int i = polyCount; i < bodyCount; ++i)
+    {
+        float radius = randomFloat(s, 3.0f, 5.0f);
+        addCircle(s, randomPosition(s, radius), randomVelocity(s, 0.5f, 3.0f), radius, 1.0f);
+    }
+}
+
+// Walls are 4 pixels thin and the circles move up to 6 times their radius per frame
+static void build_fastMovers(Scene *s, int bodyCount)
+{
+    scene_init(s, bodyCount, 800.0f);
+    int wallCount = bodyCount / 10 > 2 ? bodyCount / 10 : 2;
+    for (int i = 0; i < wallCount; ++i)
+    {
+        Vector2D still = { .x = 0.0f, .y = 0.0f };
+        addPoly(s, boxPoly(4.0f, 48.0f), randomPosition(s, 24.0f), randomFloat(s, 0.0f, (float)M_PI), still, 0.0f);
+    }
+
+    for (int i = wallCount; i < bodyCount; ++i)
+        addCircle(s, randomPosition(s, 3.0f), randomVelocity(s, 8.0f, 18.0f), 3.0f, 1.0f);
+}
+
+// Bodies rest on a grid without touching, every tenth one is a moving circle
+static void build_idle(Scene *s, int bodyCount)
+{
+    scene_init(s, bodyCount, 600.0f);
+    int columns = (int)ceilf(sqrtf(bodyCount * 5.0f / 3.0f));
+    int rows = (bodyCount + columns - 1) / columns;
+    float cellWidth = s->width / columns;
+    float cellHeight = s->height / rows;
+    float radius = fminf(cellWidth, cellHeight) * 0.3f;
+
+    for (int i = 0; i < bodyCount; ++i)
+    {
+        Vector2D pos = { .x = (i % columns + 0.5f) * cellWidth, .y = (i / columns + 0.5f) * cellHeight };
+        Vector2D still = { .x = 0.0f, .y = 0.0f };
+        if (i % 10 == 9)
+            addCircle(s, pos, randomVelocity(s, 0.5f, 2.0f), radius * 0.5f, 1.0f);
+        else if (i % 2 == 0)
+            addCircle(s, pos, still, radius, 1.0f);
+        else
+            addPoly(s, regularPoly(4 + i % 3, radius), pos, 0.0f, still, 1.0f);
+    }
+}
+
+static void scene_build(Scene *s, ScenarioKind kind, int bodyCount)
+{
+    switch (kind)
+    {
+        case SCENARIO_CIRCLE_SWARM:
+            build_circleSwarm(s, bodyCount);
+            break;
+        case SCENARIO_POLY_HEAVY:
+            build_polyHeavy(s, bodyCount);
+            break;
+        case SCENARIO_STATIC_POLYS:
+            build_staticPolys(s, bodyCount);
+            break;
+        case SCENARIO_FAST_MOVERS:
+            build_fastMovers(s, bodyCount);
+            break;
+        case SCENARIO_IDLE:
+        case SCENARIO_COUNT:
+            build_idle(s, bodyCount);
+            break;
+    }
+}
+
+// --- RUNNING ---
+
+const char *scenario_name(ScenarioKind kind)
+{
+    return (int)kind >= 0 && kind < SCENARIO_COUNT ? scenarioNames[kind] : "unknown";
+}
+
+static uint32_t nsPerFrame(uint64_t ticks, int frames)
+{
+    return (uint32_t)((double)ticks * 1e9 / stats_ticksPerSecond() / frames + 0.5);
+}
+
+static void sortValues(uint32_t *values, int count)
+{
+    for (int i = 1; i < count; ++i)
+    {
+        uint32_t value = values[i];
+        int k = i;
+        for (; k > 0 && values[k - 1] > value; --k)
+            values[k] = values[k - 1];
+        values[k] = value;
+    }
+}
+
+// Median and median absolute deviation of the round times, reorders values
+static void medianAndMad(uint32_t *median, uint32_t *mad, uint32_t *values, int count)
+{
+    sortValues(values, count);
+    *median = values[count / 2];
+    for (int i = 0; i < count; ++i)
+        values[i] = values[i] > *median ? values[i] - *median : *median - values[i];
+    sortValues(values, count);
+    *mad = values[count / 2];
+}
+
+// Builds the scene of result and times one round of world_step frames. times holds the frame,
+// broadphase and narrowphase times of all rounds one after the other.
+static void runRound(ScenarioResult *result, uint32_t *times, int rounds, int round)
+{
+    Scene scene;
+    scene_build(&scene, result->kind, result->bodyCount);
+
+    uint64_t frameTicks = 0;
+    uint64_t broadphaseTicks = 0;
+    uint64_t narrowphaseTicks = 0;
+    long pairs = 0;
+    long contacts = 0;
+
+    for (int f = 0; f < result->frames; ++f)
+    {
+        // world_step, phase by phase
+        uint32_t start = stats_ticks();
+        world_integrate(scene.world, 1.0f);
+        uint32_t moved = stats_ticks();
+        int pairCount = world_findPairs(scene.world);
+        uint32_t paired = stats_ticks();
+        contacts += world_collide(scene.world, pairCount);
+        uint32_t end = stats_ticks();
+
+        pairs += pairCount;
+        frameTicks += end - start;
+        broadphaseTicks += paired - moved;
+        narrowphaseTicks += end - paired;
+    }
+    scene_free(&scene);
+
+    times[round] = nsPerFrame(frameTicks, result->frames);
+    times[rounds + round] = nsPerFrame(broadphaseTicks, result->frames);
+    times[rounds * 2 + round] = nsPerFrame(narrowphaseTicks, result->frames);
+
+    // every round runs the same scene
+    result->pairs = (int)(pairs / result->frames);
+    result->contacts = (int)(contacts / result->frames);
+}
+
+static void finishRounds(ScenarioResult *result, uint32_t *times, int rounds)
+{
+    medianAndMad(&result->frameNs, &result->frameMadNs, times, rounds);
+    medianAndMad(&result->broadphaseNs, &result->broadphaseMadNs, times + rounds, rounds);
+    medianAndMad(&result->narrowphaseNs, &result->narrowphaseMadNs, times + rounds * 2, rounds);
+}
+
+static void initResult(ScenarioResult *result, ScenarioKind kind, int bodyCount, int frames)
+{
+    memset(result, 0, sizeof(ScenarioResult));
+    result->kind = kind;
+    result->bodyCount = bodyCount;
+    result->frames = frames;
+}
+
+void scenario_run(ScenarioResult *result, ScenarioKind kind, int bodyCount, int frames, int rounds)
+{
+    initResult(result, kind, bodyCount, frames);
+
+    uint32_t *times = pd->system->realloc(NULL, sizeof(uint32_t) * 3 * rounds);
+    for (int round = 0; round < rounds; ++round)
+        runRound(result, times, rounds, round);
+    finishRounds(result, times, rounds);
+    pd->system->realloc(times, 0);
+}
+
+int scenario_formatCSV(char *buffer, int size, const ScenarioResult *result)
+{
+    int length = snprintf(buffer, size, "%s,%d,%d,%lu,%lu,%lu,%d,%d,%lu,%lu,%lu", scenario_name(result->kind), result->bodyCount, result->frames,
+                          (unsigned long)result->frameNs, (unsigned long)result->broadphaseNs, (unsigned long)result->narrowphaseNs,
+                          result->pairs, result->contacts,
+                          (unsigned long)result->frameMadNs, (unsigned long)result->broadphaseMadNs, (unsigned long)result->narrowphaseMadNs);
+    return length < size ? length : -1;
+}
+
+// --- BASELINE ---
+
+static char *readFile(const char *path)
+{
+    SDFile *file = pd->file->open(path, kFileRead | kFileReadData);
+    if (file == NULL)
+        return NULL;
+
+    char *text = NULL;
+    int length = 0;
+    int capacity = 0;
+    for (;;)
+    {
+        text = ensureCapacity(pd->system->realloc, text, &capacity, length + 1024 + 1, 1);
+        int count = pd->file->read(file, &text[length], 1024);
+        if (count <= 0)
+            break;
+        length += count;
+    }
+    pd->file->close(file);
+
+    text[length] = '\0';
+    return text;
+}
+
+static int parseLine(ScenarioResult *result, const char *line)
+{
+    const char *comma = strchr(line, ',');
+    if (comma == NULL)
+        return 0;
+
+    int kind = 0;
+    while (kind < SCENARIO_COUNT && (strlen(scenarioNames[kind]) != (size_t)(comma - line) || strncmp(scenarioNames[kind], line, comma - line) != 0))
+        ++kind;
+    if (kind == SCENARIO_COUNT)
+        return 0;
+
+    // baselines written before the deviations were added end after contacts
+    long values[10] = { 0 };
+    const char *pos = comma + 1;
+    for (int i = 0; i < 10; ++i)
+    {
+        char *end;
+        values[i] = strtol(pos, &end, 10);
+        if (end == pos)
+            return 0;
+        if (*end != ',')
+        {
+            if (i != 6 && i != 9)
+                return 0;
+            break;
+        }
+        pos = end + 1;
+    }
+
+    result->kind = kind;
+    result->bodyCount = (int)values[0];
+    result->frames = (int)values[1];
+    result->frameNs = (uint32_t)values[2];
+    result->broadphaseNs = (uint32_t)values[3];
+    result->narrowphaseNs = (uint32_t)values[4];
+    result->pairs = (int)values[5];
+    result->contacts = (int)values[6];
+    result->frameMadNs = (uint32_t)values[7];
+    result->broadphaseMadNs = (uint32_t)values[8];
+    result->narrowphaseMadNs = (uint32_t)values[9];
+    return 1;
+}
+
+int scenario_loadBaseline(const char *path, ScenarioResult **results)
+{
+    char *text = readFile(path);
+    if (text == NULL)
+        return -1;
+
+    int count = 0;
+    int capacity = 0;
+    *results = NULL;
+
+    // the header and unknown scenarios are skipped
+    for (char *line = text; *line != '\0'; )
+    {
+        char *next = strchr(line, '\n');
+        if (next != NULL)
+            *next = '\0';
+
+        ScenarioResult result;
+        if (parseLine(&result, line))
+        {
+            *results = ensureCapacity(pd->system->realloc, *results, &capacity, count + 1, sizeof(ScenarioResult));
+            (*results)[count++] = result;
+        }
+
+        if (next == NULL)
+            break;
+        line = next + 1;
+    }
+
+    pd->system->realloc(text, 0);
+    return count;
+}
+
+const ScenarioResult *scenario_findBaseline(const ScenarioResult *baseline, int count, ScenarioKind kind, int bodyCount)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        if (baseline[i].kind == kind && baseline[i].bodyCount == bodyCount)
+            return &baseline[i];
+    }
+    return NULL;
+}
+
+static int slower(uint32_t value, uint32_t valueMad, uint32_t base, uint32_t baseMad, float thresholdPercent)
+{
+    if (base < SCENARIO_MIN_COMPARE_NS)
+        return 0;
+    return value > base * (1.0f + thresholdPercent / 100.0f) && value - base > SCENARIO_NOISE_MADS * (valueMad + baseMad);
+}
+
+int scenario_compare(const ScenarioResult *result, const ScenarioResult *baseline, float thresholdPercent)
+{
+    int mask = 0;
+    if (slower(result->frameNs, result->frameMadNs, baseline->frameNs, baseline->frameMadNs, thresholdPercent))
+        mask |= SCENARIO_SLOWER_FRAME;
+    if (slower(result->broadphaseNs, result->broadphaseMadNs, baseline->broadphaseNs, baseline->broadphaseMadNs, thresholdPercent))
+        mask |= SCENARIO_SLOWER_BROADPHASE;
+    if (slower(result->narrowphaseNs, result->narrowphaseMadNs, baseline->narrowphaseNs, baseline->narrowphaseMadNs, thresholdPercent))
+        mask |= SCENARIO_SLOWER_NARROWPHASE;
+    return mask;
+}
+
+// --- SUITE ---
+
+static void logRegression(const ScenarioResult *result, const char *phase, uint32_t value, uint32_t base)
+{
+    int percent = base > 0 ? (int)(((double)value - base) * 100.0 / base) : 0;
+    pd->system->logToConsole("REGRESSION %s %d bodies %s: %lu ns -> %lu ns per frame (+%d%%)", scenario_name(result->kind), result->bodyCount,
+                             phase, (unsigned long)base, (unsigned long)value, percent);
+}
+
+int scenario_runSuite(const char *baselinePath, float thresholdPercent, const char *outputPath, int frames)
+{
+    ScenarioResult *baseline = NULL;
+    int baselineCount = 0;
+    if (baselinePath != NULL)
+    {
+        baselineCount = scenario_loadBaseline(baselinePath, &baseline);
+        if (baselineCount < 0)
+        {
+            pd->system->logToConsole("%s:%i: cannot read baseline %s, %s", __FILE__, __LINE__, baselinePath, pd->file->geterr());
+            return -1;
+        }
+    }
+
+    SDFile *output = NULL;
+    if (outputPath != NULL)
+    {
+        output = pd->file->open(outputPath, kFileWrite);
+        if (output == NULL)
+            pd->system->logToConsole("%s:%i: cannot open %s, %s", __FILE__, __LINE__, outputPath, pd->file->geterr());
+    }
+
+    char line[SCENARIO_LINE_SIZE];
+    pd->system->logToConsole("%s", SCENARIO_CSV_HEADER);
+    if (output != NULL)
+        pd->file->write(output, SCENARIO_CSV_HEADER "\n", (unsigned int)strlen(SCENARIO_CSV_HEADER "\n"));
+
+    // The rounds of all runs are interleaved, so slow phases of the machine (other processes,
+    // clock changes) spread over every run and show up in its deviation instead of shifting
+    // the median of a single run
+    const int bodyCountsLen = sizeof(suiteBodyCounts) / sizeof(suiteBodyCounts[0]);
+    const int runCount = bodyCountsLen * SCENARIO_COUNT;
+    const int rounds = SCENARIO_DEFAULT_ROUNDS;
+    ScenarioResult *results = pd->system->realloc(NULL, sizeof(ScenarioResult) * runCount);
+    uint32_t *times = pd->system->realloc(NULL, sizeof(uint32_t) * 3 * rounds * runCount);
+    for (int run = 0; run < runCount; ++run)
+        initResult(&results[run], run % SCENARIO_COUNT, suiteBodyCounts[run / SCENARIO_COUNT], frames);
+    for (int round = 0; round < rounds; ++round)
+    {
+        for (int run = 0; run < runCount; ++run)
+            runRound(&results[run], &times[3 * rounds * run], rounds, round);
+    }
+
+    int regressions = 0;
+    for (int run = 0; run < runCount; ++run)
+    {
+        ScenarioResult *result = &results[run];
+        finishRounds(result, &times[3 * rounds * run], rounds);
+
+        int length = scenario_formatCSV(line, SCENARIO_LINE_SIZE - 1, result);
+        pd->system->logToConsole("%s", line);
+        if (output != NULL)
+        {
+            line[length] = '\n';
+            pd->file->write(output, line, length + 1);
+        }
+
+        const ScenarioResult *base = scenario_findBaseline(baseline, baselineCount, result->kind, result->bodyCount);
+        if (base == NULL)
+            continue;
+
+        // a regression has to show up again in separate runs, a burst of load on the machine does not
+        int mask = scenario_compare(result, base, thresholdPercent);
+        for (int retry = 0; retry < SCENARIO_CONFIRM_RUNS && mask != 0; ++retry)
+        {
+            scenario_run(result, result->kind, result->bodyCount, frames, rounds);
+            mask &= scenario_compare(result, base, thresholdPercent);
+        }
+        if (mask & SCENARIO_SLOWER_FRAME)
+            logRegression(result, "frame", result->frameNs, base->frameNs);
+        if (mask & SCENARIO_SLOWER_BROADPHASE)
+            logRegression(result, "broadphase", result->broadphaseNs, base->broadphaseNs);
+        if (mask & SCENARIO_SLOWER_NARROWPHASE)
+            logRegression(result, "narrowphase", result->narrowphaseNs, base->narrowphaseNs);
+        if (mask != 0)
+            ++regressions;
+
+        // not a failure, but the timings are not comparable
+        if (base->frames != result->frames || base->pairs != result->pairs)
+            pd->system->logToConsole("NOTE %s %d bodies: scene differs from the baseline (frames %d / %d, pairs %d / %d)", scenario_name(result->kind),
+                                     result->bodyCount, result->frames, base->frames, result->pairs, base->pairs);
+    }
+    pd->system->realloc(times, 0);
+    pd->system->realloc(results, 0);
+
+    if (output != NULL)
+        pd->file->close(output);
+    pd->system->realloc(baseline, 0);
+    return regressions;
+}
+
+// --- LUA HOOKS ---
+
+static int lua_scenario_getCount(lua_State *L)
+{
+    pd->lua->pushInt(SCENARIO_COUNT);
+    return 1;
+}
+
+// collision.scenario.getName(i) -> name of scenario i (1-based)
+static int lua_scenario_getName(lua_State *L)
+{
+    int kind = pd->lua->getArgInt(1) - 1;
+    if (kind < 0 || kind >= SCENARIO_COUNT)
+    {
+        pd->system->error("%s:%i: scenario %d out of range", __FILE__, __LINE__, kind + 1);
+        return 0;
+    }
+    pd->lua->pushString(scenarioNames[kind]);
+    return 1;
+}
+
+// collision.scenario.run(i, bodies, [frames], [rounds])
+// -> frame, broadphase and narrowphase microseconds per frame, pairs and contacts per frame
+static int lua_scenario_run(lua_State *L)
+{
+    int kind = pd->lua->getArgInt(1) - 1;
+    int bodies = pd->lua->getArgInt(2);
+    int frames = pd->lua->argIsNil(3) ? SCENARIO_DEFAULT_FRAMES : pd->lua->getArgInt(3);
+    int rounds = pd->lua->argIsNil(4) ? SCENARIO_DEFAULT_ROUNDS : pd->lua->getArgInt(4);
+    if (kind < 0 || kind >= SCENARIO_COUNT || bodies < 1 || frames < 1 || rounds < 1)
+    {
+        pd->system->error("%s:%i: invalid scenario arguments", __FILE__, __LINE__);
+        return 0;
+    }
+
+    ScenarioResult result;
+    scenario_run(&result, kind, bodies, frames, rounds);
+    pd->lua->pushFloat(result.frameNs * 1e-3f);
+    pd->lua->pushFloat(result.broadphaseNs * 1e-3f);
+    pd->lua->pushFloat(result.narrowphaseNs * 1e-3f);
+    pd->lua->pushInt(result.pairs);
+    pd->lua->pushInt(result.contacts);
+    return 5;
+}
+
+// collision.scenario.runSuite([baselinePath], [thresholdPercent], [outputPath], [frames])
+// -> number of regressions, -1 if the baseline could not be read
+static int lua_scenario_runSuite(lua_State *L)
+{
+    const char *baselinePath = pd->lua->argIsNil(1) ? NULL : pd->lua->getArgString(1);
+    float threshold = pd->lua->argIsNil(2) ? SCENARIO_DEFAULT_THRESHOLD : pd->lua->getArgFloat(2);
+    const char *outputPath = pd->lua->argIsNil(3) ? NULL : pd->lua->getArgString(3);
+    int frames = pd->lua->argIsNil(4) ? SCENARIO_DEFAULT_FRAMES : pd->lua->getArgInt(4);
+    if (frames < 1)
+    {
+        pd->system->error("%s:%i: frames must be > 0", __FILE__, __LINE__);
+        return 0;
+    }
+
+    pd->lua->pushInt(scenario_runSuite(baselinePath, threshold, outputPath, frames));
+    return 1;
+}
+
+static const lua_reg scenariolib[] =
+{
+    { "getCount",       lua_scenario_getCount },
+    { "getName",        lua_scenario_getName },
+    { "run",            lua_scenario_run },
+    { "runSuite",       lua_scenario_runSuite },
+    { NULL, NULL }
+};
+
+void registerScenario(PlaydateAPI* playdate)
+{
+    pd = playdate;
+
+    const char* err;
+
+    if (!pd->lua->registerClass(SCENARIO_TYPE_NAME, scenariolib, NULL, 0, &err))
+        pd->system->error("%s:%i: registerClass failed, %s", __FILE__, __LINE__, err);
+}
@@ -0,0 +1,89 @@
+#ifndef _SCENARIO_H
+#define _SCENARIO_H
+
+#include "pd_api.h"
+
+#define SCENARIO_TYPE_NAME "collision.scenario"
+
+// Scenario benchmark suite shared by the host (host/scenarios.c) and the simulator
+// (collision.scenario). Every scenario builds a deterministic World (see world.h) of circles
+// and polygons for a given body count and runs a fixed number of world_step frames, timing
+// its phases: world_integrate, world_findPairs (broadphase) and world_collide (narrowphase
+// and resolution). World size grows with the body count, so density stays the same.
+//
+// Results are CSV lines, see SCENARIO_CSV_HEADER. Times are the median over all rounds in
+// nanoseconds per frame plus their median absolute deviation (mad) as a measure of noise,
+// pairs and contacts the average per frame. A results file can be used as baseline of a
+// later run, which then reports every phase that got slower by more than a threshold (in
+// percent) and by more than the noise of both runs.
+
+typedef enum
+{
+    SCENARIO_CIRCLE_SWARM,      // dense moving circles
+    SCENARIO_POLY_HEAVY,        // mostly small moving polygons, some circles
+    SCENARIO_STATIC_POLYS,      // circles between large static polygons, half of them concave
+    SCENARIO_FAST_MOVERS,       // small fast circles against thin static walls, swept tests
+    SCENARIO_IDLE,              // mostly resting bodies, a few moving circles
+    SCENARIO_COUNT
+} ScenarioKind;
+
+// Bits returned by scenario_compare
+#define SCENARIO_SLOWER_FRAME 1
+#define SCENARIO_SLOWER_BROADPHASE 2
+#define SCENARIO_SLOWER_NARROWPHASE 4
+
+#define SCENARIO_CSV_HEADER "scenario,bodies,frames,frame_ns,broadphase_ns,narrowphase_ns,pairs,contacts,frame_mad_ns,broadphase_mad_ns,narrowphase_mad_ns"
+
+#define SCENARIO_DEFAULT_FRAMES 100
+#define SCENARIO_DEFAULT_THRESHOLD 10.0f
+#define SCENARIO_DEFAULT_ROUNDS 15
+#define SCENARIO_NOISE_MADS 3.0f
+#define SCENARIO_MIN_COMPARE_NS 20000
+
+typedef struct
+{
+    ScenarioKind kind;
+    int bodyCount;
+    int frames;
+    // median of the rounds, nanoseconds per frame
+    uint32_t frameNs;
+    uint32_t broadphaseNs;
+    uint32_t narrowphaseNs;
+    // average per frame
+    int pairs;
+    int contacts;
+    // median absolute deviation of the round times from the median, 0 in old baselines
+    uint32_t frameMadNs;
+    uint32_t broadphaseMadNs;
+    uint32_t narrowphaseMadNs;
+} ScenarioResult;
+
+const char *scenario_name(ScenarioKind kind);
+
+// Runs the scenario rounds times from the same start and keeps the median time of each phase.
+// Timed with stats_ticks, getElapsedTime is too coarse for the small scenes.
+void scenario_run(ScenarioResult *result, ScenarioKind kind, int bodyCount, int frames, int rounds);
+
+// Writes one CSV line (without newline), returns its length or -1 if size is too small
+int scenario_formatCSV(char *buffer, int size, const ScenarioResult *result);
+// Reads a results file written by scenario_runSuite. Returns the number of results stored
+// in *results (free with pd->system->realloc) or -1 if the file could not be read.
+int scenario_loadBaseline(const char *path, ScenarioResult **results);
+// Baseline entry with the same scenario and body count, NULL if there is none
+const ScenarioResult *scenario_findBaseline(const ScenarioResult *baseline, int count, ScenarioKind kind, int bodyCount);
+// SCENARIO_SLOWER_* bits of the phases slower than baseline by more than thresholdPercent and
+// by more than SCENARIO_NOISE_MADS times the summed deviations of both. Phases that take less
+// than SCENARIO_MIN_COMPARE_NS per frame in the baseline are not compared, scheduler and
+// cache noise outweighs them.
+int scenario_compare(const ScenarioResult *result, const ScenarioResult *baseline, float thresholdPercent);
+
+// Runs every scenario with 20, 200 and 2000 bodies, the rounds of all runs interleaved, and
+// logs a CSV line per run, plus a line per regression if baselinePath is set. A run slower
+// than the baseline is repeated and only counts if it is slower every time. outputPath
+// (optional) receives the results, to be used as the baseline of later runs. Returns the
+// number of runs with a regression, or -1 if the baseline could not be read.
+int scenario_runSuite(const char *baselinePath, float thresholdPercent, const char *outputPath, int frames);
+
+void registerScenario(PlaydateAPI *playdate);
+
+#endif // _SCENARIO_H
@@ -0,0 +1,147 @@
+#ifndef _SIMD_H
+#define _SIMD_H
+
+#include <float.h>
+
+// Vector kernels for the innermost loops, selected at compile time: AVX2 (8 lanes) or SSE2
+// (4 lanes) on the host, an unrolled scalar loop everywhere else. The Cortex-M7 of the device
+// has no float SIMD (its DSP instructions work on 8 and 16 bit integers), so there the
+// unrolled loop keeps four independent min/max chains going for the FPU. COLLISION_SIMD=0
+// forces the scalar loop, e.g. to compare results.
+#ifndef COLLISION_SIMD
+#define COLLISION_SIMD 1
+#endif
+
+#if COLLISION_SIMD && defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_WIDTH 8
+#elif COLLISION_SIMD && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define SIMD_WIDTH 4
+#else
+#define SIMD_WIDTH 1
+#endif
+
+// SoA vertex copies (Polygon.soa) are padded to a multiple of this with copies of the first
+// vertex, which does not change the min and max of a projection
+#define SIMD_PAD 8
+
+static inline int simd_paddedCount(int count)
+{
+    return (count + SIMD_PAD - 1) / SIMD_PAD * SIMD_PAD;
+}
+
+// Min and max of xs[i] * ax + ys[i] * ay, count has to be a multiple of SIMD_PAD
+static inline void simd_projectMinMax(float *outMin, float *outMax, const float *xs, const float *ys, int count, float ax, float ay)
+{
+#if SIMD_WIDTH == 8
+    __m256 axisX = _mm256_set1_ps(ax);
+    __m256 axisY = _mm256_set1_ps(ay);
+    __m256 min = _mm256_set1_ps(FLT_MAX);
+    __m256 max = _mm256_set1_ps(-FLT_MAX);
+    for (int i = 0; i < count; i += 8)
+    {
+        __m256 d = _mm256_add_ps(_mm256_mul_ps(axisX, _mm256_loadu_ps(&xs[i])), _mm256_mul_ps(axisY, _mm256_loadu_ps(&ys[i])));
+        min = _mm256_min_ps(min, d);
+        max = _mm256_max_ps(max, d);
+    }
+    __m128 min4 = _mm_min_ps(_mm256_castps256_ps128(min), _mm256_extractf128_ps(min, 1));
+    __m128 max4 = _mm_max_ps(_mm256_castps256_ps128(max), _mm256_extractf128_ps(max, 1));
+#elif SIMD_WIDTH == 4
+    __m128 axisX = _mm_set1_ps(ax);
+    __m128 axisY = _mm_set1_ps(ay);
+    __m128 min4 = _mm_set1_ps(FLT_MAX);
+    __m128 max4 = _mm_set1_ps(-FLT_MAX);
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128 d = _mm_add_ps(_mm_mul_ps(axisX, _mm_loadu_ps(&xs[i])), _mm_mul_ps(axisY, _mm_loadu_ps(&ys[i])));
+        min4 = _mm_min_ps(min4, d);
+        max4 = _mm_max_ps(max4, d);
+    }
+#endif
+
+#if SIMD_WIDTH > 1
+    min4 = _mm_min_ps(min4, _mm_shuffle_ps(min4, min4, _MM_SHUFFLE(1, 0, 3, 2)));
+    min4 = _mm_min_ps(min4, _mm_shuffle_ps(min4, min4, _MM_SHUFFLE(2, 3, 0, 1)));
+    max4 = _mm_max_ps(max4, _mm_shuffle_ps(max4, max4, _MM_SHUFFLE(1, 0, 3, 2)));
+    max4 = _mm_max_ps(max4, _mm_shuffle_ps(max4, max4, _MM_SHUFFLE(2, 3, 0, 1)));
+    *outMin = _mm_cvtss_f32(min4);
+    *outMax = _mm_cvtss_f32(max4);
+#else
+    float min[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+    float max[4] = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (int i = 0; i < count; i += 4)
+    {
+        for (int k = 0; k < 4; ++k)
+        {
+            float d = ax * xs[i + k] + ay * ys[i + k];
+            min[k] = d < min[k] ? d : min[k];
+            max[k] = d > max[k] ? d : max[k];
+        }
+    }
+    min[0] = min[0] < min[1] ? min[0] : min[1];
+    min[2] = min[2] < min[3] ? min[2] : min[3];
+    max[0] = max[0] > max[1] ? max[0] : max[1];
+    max[2] = max[2] > max[3] ? max[2] : max[3];
+    *outMin = min[0] < min[2] ? min[0] : min[2];
+    *outMax = max[0] > max[2] ? max[0] : max[2];
+#endif
+}
+
+// One circle against many: writes the indices of the circles xs/ys/rs that are not rejected
+// by the squared distance test of collision_circleCircle (distance² >= radius sum² is apart),
+// returns how many
+static inline int simd_circleCandidates(int *indices, float x, float y, float r, const float *xs, const float *ys, const float *rs, int count)
+{
+    int found = 0;
+    int i = 0;
+
+#if SIMD_WIDTH == 8
+    __m256 cx = _mm256_set1_ps(x);
+    __m256 cy = _mm256_set1_ps(y);
+    __m256 cr = _mm256_set1_ps(r);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&xs[i]), cx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&ys[i]), cy);
+        __m256 sum = _mm256_add_ps(_mm256_loadu_ps(&rs[i]), cr);
+        __m256 dist = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        // not greater or equal, so NaN is passed on like in the scalar test
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(dist, _mm256_mul_ps(sum, sum), _CMP_NGE_UQ));
+        while (mask != 0)
+        {
+            indices[found++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+#elif SIMD_WIDTH == 4
+    __m128 cx = _mm_set1_ps(x);
+    __m128 cy = _mm_set1_ps(y);
+    __m128 cr = _mm_set1_ps(r);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(&xs[i]), cx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(&ys[i]), cy);
+        __m128 sum = _mm_add_ps(_mm_loadu_ps(&rs[i]), cr);
+        __m128 dist = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        int mask = _mm_movemask_ps(_mm_cmpnge_ps(dist, _mm_mul_ps(sum, sum)));
+        for (int k = 0; mask != 0; ++k, mask >>= 1)
+        {
+            if (mask & 1)
+                indices[found++] = i + k;
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        float dx = xs[i] - x;
+        float dy = ys[i] - y;
+        float sum = rs[i] + r;
+        if (!(dx * dx + dy * dy >= sum * sum))
+            indices[found++] = i;
+    }
+    return found;
+}
+
+#endif // _SIMD_H
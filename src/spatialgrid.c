@@ -0,0 +1,547 @@
+#include "spatialgrid.h"
+#include "polygon.h"
+#include "stats.h"
+#include "util.h"
+
+static PlaydateAPI* pd = NULL;
+
+#define MIN_BUCKETS 16
+
+// -- HELPER ---
+
+static inline int cellCoord(float v, float invCellSize)
+{
+    return (int)floorf(v * invCellSize);
+}
+
+static inline unsigned int cellHash(int x, int y, unsigned int mask)
+{
+    return ((unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u) & mask;
+}
+
+static void pushPair(SpatialGrid *grid, int a, int b)
+{
+    grid->pairs = ensureCapacity(pd->system->realloc, grid->pairs, &grid->pairCapacity, grid->pairCount + 1, sizeof(CollisionPair));
+    CollisionPair *pair = &grid->pairs[grid->pairCount++];
+    pair->a = a < b ? a : b;
+    pair->b = a < b ? b : a;
+}
+
+// Rebuilds the cell lists: all (proxy, cell) entries sorted into hash buckets
+static void buildCells(SpatialGrid *grid)
+{
+    float inv = grid->invCellSize;
+    grid->cellsValid = 1;
+    grid->bucketCount = 0;
+
+    // 1. count cell entries to size the scratch buffers
+    int entryCount = 0;
+    for (int i = 0; i < grid->proxyCount; ++i)
+    {
+        GridProxy *p = &grid->proxies[i];
+        if (!p->active)
+            continue;
+        int cellsX = cellCoord(p->bounds.maxX, inv) - cellCoord(p->bounds.minX, inv) + 1;
+        int cellsY = cellCoord(p->bounds.maxY, inv) - cellCoord(p->bounds.minY, inv) + 1;
+        if (entryCount == 0)
+            grid->extent = p->bounds;
+        else
+            aabb_merge(&grid->extent, grid->extent, p->bounds);
+        entryCount += cellsX * cellsY;
+    }
+    if (entryCount == 0)
+        return;
+
+    int bucketCount = MIN_BUCKETS;
+    while (bucketCount < entryCount)
+        bucketCount *= 2;
+    unsigned int mask = (unsigned int)bucketCount - 1;
+
+    grid->entries = ensureCapacity(pd->system->realloc, grid->entries, &grid->entryCapacity, entryCount, sizeof(GridEntry));
+    grid->buckets = ensureCapacity(pd->system->realloc, grid->buckets, &grid->bucketCapacity, bucketCount + 1, sizeof(int));
+    memset(grid->buckets, 0, sizeof(int) * (bucketCount + 1));
+
+    // 2. counting sort of all (proxy, cell) entries into hash buckets
+    for (int i = 0; i < grid->proxyCount; ++i)
+    {
+        GridProxy *p = &grid->proxies[i];
+        if (!p->active)
+            continue;
+        int x1 = cellCoord(p->bounds.maxX, inv);
+        int y1 = cellCoord(p->bounds.maxY, inv);
+        for (int y = cellCoord(p->bounds.minY, inv); y <= y1; ++y)
+            for (int x = cellCoord(p->bounds.minX, inv); x <= x1; ++x)
+                ++grid->buckets[cellHash(x, y, mask)];
+    }
+    for (int b = 1; b < bucketCount; ++b)
+        grid->buckets[b] += grid->buckets[b - 1];
+    grid->buckets[bucketCount] = entryCount;
+
+    // filling back to front turns the running sums into bucket start indices
+    for (int i = 0; i < grid->proxyCount; ++i)
+    {
+        GridProxy *p = &grid->proxies[i];
+        if (!p->active)
+            continue;
+        int x1 = cellCoord(p->bounds.maxX, inv);
+        int y1 = cellCoord(p->bounds.maxY, inv);
+        for (int y = cellCoord(p->bounds.minY, inv); y <= y1; ++y)
+        {
+            for (int x = cellCoord(p->bounds.minX, inv); x <= x1; ++x)
+            {
+                GridEntry *e = &grid->entries[--grid->buckets[cellHash(x, y, mask)]];
+                e->proxy = i;
+                e->cellX = x;
+                e->cellY = y;
+            }
+        }
+    }
+
+    grid->bucketCount = bucketCount;
+}
+
+// --- GRID ---
+
+SpatialGrid *spatialGrid_new(float cellSize)
+{
+    SpatialGrid *grid = pd->system->realloc(NULL, sizeof(SpatialGrid));
+    memset(grid, 0, sizeof(SpatialGrid));
+    grid->cellSize = cellSize;
+    grid->invCellSize = 1.0f / cellSize;
+    grid->freeList = -1;
+    return grid;
+}
+
+void spatialGrid_free(SpatialGrid *grid)
+{
+    pd->system->realloc(grid->proxies, 0);
+    pd->system->realloc(grid->entries, 0);
+    pd->system->realloc(grid->buckets, 0);
+    pd->system->realloc(grid->pairs, 0);
+    pd->system->realloc(grid, 0);
+}
+
+void spatialGrid_clear(SpatialGrid *grid)
+{
+    grid->proxyCount = 0;
+    grid->freeList = -1;
+    grid->pairCount = 0;
+    grid->cellsValid = 0;
+}
+
+int spatialGrid_insert(SpatialGrid *grid, AABB bounds)
+{
+    int id;
+    if (grid->freeList >= 0)
+    {
+        id = grid->freeList;
+        grid->freeList = grid->proxies[id].nextFree;
+    }
+    else
+    {
+        grid->proxies = ensureCapacity(pd->system->realloc, grid->proxies, &grid->proxyCapacity, grid->proxyCount + 1, sizeof(GridProxy));
+        id = grid->proxyCount++;
+    }
+
+    grid->proxies[id].bounds = bounds;
+    grid->proxies[id].active = 1;
+    grid->proxies[id].nextFree = -1;
+    grid->proxies[id].queryStamp = 0;
+    grid->proxies[id].filter = COLLISION_FILTER_DEFAULT;
+    grid->cellsValid = 0;
+    return id;
+}
+
+void spatialGrid_update(SpatialGrid *grid, int id, AABB bounds)
+{
+    grid->proxies[id].bounds = bounds;
+    grid->cellsValid = 0;
+}
+
+void spatialGrid_remove(SpatialGrid *grid, int id)
+{
+    grid->proxies[id].active = 0;
+    grid->proxies[id].nextFree = grid->freeList;
+    grid->freeList = id;
+    grid->cellsValid = 0;
+}
+
+void spatialGrid_setFilter(SpatialGrid *grid, int id, CollisionFilter filter)
+{
+    grid->proxies[id].filter = filter;
+}
+
+int spatialGrid_isValidId(SpatialGrid *grid, int id)
+{
+    return id >= 0 && id < grid->proxyCount && grid->proxies[id].active;
+}
+
+int spatialGrid_findPairs(SpatialGrid *grid)
+{
+    STATS_TIMER_START(TIMER_BROADPHASE);
+    float inv = grid->invCellSize;
+    grid->pairCount = 0;
+
+    if (!grid->cellsValid)
+        buildCells(grid);
+
+    // test all entries sharing a cell
+    for (int b = 0; b < grid->bucketCount; ++b)
+    {
+        int end = grid->buckets[b + 1];
+        for (int i = grid->buckets[b]; i < end; ++i)
+        {
+            GridEntry *ei = &grid->entries[i];
+            AABB bi = grid->proxies[ei->proxy].bounds;
+            for (int k = i + 1; k < end; ++k)
+            {
+                GridEntry *ek = &grid->entries[k];
+                // different cells can end up in the same bucket
+                if (ei->cellX != ek->cellX || ei->cellY != ek->cellY)
+                    continue;
+
+                AABB bk = grid->proxies[ek->proxy].bounds;
+                if (!aabb_overlaps(bi, bk))
+                    continue;
+
+                // bodies spanning multiple cells share more than one cell, only report
+                // the pair in the cell containing the top-left corner of their overlap
+                if (cellCoord(fmaxf(bi.minX, bk.minX), inv) != ei->cellX
+                        || cellCoord(fmaxf(bi.minY, bk.minY), inv) != ei->cellY)
+                    continue;
+
+                if (!collisionFilter_test(grid->proxies[ei->proxy].filter, grid->proxies[ek->proxy].filter))
+                {
+                    STATS_COUNT(STAT_FILTERED_PAIRS);
+                    continue;
+                }
+
+                pushPair(grid, ei->proxy, ek->proxy);
+            }
+        }
+    }
+
+    STATS_TIMER_STOP(TIMER_BROADPHASE);
+    return grid->pairCount;
+}
+
+// Distance (in t) from origin to the first cell border along one axis and between borders
+static void initCellStep(float *tNext, float *tDelta, int *step, int cell, float origin, float dir, float cellSize)
+{
+    if (dir > 0)
+    {
+        *step = 1;
+        *tDelta = cellSize / dir;
+        *tNext = ((cell + 1) * cellSize - origin) / dir;
+    }
+    else if (dir < 0)
+    {
+        *step = -1;
+        *tDelta = cellSize / -dir;
+        *tNext = (cell * cellSize - origin) / dir;
+    }
+    else
+    {
+        *step = 0;
+        *tDelta = FLT_MAX;
+        *tNext = FLT_MAX;
+    }
+}
+
+void spatialGrid_raycast(SpatialGrid *grid, Vector2D origin, Vector2D dir, float maxT, RaycastCallback callback, void *userData)
+{
+    float inv = grid->invCellSize;
+
+    if (!grid->cellsValid)
+        buildCells(grid);
+
+    float t;
+    if (grid->bucketCount == 0 || !aabb_raycast(&t, grid->extent, origin, dir, maxT))
+        return;
+
+    unsigned int mask = (unsigned int)grid->bucketCount - 1;
+    int minCellX = cellCoord(grid->extent.minX, inv);
+    int maxCellX = cellCoord(grid->extent.maxX, inv);
+    int minCellY = cellCoord(grid->extent.minY, inv);
+    int maxCellY = cellCoord(grid->extent.maxY, inv);
+    ++grid->queryStamp;
+
+    // walk the cells along the ray (Amanatides & Woo), starting where it enters the bodies' extent
+    int x = cellCoord(origin.x + dir.x * t, inv);
+    int y = cellCoord(origin.y + dir.y * t, inv);
+    int stepX, stepY;
+    float tNextX, tNextY, tDeltaX, tDeltaY;
+    initCellStep(&tNextX, &tDeltaX, &stepX, x, origin.x, dir.x, grid->cellSize);
+    initCellStep(&tNextY, &tDeltaY, &stepY, y, origin.y, dir.y, grid->cellSize);
+
+    while (t <= maxT)
+    {
+        if ((stepX > 0 && x > maxCellX) || (stepX < 0 && x < minCellX)
+                || (stepY > 0 && y > maxCellY) || (stepY < 0 && y < minCellY))
+            return;
+
+        unsigned int b = cellHash(x, y, mask);
+        for (int i = grid->buckets[b]; i < grid->buckets[b + 1]; ++i)
+        {
+            GridEntry *e = &grid->entries[i];
+            GridProxy *p = &grid->proxies[e->proxy];
+            if (e->cellX != x || e->cellY != y || p->queryStamp == grid->queryStamp)
+                continue;
+
+            // bodies spanning several cells are only reported once
+            p->queryStamp = grid->queryStamp;
+            float tEnter;
+            if (!aabb_raycast(&tEnter, p->bounds, origin, dir, maxT))
+                continue;
+
+            maxT = callback(userData, e->proxy, origin, dir, maxT);
+            if (maxT < 0)
+                return;
+        }
+
+        if (tNextX < tNextY)
+        {
+            t = tNextX;
+            tNextX += tDeltaX;
+            x += stepX;
+        }
+        else
+        {
+            t = tNextY;
+            tNextY += tDeltaY;
+            y += stepY;
+        }
+    }
+}
+
+// --- LUA HOOKS ---
+
+static int lua_grid_new(lua_State *L)
+{
+    float cellSize = pd->lua->getArgFloat(1);
+    if (cellSize <= 0)
+    {
+        pd->system->error("%s:%i: grid cell size must be > 0", __FILE__, __LINE__);
+        return 0;
+    }
+
+    SpatialGrid *grid = spatialGrid_new(cellSize);
+    pd->lua->pushObject(grid, GRID_TYPE_NAME, 0);
+    return 1;
+}
+
+static int lua_grid_free(lua_State *L)
+{
+    SpatialGrid *grid = pd->lua->getArgObject(1, GRID_TYPE_NAME, NULL);
+    spatialGrid_free(grid);
+    return 0;
+}
+
+// Lua ids are 1-based
+static int lua_grid_insertCircle(lua_State *L)
+{
+    SpatialGrid *grid = pd->lua->getArgObject(1, GRID_TYPE_NAME, NULL);
+    Vector2D *center = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(3);
+
+    AABB bounds;
+    aabb_fromCircle(&bounds, *center, radius);
+
+    pd->lua->pushInt(spatialGrid_insert(grid, bounds) + 1);
+    return 1;
+}
+
+static int lua_grid_insertPoly(lua_State *L)
+{
+    SpatialGrid *grid = pd->lua->getArgObject(1, GRID_TYPE_NAME, NULL);
+    Polygon *poly = pd->lua->getArgObject(2, POLY_TYPE_NAME, NULL);
+
+    polygon_updateCache(poly);
+    AABB bounds = poly->bounds;
+
+    pd->lua->pushInt(spatialGrid_insert(grid, bounds) + 1);
+    return 1;
+}
+
+static int lua_grid_updateCircle(lua_State *L)
+{
+    SpatialGrid *grid = pd->lua->getArgObject(1, GRID_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+    Vector2D *center = pd->lua->getArgObject(3, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(4);
+
+    if (!spatialGrid_isValidId(grid, id))
+        return 0;
+
+    AABB bounds;
+    aabb_fromCircle(&bounds, *center, radius);
+    spatialGrid_update(grid, id, bounds);
+    return 0;
+}
+
+static int lua_grid_updatePoly(lua_State *L)
+{
+    SpatialGrid *grid = pd->lua->getArgObject(1, GRID_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+    Polygon *poly = pd->lua->getArgObject(3, POLY_TYPE_NAME, NULL);
+
+    if (!spatialGrid_isValidId(grid, id))
+        return 0;
+
+    polygon_updateCache(poly);
+    AABB bounds = poly->bounds;
+    spatialGrid_update(grid, id, bounds);
+    return 0;
+}
+
+// grid:insertBox(x, y, width, height)
+static int lua_grid_insertBox(lua_State *L)
+{
+    SpatialGrid *grid = pd->lua->getArgObject(1, GRID_TYPE_NAME, NULL);
+
+    AABB bounds;
+    bounds.minX = pd->lua->getArgFloat(2);
+    bounds.minY = pd->lua->getArgFloat(3);
+    bounds.maxX = bounds.minX + pd->lua->getArgFloat(4);
+    bounds.maxY = bounds.minY + pd->lua->getArgFloat(5);
+
+    pd->lua->pushInt(spatialGrid_insert(grid, bounds) + 1);
+    return 1;
+}
+
+// grid:insertCapsule(a, b, radius), radius 0 for a segment
+static int lua_grid_insertCapsule(lua_State *L)
+{
+    SpatialGrid *grid = pd->lua->getArgObject(1, GRID_TYPE_NAME, NULL);
+    Vector2D *a = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
+    Vector2D *b = pd->lua->getArgObject(3, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(4);
+
+    AABB bounds;
+    aabb_fromCapsule(&bounds, *a, *b, radius);
+
+    pd->lua->pushInt(spatialGrid_insert(grid, bounds) + 1);
+    return 1;
+}
+
+static int lua_grid_updateBox(lua_State *L)
+{
+    SpatialGrid *grid = pd->lua->getArgObject(1, GRID_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+
+    if (!spatialGrid_isValidId(grid, id))
+        return 0;
+
+    AABB bounds;
+    bounds.minX = pd->lua->getArgFloat(3);
+    bounds.minY = pd->lua->getArgFloat(4);
+    bounds.maxX = bounds.minX + pd->lua->getArgFloat(5);
+    bounds.maxY = bounds.minY + pd->lua->getArgFloat(6);
+    spatialGrid_update(grid, id, bounds);
+    return 0;
+}
+
+static int lua_grid_updateCapsule(lua_State *L)
+{
+    SpatialGrid *grid = pd->lua->getArgObject(1, GRID_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+    Vector2D *a = pd->lua->getArgObject(3, VECTOR_TYPE_NAME, NULL);
+    Vector2D *b = pd->lua->getArgObject(4, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(5);
+
+    if (!spatialGrid_isValidId(grid, id))
+        return 0;
+
+    AABB bounds;
+    aabb_fromCapsule(&bounds, *a, *b, radius);
+    spatialGrid_update(grid, id, bounds);
+    return 0;
+}
+
+static int lua_grid_remove(lua_State *L)
+{
+    SpatialGrid *grid = pd->lua->getArgObject(1, GRID_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+
+    if (!spatialGrid_isValidId(grid, id))
+        return 0;
+
+    spatialGrid_remove(grid, id);
+    return 0;
+}
+
+// grid:setFilter(id, category, mask, [group]), mask -1 for all categories
+static int lua_grid_setFilter(lua_State *L)
+{
+    SpatialGrid *grid = pd->lua->getArgObject(1, GRID_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+
+    if (!spatialGrid_isValidId(grid, id))
+        return 0;
+
+    CollisionFilter filter;
+    filter.category = (uint32_t)pd->lua->getArgInt(3);
+    filter.mask = (uint32_t)pd->lua->getArgInt(4);
+    filter.group = pd->lua->argIsNil(5) ? 0 : pd->lua->getArgInt(5);
+    spatialGrid_setFilter(grid, id, filter);
+    return 0;
+}
+
+static int lua_grid_clear(lua_State *L)
+{
+    SpatialGrid *grid = pd->lua->getArgObject(1, GRID_TYPE_NAME, NULL);
+    spatialGrid_clear(grid);
+    return 0;
+}
+
+static int lua_grid_findPairs(lua_State *L)
+{
+    SpatialGrid *grid = pd->lua->getArgObject(1, GRID_TYPE_NAME, NULL);
+
+    pd->lua->pushInt(spatialGrid_findPairs(grid));
+    return 1;
+}
+
+// returns ids of pair i (1-based) of the last findPairs call
+static int lua_grid_getPair(lua_State *L)
+{
+    SpatialGrid *grid = pd->lua->getArgObject(1, GRID_TYPE_NAME, NULL);
+    int i = pd->lua->getArgInt(2) - 1;
+
+    if (i < 0 || i >= grid->pairCount)
+        return 0;
+
+    pd->lua->pushInt(grid->pairs[i].a + 1);
+    pd->lua->pushInt(grid->pairs[i].b + 1);
+    return 2;
+}
+
+static const lua_reg gridlib[] =
+{
+    { "new",            lua_grid_new },
+    { "__gc",           lua_grid_free },
+    { "insertCircle",   lua_grid_insertCircle },
+    { "insertPoly",     lua_grid_insertPoly },
+    { "insertBox",      lua_grid_insertBox },
+    { "insertCapsule",  lua_grid_insertCapsule },
+    { "updateCircle",   lua_grid_updateCircle },
+    { "updatePoly",     lua_grid_updatePoly },
+    { "updateBox",      lua_grid_updateBox },
+    { "updateCapsule",  lua_grid_updateCapsule },
+    { "remove",         lua_grid_remove },
+    { "setFilter",      lua_grid_setFilter },
+    { "clear",          lua_grid_clear },
+    { "findPairs",      lua_grid_findPairs },
+    { "getPair",        lua_grid_getPair },
+    { NULL, NULL }
+};
+
+void registerSpatialGrid(PlaydateAPI* playdate)
+{
+    pd = playdate;
+
+    const char* err;
+
+    if (!pd->lua->registerClass(GRID_TYPE_NAME, gridlib, NULL, 0, &err))
+        pd->system->error("%s:%i: registerClass failed, %s", __FILE__, __LINE__, err);
+}
@@ -0,0 +1,80 @@
+#ifndef _SPATIALGRID_H
+#define _SPATIALGRID_H
+
+#include "pd_api.h"
+#include "aabb.h"
+#include "broadphase.h"
+
+#define GRID_TYPE_NAME "collision.grid"
+
+// Uniform grid broadphase. Cells are hashed, so the grid is not limited to
+// the screen area. Bodies are only stored as bounding boxes, the cell lists
+// are rebuilt from those when needed (by spatialGrid_findPairs or
+// spatialGrid_raycast after a change), which keeps insert/update/remove O(1)
+// and finding pairs roughly linear in body count.
+
+typedef struct
+{
+    AABB bounds;
+    int active;
+    int nextFree;
+    int queryStamp;     // last raycast that visited this proxy
+    CollisionFilter filter;
+} GridProxy;
+
+typedef struct
+{
+    int proxy;
+    int cellX;
+    int cellY;
+} GridEntry;
+
+typedef struct
+{
+    float cellSize;
+    float invCellSize;
+
+    GridProxy *proxies;
+    int proxyCount;
+    int proxyCapacity;
+    int freeList;
+
+    // cell lists, rebuilt after bodies changed
+    GridEntry *entries;
+    int entryCapacity;
+    int *buckets;
+    int bucketCount;
+    int bucketCapacity;
+    AABB extent;        // bounds of all bodies
+    int cellsValid;
+    int queryStamp;
+
+    // result of the last spatialGrid_findPairs
+    CollisionPair *pairs;
+    int pairCount;
+    int pairCapacity;
+} SpatialGrid;
+
+SpatialGrid *spatialGrid_new(float cellSize);
+void spatialGrid_free(SpatialGrid *grid);
+void spatialGrid_clear(SpatialGrid *grid);
+
+// Returns id of the new body (>= 0)
+int spatialGrid_insert(SpatialGrid *grid, AABB bounds);
+void spatialGrid_update(SpatialGrid *grid, int id, AABB bounds);
+void spatialGrid_remove(SpatialGrid *grid, int id);
+// Bodies start with COLLISION_FILTER_DEFAULT, see CollisionFilter
+void spatialGrid_setFilter(SpatialGrid *grid, int id, CollisionFilter filter);
+
+// Fills grid->pairs with all pairs of bodies with overlapping bounds whose filters
+// let them collide. Every pair is reported exactly once. Returns the number of pairs.
+int spatialGrid_findPairs(SpatialGrid *grid);
+// Calls callback for every body whose bounds the ray crosses, walking the cells along
+// the ray in order (see RaycastCallback)
+void spatialGrid_raycast(SpatialGrid *grid, Vector2D origin, Vector2D dir, float maxT, RaycastCallback callback, void *userData);
+
+int spatialGrid_isValidId(SpatialGrid *grid, int id);
+
+void registerSpatialGrid(PlaydateAPI *playdate);
+
+#endif // _SPATIALGRID_H
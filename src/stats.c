@@ -0,0 +1,288 @@
+#include "stats.h"
+
+#if defined(TARGET_PLAYDATE)
+// Cortex-M7 debug registers: DEMCR.TRCENA powers the DWT, DWT_CTRL.CYCCNTENA starts the counter
+#define DEMCR (*(volatile uint32_t *)0xE000EDFCu)
+#define DWT_CTRL (*(volatile uint32_t *)0xE0001000u)
+#define DWT_CYCCNT (*(volatile uint32_t *)0xE0001004u)
+#define DEVICE_CPU_HZ 168000000u
+#elif defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// --- CLOCK ---
+
+uint32_t stats_ticks(void)
+{
+#if defined(TARGET_PLAYDATE)
+    if (!(DWT_CTRL & 1u))
+    {
+        DEMCR |= 1u << 24;
+        DWT_CYCCNT = 0;
+        DWT_CTRL |= 1u;
+    }
+    return DWT_CYCCNT;
+#elif defined(_WIN32)
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (uint32_t)counter.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+#endif
+}
+
+uint32_t stats_ticksPerSecond(void)
+{
+#if defined(TARGET_PLAYDATE)
+    return DEVICE_CPU_HZ;
+#elif defined(_WIN32)
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return (uint32_t)frequency.QuadPart;
+#else
+    return 1000000000u;
+#endif
+}
+
+#if COLLISION_STATS
+
+#if defined(COLLISION_THREADS) && COLLISION_THREADS
+#include <pthread.h>
+#endif
+
+static PlaydateAPI* pd = NULL;
+
+// keep in order of StatCounter / StatTimer
+static const char *counterNames[STAT_COUNT] =
+{
+    "circleCircle",
+    "circlePoly",
+    "polyPoly",
+    "gjk",
+    "primitive",
+    "swept",
+    "ray",
+    "manifold",
+    "compoundParts",
+    "satAxes",
+    "boundsExits",
+    "axisExits",
+    "filteredPairs",
+    "cacheUpdates",
+    "normals",
+    "decompositions",
+    "normalize",
+    "allocs",
+};
+
+static const char *timerNames[TIMER_COUNT * 2] =
+{
+    "broadphase_us", "broadphase_calls",
+    "narrowphase_us", "narrowphase_calls",
+    "worldStep_us", "worldStep_calls",
+};
+
+uint32_t stats_counters[STAT_COUNT];
+static uint64_t timerTicks[TIMER_COUNT];
+static uint32_t timerCalls[TIMER_COUNT];
+
+#if defined(COLLISION_THREADS) && COLLISION_THREADS
+static pthread_mutex_t timerMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+void stats_addTime(StatTimer timer, uint32_t start)
+{
+    uint32_t elapsed = stats_ticks() - start;
+#if defined(COLLISION_THREADS) && COLLISION_THREADS
+    pthread_mutex_lock(&timerMutex);
+#endif
+    timerTicks[timer] += elapsed;
+    ++timerCalls[timer];
+#if defined(COLLISION_THREADS) && COLLISION_THREADS
+    pthread_mutex_unlock(&timerMutex);
+#endif
+}
+
+void stats_reset(void)
+{
+    memset(stats_counters, 0, sizeof(stats_counters));
+    memset(timerTicks, 0, sizeof(timerTicks));
+    memset(timerCalls, 0, sizeof(timerCalls));
+}
+
+int stats_entryCount(void)
+{
+    return STAT_COUNT + TIMER_COUNT * 2;
+}
+
+void stats_entry(int index, const char **name, uint32_t *value)
+{
+    if (index < STAT_COUNT)
+    {
+        *name = counterNames[index];
+        *value = stats_counters[index];
+        return;
+    }
+
+    index -= STAT_COUNT;
+    *name = timerNames[index];
+    if (index % 2 == 0)
+        *value = (uint32_t)((double)timerTicks[index / 2] * 1e6 / stats_ticksPerSecond());
+    else
+        *value = timerCalls[index / 2];
+}
+
+// No printf, formatting floats is not available everywhere on the device
+static int appendString(char *buffer, int size, int pos, const char *str)
+{
+    while (*str != '\0')
+    {
+        if (pos >= size - 1)
+            return -1;
+        buffer[pos++] = *str++;
+    }
+    return pos;
+}
+
+static int appendUInt(char *buffer, int size, int pos, uint32_t value)
+{
+    char digits[10];
+    int count = 0;
+    do
+    {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    while (count > 0)
+    {
+        if (pos >= size - 1)
+            return -1;
+        buffer[pos++] = digits[--count];
+    }
+    return pos;
+}
+
+int stats_writeCSV(char *buffer, int size)
+{
+    int pos = appendString(buffer, size, 0, "name,value\n");
+    for (int i = 0; i < stats_entryCount() && pos >= 0; ++i)
+    {
+        const char *name;
+        uint32_t value;
+        stats_entry(i, &name, &value);
+        pos = appendString(buffer, size, pos, name);
+        if (pos >= 0)
+            pos = appendString(buffer, size, pos, ",");
+        if (pos >= 0)
+            pos = appendUInt(buffer, size, pos, value);
+        if (pos >= 0)
+            pos = appendString(buffer, size, pos, "\n");
+    }
+
+    if (pos < 0)
+        return -1;
+    buffer[pos] = '\0';
+    return pos;
+}
+
+// --- LUA HOOKS ---
+
+#define STATS_CSV_SIZE 1024
+
+static int lua_stats_reset(lua_State *L)
+{
+    stats_reset();
+    return 0;
+}
+
+static int lua_stats_getCount(lua_State *L)
+{
+    pd->lua->pushInt(stats_entryCount());
+    return 1;
+}
+
+// stats.getEntry(i) -> name, value for entry i (1-based)
+static int lua_stats_getEntry(lua_State *L)
+{
+    int index = pd->lua->getArgInt(1) - 1;
+    if (index < 0 || index >= stats_entryCount())
+    {
+        pd->system->error("%s:%i: stats entry %d out of range", __FILE__, __LINE__, index + 1);
+        return 0;
+    }
+
+    const char *name;
+    uint32_t value;
+    stats_entry(index, &name, &value);
+    pd->lua->pushString(name);
+    pd->lua->pushInt((int)value);
+    return 2;
+}
+
+// stats.get(name) -> value or nil
+static int lua_stats_get(lua_State *L)
+{
+    const char *wanted = pd->lua->getArgString(1);
+    for (int i = 0; i < stats_entryCount(); ++i)
+    {
+        const char *name;
+        uint32_t value;
+        stats_entry(i, &name, &value);
+        if (strcmp(name, wanted) == 0)
+        {
+            pd->lua->pushInt((int)value);
+            return 1;
+        }
+    }
+
+    pd->lua->pushNil();
+    return 1;
+}
+
+static int lua_stats_csv(lua_State *L)
+{
+    char *buffer = pd->system->realloc(NULL, STATS_CSV_SIZE);
+    if (stats_writeCSV(buffer, STATS_CSV_SIZE) < 0)
+        pd->system->error("%s:%i: stats do not fit into %d bytes", __FILE__, __LINE__, STATS_CSV_SIZE);
+    else
+        pd->lua->pushString(buffer);
+    pd->system->realloc(buffer, 0);
+    return 1;
+}
+
+static int lua_stats_log(lua_State *L)
+{
+    char *buffer = pd->system->realloc(NULL, STATS_CSV_SIZE);
+    if (stats_writeCSV(buffer, STATS_CSV_SIZE) >= 0)
+        pd->system->logToConsole("%s", buffer);
+    pd->system->realloc(buffer, 0);
+    return 0;
+}
+
+static const lua_reg statslib[] =
+{
+    { "reset",          lua_stats_reset },
+    { "getCount",       lua_stats_getCount },
+    { "getEntry",       lua_stats_getEntry },
+    { "get",            lua_stats_get },
+    { "csv",            lua_stats_csv },
+    { "log",            lua_stats_log },
+    { NULL, NULL }
+};
+
+void registerStats(PlaydateAPI* playdate)
+{
+    pd = playdate;
+
+    const char* err;
+
+    if (!pd->lua->registerClass(STATS_TYPE_NAME, statslib, NULL, 0, &err))
+        pd->system->error("%s:%i: registerClass failed, %s", __FILE__, __LINE__, err);
+}
+
+#endif // COLLISION_STATS
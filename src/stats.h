@@ -0,0 +1,94 @@
+#ifndef _STATS_H
+#define _STATS_H
+
+#include "pd_api.h"
+
+#define STATS_TYPE_NAME "collision.stats"
+
+// Optional instrumentation: counters for calls, SAT axes, early exits and allocations plus
+// timers for the broadphase and narrowphase, readable through collision.stats. Only compiled
+// in with COLLISION_STATS=1 (CMake option COLLISION_STATS), otherwise every macro below is
+// empty and shipping builds carry no trace of it.
+#ifndef COLLISION_STATS
+#define COLLISION_STATS 0
+#endif
+
+// High resolution clock of the timers below and of the scenario suite, always compiled in.
+// pd->system->getElapsedTime is a float of seconds since the last reset, whose steps grow to
+// ~61µs after 10 minutes, more than a whole broadphase call. The ticks come from the DWT
+// cycle counter on the device, clock_gettime or QueryPerformanceCounter everywhere else.
+// Only differences of two readings are meaningful (uint32_t arithmetic handles one wrap,
+// every ~25 s on the device, ~4 s on the host), sum them up in 64 bits.
+uint32_t stats_ticks(void);
+uint32_t stats_ticksPerSecond(void);
+
+typedef enum
+{
+    STAT_CIRCLE_CIRCLE,     // circleCircle calls, single and batched
+    STAT_CIRCLE_POLY,       // circlePoly calls (SAT)
+    STAT_POLY_POLY,         // polyPoly calls (SAT)
+    STAT_GJK,               // calls of the GJK variants
+    STAT_PRIMITIVE,         // aabb, capsule and segment calls
+    STAT_SWEPT,             // swept calls
+    STAT_RAY,               // ray casts against single shapes
+    STAT_MANIFOLD,          // polyPoly_manifold calls
+    STAT_COMPOUND_PARTS,    // convex parts tested for concave polygons
+    STAT_SAT_AXES,          // axes projected by the SAT functions
+    STAT_BOUNDS_EXITS,      // calls rejected by the cached bounds
+    STAT_AXIS_EXITS,        // calls ended by a separating axis
+    STAT_FILTERED_PAIRS,    // overlapping pairs dropped by collision filters in findPairs
+    STAT_CACHE_UPDATES,     // polygon_updateCache calls that recomputed data
+    STAT_NORMALS,           // polygon_cacheNormals calls
+    STAT_DECOMPOSITIONS,    // concave polygons split into parts
+    STAT_NORMALIZE,         // vector2D_normalize calls
+    STAT_ALLOCS,            // allocations of polygons, caches, grown buffers and objects returned to Lua
+    STAT_COUNT
+} StatCounter;
+
+typedef enum
+{
+    TIMER_BROADPHASE,       // findPairs of grid, tree and sweep and prune
+    TIMER_NARROWPHASE,      // batch functions and the pair loop of world_step
+    TIMER_WORLD_STEP,       // whole world_step
+    TIMER_COUNT
+} StatTimer;
+
+#if COLLISION_STATS
+
+extern uint32_t stats_counters[STAT_COUNT];
+
+#if defined(COLLISION_THREADS) && COLLISION_THREADS
+// the kernels may run on several threads at once, see parallel.h
+#define STATS_COUNT(counter) __atomic_add_fetch(&stats_counters[counter], 1, __ATOMIC_RELAXED)
+#define STATS_ADD(counter, n) __atomic_add_fetch(&stats_counters[counter], (uint32_t)(n), __ATOMIC_RELAXED)
+#else
+#define STATS_COUNT(counter) (++stats_counters[counter])
+#define STATS_ADD(counter, n) (stats_counters[counter] += (uint32_t)(n))
+#endif
+#define STATS_TIMER_START(timer) uint32_t statsStart_##timer = stats_ticks()
+#define STATS_TIMER_STOP(timer) stats_addTime(timer, statsStart_##timer)
+
+// Adds the ticks since start to timer
+void stats_addTime(StatTimer timer, uint32_t start);
+
+void stats_reset(void);
+// Counters followed by two entries per timer (total microseconds and number of calls)
+int stats_entryCount(void);
+void stats_entry(int index, const char **name, uint32_t *value);
+// Writes "name,value" lines, returns the length (without terminator) or -1 if size is too small
+int stats_writeCSV(char *buffer, int size);
+
+void registerStats(PlaydateAPI *playdate);
+
+#else
+
+#define STATS_COUNT(counter) ((void)0)
+#define STATS_ADD(counter, n) ((void)0)
+#define STATS_TIMER_START(timer) ((void)0)
+#define STATS_TIMER_STOP(timer) ((void)0)
+
+#define registerStats(playdate) ((void)(playdate))
+
+#endif // COLLISION_STATS
+
+#endif // _STATS_H
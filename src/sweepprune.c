@@ -0,0 +1,389 @@
+#include "sweepprune.h"
+#include "polygon.h"
+#include "stats.h"
+#include "util.h"
+
+static PlaydateAPI* pd = NULL;
+
+// -- HELPER ---
+
+// Insertion sort by minX, keeping the id -> slot mapping up to date
+static void sortEntries(SweepPrune *sap)
+{
+    SapEntry *entries = sap->entries;
+    for (int i = 1; i < sap->entryCount; ++i)
+    {
+        if (entries[i - 1].bounds.minX <= entries[i].bounds.minX)
+            continue;
+
+        SapEntry e = entries[i];
+        int k = i;
+        while (k > 0 && entries[k - 1].bounds.minX > e.bounds.minX)
+        {
+            entries[k] = entries[k - 1];
+            sap->slots[entries[k].id] = k;
+            --k;
+        }
+        entries[k] = e;
+        sap->slots[e.id] = k;
+    }
+}
+
+// --- SWEEP AND PRUNE ---
+
+SweepPrune *sweepPrune_new(void)
+{
+    SweepPrune *sap = pd->system->realloc(NULL, sizeof(SweepPrune));
+    memset(sap, 0, sizeof(SweepPrune));
+    return sap;
+}
+
+void sweepPrune_free(SweepPrune *sap)
+{
+    pd->system->realloc(sap->entries, 0);
+    pd->system->realloc(sap->slots, 0);
+    pd->system->realloc(sap->freeIds, 0);
+    pd->system->realloc(sap->pairs, 0);
+    pd->system->realloc(sap, 0);
+}
+
+void sweepPrune_clear(SweepPrune *sap)
+{
+    sap->entryCount = 0;
+    sap->slotCount = 0;
+    sap->freeIdCount = 0;
+    sap->pairCount = 0;
+}
+
+int sweepPrune_insert(SweepPrune *sap, AABB bounds)
+{
+    int id;
+    if (sap->freeIdCount > 0)
+    {
+        id = sap->freeIds[--sap->freeIdCount];
+    }
+    else
+    {
+        sap->slots = ensureCapacity(pd->system->realloc, sap->slots, &sap->slotCapacity, sap->slotCount + 1, sizeof(int));
+        id = sap->slotCount++;
+    }
+
+    // appended at the end, the next sort moves it into place
+    sap->entries = ensureCapacity(pd->system->realloc, sap->entries, &sap->entryCapacity, sap->entryCount + 1, sizeof(SapEntry));
+    sap->entries[sap->entryCount].bounds = bounds;
+    sap->entries[sap->entryCount].id = id;
+    sap->entries[sap->entryCount].filter = COLLISION_FILTER_DEFAULT;
+    sap->slots[id] = sap->entryCount;
+    ++sap->entryCount;
+    return id;
+}
+
+void sweepPrune_update(SweepPrune *sap, int id, AABB bounds)
+{
+    sap->entries[sap->slots[id]].bounds = bounds;
+}
+
+void sweepPrune_remove(SweepPrune *sap, int id)
+{
+    int slot = sap->slots[id];
+    --sap->entryCount;
+    memmove(&sap->entries[slot], &sap->entries[slot + 1], sizeof(SapEntry) * (sap->entryCount - slot));
+    for (int i = slot; i < sap->entryCount; ++i)
+        sap->slots[sap->entries[i].id] = i;
+
+    sap->slots[id] = -1;
+    sap->freeIds = ensureCapacity(pd->system->realloc, sap->freeIds, &sap->freeIdCapacity, sap->freeIdCount + 1, sizeof(int));
+    sap->freeIds[sap->freeIdCount++] = id;
+}
+
+void sweepPrune_setFilter(SweepPrune *sap, int id, CollisionFilter filter)
+{
+    sap->entries[sap->slots[id]].filter = filter;
+}
+
+int sweepPrune_findPairs(SweepPrune *sap)
+{
+    STATS_TIMER_START(TIMER_BROADPHASE);
+    sap->pairCount = 0;
+    sortEntries(sap);
+
+    SapEntry *entries = sap->entries;
+    for (int i = 0; i < sap->entryCount; ++i)
+    {
+        AABB a = entries[i].bounds;
+        // all following entries start further right, stop at the first one starting past our right edge
+        for (int k = i + 1; k < sap->entryCount && entries[k].bounds.minX <= a.maxX; ++k)
+        {
+            AABB b = entries[k].bounds;
+            if (a.minY > b.maxY || b.minY > a.maxY)
+                continue;
+            if (!collisionFilter_test(entries[i].filter, entries[k].filter))
+            {
+                STATS_COUNT(STAT_FILTERED_PAIRS);
+                continue;
+            }
+
+            sap->pairs = ensureCapacity(pd->system->realloc, sap->pairs, &sap->pairCapacity, sap->pairCount + 1, sizeof(CollisionPair));
+            int idA = entries[i].id;
+            int idB = entries[k].id;
+            sap->pairs[sap->pairCount].a = idA < idB ? idA : idB;
+            sap->pairs[sap->pairCount].b = idA < idB ? idB : idA;
+            ++sap->pairCount;
+        }
+    }
+
+    STATS_TIMER_STOP(TIMER_BROADPHASE);
+    return sap->pairCount;
+}
+
+void sweepPrune_raycast(SweepPrune *sap, Vector2D origin, Vector2D dir, float maxT, RaycastCallback callback, void *userData)
+{
+    sortEntries(sap);
+
+    SapEntry *entries = sap->entries;
+    for (int i = 0; i < sap->entryCount; ++i)
+    {
+        // entries are sorted by their left edge, stop at the first one right of the (clipped) ray
+        float rayMaxX = fmaxf(origin.x, origin.x + dir.x * maxT);
+        if (entries[i].bounds.minX > rayMaxX)
+            break;
+
+        float tEnter;
+        if (!aabb_raycast(&tEnter, entries[i].bounds, origin, dir, maxT))
+            continue;
+
+        maxT = callback(userData, entries[i].id, origin, dir, maxT);
+        if (maxT < 0)
+            return;
+    }
+}
+
+int sweepPrune_isValidId(SweepPrune *sap, int id)
+{
+    return id >= 0 && id < sap->slotCount && sap->slots[id] >= 0;
+}
+
+// --- LUA HOOKS ---
+
+static int lua_sap_new(lua_State *L)
+{
+    SweepPrune *sap = sweepPrune_new();
+    pd->lua->pushObject(sap, SAP_TYPE_NAME, 0);
+    return 1;
+}
+
+static int lua_sap_free(lua_State *L)
+{
+    SweepPrune *sap = pd->lua->getArgObject(1, SAP_TYPE_NAME, NULL);
+    sweepPrune_free(sap);
+    return 0;
+}
+
+// Lua ids are 1-based
+static int lua_sap_insertCircle(lua_State *L)
+{
+    SweepPrune *sap = pd->lua->getArgObject(1, SAP_TYPE_NAME, NULL);
+    Vector2D *center = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(3);
+
+    AABB bounds;
+    aabb_fromCircle(&bounds, *center, radius);
+
+    pd->lua->pushInt(sweepPrune_insert(sap, bounds) + 1);
+    return 1;
+}
+
+static int lua_sap_insertPoly(lua_State *L)
+{
+    SweepPrune *sap = pd->lua->getArgObject(1, SAP_TYPE_NAME, NULL);
+    Polygon *poly = pd->lua->getArgObject(2, POLY_TYPE_NAME, NULL);
+
+    polygon_updateCache(poly);
+    AABB bounds = poly->bounds;
+
+    pd->lua->pushInt(sweepPrune_insert(sap, bounds) + 1);
+    return 1;
+}
+
+static int lua_sap_updateCircle(lua_State *L)
+{
+    SweepPrune *sap = pd->lua->getArgObject(1, SAP_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+    Vector2D *center = pd->lua->getArgObject(3, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(4);
+
+    if (!sweepPrune_isValidId(sap, id))
+        return 0;
+
+    AABB bounds;
+    aabb_fromCircle(&bounds, *center, radius);
+    sweepPrune_update(sap, id, bounds);
+    return 0;
+}
+
+static int lua_sap_updatePoly(lua_State *L)
+{
+    SweepPrune *sap = pd->lua->getArgObject(1, SAP_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+    Polygon *poly = pd->lua->getArgObject(3, POLY_TYPE_NAME, NULL);
+
+    if (!sweepPrune_isValidId(sap, id))
+        return 0;
+
+    polygon_updateCache(poly);
+    AABB bounds = poly->bounds;
+    sweepPrune_update(sap, id, bounds);
+    return 0;
+}
+
+// sap:insertBox(x, y, width, height)
+static int lua_sap_insertBox(lua_State *L)
+{
+    SweepPrune *sap = pd->lua->getArgObject(1, SAP_TYPE_NAME, NULL);
+
+    AABB bounds;
+    bounds.minX = pd->lua->getArgFloat(2);
+    bounds.minY = pd->lua->getArgFloat(3);
+    bounds.maxX = bounds.minX + pd->lua->getArgFloat(4);
+    bounds.maxY = bounds.minY + pd->lua->getArgFloat(5);
+
+    pd->lua->pushInt(sweepPrune_insert(sap, bounds) + 1);
+    return 1;
+}
+
+// sap:insertCapsule(a, b, radius), radius 0 for a segment
+static int lua_sap_insertCapsule(lua_State *L)
+{
+    SweepPrune *sap = pd->lua->getArgObject(1, SAP_TYPE_NAME, NULL);
+    Vector2D *a = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, NULL);
+    Vector2D *b = pd->lua->getArgObject(3, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(4);
+
+    AABB bounds;
+    aabb_fromCapsule(&bounds, *a, *b, radius);
+
+    pd->lua->pushInt(sweepPrune_insert(sap, bounds) + 1);
+    return 1;
+}
+
+static int lua_sap_updateBox(lua_State *L)
+{
+    SweepPrune *sap = pd->lua->getArgObject(1, SAP_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+
+    if (!sweepPrune_isValidId(sap, id))
+        return 0;
+
+    AABB bounds;
+    bounds.minX = pd->lua->getArgFloat(3);
+    bounds.minY = pd->lua->getArgFloat(4);
+    bounds.maxX = bounds.minX + pd->lua->getArgFloat(5);
+    bounds.maxY = bounds.minY + pd->lua->getArgFloat(6);
+    sweepPrune_update(sap, id, bounds);
+    return 0;
+}
+
+static int lua_sap_updateCapsule(lua_State *L)
+{
+    SweepPrune *sap = pd->lua->getArgObject(1, SAP_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+    Vector2D *a = pd->lua->getArgObject(3, VECTOR_TYPE_NAME, NULL);
+    Vector2D *b = pd->lua->getArgObject(4, VECTOR_TYPE_NAME, NULL);
+    float radius = pd->lua->getArgFloat(5);
+
+    if (!sweepPrune_isValidId(sap, id))
+        return 0;
+
+    AABB bounds;
+    aabb_fromCapsule(&bounds, *a, *b, radius);
+    sweepPrune_update(sap, id, bounds);
+    return 0;
+}
+
+static int lua_sap_remove(lua_State *L)
+{
+    SweepPrune *sap = pd->lua->getArgObject(1, SAP_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+
+    if (!sweepPrune_isValidId(sap, id))
+        return 0;
+
+    sweepPrune_remove(sap, id);
+    return 0;
+}
+
+// sap:setFilter(id, category, mask, [group]), mask -1 for all categories
+static int lua_sap_setFilter(lua_State *L)
+{
+    SweepPrune *sap = pd->lua->getArgObject(1, SAP_TYPE_NAME, NULL);
+    int id = pd->lua->getArgInt(2) - 1;
+
+    if (!sweepPrune_isValidId(sap, id))
+        return 0;
+
+    CollisionFilter filter;
+    filter.category = (uint32_t)pd->lua->getArgInt(3);
+    filter.mask = (uint32_t)pd->lua->getArgInt(4);
+    filter.group = pd->lua->argIsNil(5) ? 0 : pd->lua->getArgInt(5);
+    sweepPrune_setFilter(sap, id, filter);
+    return 0;
+}
+
+static int lua_sap_clear(lua_State *L)
+{
+    SweepPrune *sap = pd->lua->getArgObject(1, SAP_TYPE_NAME, NULL);
+    sweepPrune_clear(sap);
+    return 0;
+}
+
+static int lua_sap_findPairs(lua_State *L)
+{
+    SweepPrune *sap = pd->lua->getArgObject(1, SAP_TYPE_NAME, NULL);
+
+    pd->lua->pushInt(sweepPrune_findPairs(sap));
+    return 1;
+}
+
+// returns ids of pair i (1-based) of the last findPairs call
+static int lua_sap_getPair(lua_State *L)
+{
+    SweepPrune *sap = pd->lua->getArgObject(1, SAP_TYPE_NAME, NULL);
+    int i = pd->lua->getArgInt(2) - 1;
+
+    if (i < 0 || i >= sap->pairCount)
+        return 0;
+
+    pd->lua->pushInt(sap->pairs[i].a + 1);
+    pd->lua->pushInt(sap->pairs[i].b + 1);
+    return 2;
+}
+
+static const lua_reg saplib[] =
+{
+    { "new",            lua_sap_new },
+    { "__gc",           lua_sap_free },
+    { "insertCircle",   lua_sap_insertCircle },
+    { "insertPoly",     lua_sap_insertPoly },
+    { "insertBox",      lua_sap_insertBox },
+    { "insertCapsule",  lua_sap_insertCapsule },
+    { "updateCircle",   lua_sap_updateCircle },
+    { "updatePoly",     lua_sap_updatePoly },
+    { "updateBox",      lua_sap_updateBox },
+    { "updateCapsule",  lua_sap_updateCapsule },
+    { "remove",         lua_sap_remove },
+    { "setFilter",      lua_sap_setFilter },
+    { "clear",          lua_sap_clear },
+    { "findPairs",      lua_sap_findPairs },
+    { "getPair",        lua_sap_getPair },
+    { NULL, NULL }
+};
+
+void registerSweepPrune(PlaydateAPI* playdate)
+{
+    pd = playdate;
+
+    const char* err;
+
+    if (!pd->lua->registerClass(SAP_TYPE_NAME, saplib, NULL, 0, &err))
+        pd->system->error("%s:%i: registerClass failed, %s", __FILE__, __LINE__, err);
+}
@@ -0,0 +1,65 @@
+#ifndef _SWEEPPRUNE_H
+#define _SWEEPPRUNE_H
+
+#include "pd_api.h"
+#include "aabb.h"
+#include "broadphase.h"
+
+#define SAP_TYPE_NAME "collision.sap"
+
+// Sweep and prune (sort and sweep) broadphase along the x axis.
+// Bodies are kept sorted by the left edge of their bounds between frames. Since
+// bodies usually move only a few pixels per frame the list stays almost sorted,
+// so re-sorting it with insertion sort before each sweep is close to O(n).
+
+typedef struct
+{
+    AABB bounds;
+    int id;
+    CollisionFilter filter;
+} SapEntry;
+
+typedef struct
+{
+    // sorted by bounds.minX after sweepPrune_findPairs
+    SapEntry *entries;
+    int entryCount;
+    int entryCapacity;
+
+    // index into entries for every id, -1 for removed ids
+    int *slots;
+    int slotCount;
+    int slotCapacity;
+    int *freeIds;
+    int freeIdCount;
+    int freeIdCapacity;
+
+    // result of the last sweepPrune_findPairs
+    CollisionPair *pairs;
+    int pairCount;
+    int pairCapacity;
+} SweepPrune;
+
+SweepPrune *sweepPrune_new(void);
+void sweepPrune_free(SweepPrune *sap);
+void sweepPrune_clear(SweepPrune *sap);
+
+// Returns id of the new body (>= 0)
+int sweepPrune_insert(SweepPrune *sap, AABB bounds);
+void sweepPrune_update(SweepPrune *sap, int id, AABB bounds);
+void sweepPrune_remove(SweepPrune *sap, int id);
+// Bodies start with COLLISION_FILTER_DEFAULT, see CollisionFilter
+void sweepPrune_setFilter(SweepPrune *sap, int id, CollisionFilter filter);
+
+// Fills sap->pairs with all pairs of bodies with overlapping bounds whose filters
+// let them collide. Every pair is reported exactly once. Returns the number of pairs.
+int sweepPrune_findPairs(SweepPrune *sap);
+
+// Calls callback for every body whose bounds the ray crosses (see RaycastCallback).
+// Only bodies starting left of the ray's right end are looked at.
+void sweepPrune_raycast(SweepPrune *sap, Vector2D origin, Vector2D dir, float maxT, RaycastCallback callback, void *userData);
+int sweepPrune_isValidId(SweepPrune *sap, int id);
+
+void registerSweepPrune(PlaydateAPI *playdate);
+
+#endif // _SWEEPPRUNE_H
@@ -0,0 +1,391 @@
+#include "trace.h"
+
+static PlaydateAPI* pd = NULL;
+
+// Records are collected here and written in blocks, writing every query would be slow on the device
+#define TRACE_BUFFER_SIZE 4096
+
+static SDFile *traceFile = NULL;
+static uint8_t buffer[TRACE_BUFFER_SIZE];
+static int bufferUsed = 0;
+static int recordCount = 0;
+
+// --- WRITING ---
+
+static void flush(void)
+{
+    if (bufferUsed > 0 && pd->file->write(traceFile, buffer, bufferUsed) < 0)
+        pd->system->logToConsole("%s:%i: writing the trace failed, %s", __FILE__, __LINE__, pd->file->geterr());
+    bufferUsed = 0;
+}
+
+// Both the device and the host are little endian, so values are copied as they are
+static void writeBytes(const void *data, int size)
+{
+    if (bufferUsed + size > TRACE_BUFFER_SIZE)
+        flush();
+    if (size > TRACE_BUFFER_SIZE)
+    {
+        pd->file->write(traceFile, data, size);
+        return;
+    }
+    memcpy(&buffer[bufferUsed], data, size);
+    bufferUsed += size;
+}
+
+static void writeU8(int value)
+{
+    uint8_t v = (uint8_t)value;
+    writeBytes(&v, 1);
+}
+
+static void writeU32(int value)
+{
+    uint32_t v = (uint32_t)value;
+    writeBytes(&v, sizeof(v));
+}
+
+static void writeFloat(float value)
+{
+    writeBytes(&value, sizeof(float));
+}
+
+static void writeVector(Vector2D v)
+{
+    writeFloat(v.x);
+    writeFloat(v.y);
+}
+
+static void writeCircle(Vector2D center, float radius)
+{
+    writeVector(center);
+    writeFloat(radius);
+}
+
+static void writeBox(AABB box)
+{
+    writeFloat(box.minX);
+    writeFloat(box.minY);
+    writeFloat(box.maxX);
+    writeFloat(box.maxY);
+}
+
+static void writeCapsule(Capsule capsule)
+{
+    writeVector(capsule.a);
+    writeVector(capsule.b);
+    writeFloat(capsule.radius);
+}
+
+static void writePoly(const Polygon *poly)
+{
+    uint16_t count = (uint16_t)poly->count;
+    writeBytes(&count, sizeof(count));
+    writeU8((poly->normals != NULL ? TRACE_POLY_NORMALS : 0) | (poly->transformed ? TRACE_POLY_TRANSFORMED : 0));
+    if (poly->transformed)
+    {
+        writeVector(poly->position);
+        writeFloat(poly->rotation);
+    }
+    writeBytes(poly->verts, sizeof(Vector2D) * count);
+}
+
+static void writeCircles(const float *x, const float *y, const float *r, int count)
+{
+    writeU32(count);
+    writeBytes(x, sizeof(float) * count);
+    writeBytes(y, sizeof(float) * count);
+    writeBytes(r, sizeof(float) * count);
+}
+
+static void writePolys(Polygon *const *polys, int count)
+{
+    writeU32(count);
+    for (int i = 0; i < count; ++i)
+        writePoly(polys[i]);
+}
+
+static void writePairs(const CollisionPair *pairs, int count)
+{
+    if (pairs == NULL)
+        return;
+    writeU32(count);
+    for (int i = 0; i < count; ++i)
+    {
+        writeU32(pairs[i].a);
+        writeU32(pairs[i].b);
+    }
+}
+
+static void writeResults(const CollisionResult *results, int count)
+{
+    writeU32(count);
+    for (int i = 0; i < count; ++i)
+    {
+        writeU32(results[i].a);
+        writeU32(results[i].b);
+        writeVector(results[i].resolveDir);
+        writeFloat(results[i].depth);
+    }
+}
+
+static void beginRecord(TraceOp op, int flags)
+{
+    writeU8(op);
+    writeU8(flags);
+    ++recordCount;
+}
+
+static void writeResolve(int flags, int hit, const Vector2D *resolveDir, const float *depth)
+{
+    writeU8(hit);
+    if (hit && !(flags & TRACE_FLAG_CHECK))
+    {
+        writeVector(*resolveDir);
+        writeFloat(*depth);
+    }
+}
+
+static void writeHit(int hit, float t, Vector2D normal, Vector2D point)
+{
+    writeU8(hit);
+    writeFloat(t);
+    writeVector(normal);
+    writeVector(point);
+}
+
+// --- RECORDING ---
+
+int trace_start(const char *path)
+{
+    if (traceFile != NULL)
+        trace_stop();
+
+    traceFile = pd->file->open(path, kFileWrite);
+    if (traceFile == NULL)
+    {
+        pd->system->logToConsole("%s:%i: cannot open trace file %s, %s", __FILE__, __LINE__, path, pd->file->geterr());
+        return 0;
+    }
+
+    bufferUsed = 0;
+    recordCount = 0;
+    uint32_t version = TRACE_VERSION;
+    writeBytes(TRACE_MAGIC, 8);
+    writeBytes(&version, sizeof(version));
+    return 1;
+}
+
+int trace_stop(void)
+{
+    if (traceFile == NULL)
+        return 0;
+
+    flush();
+    pd->file->close(traceFile);
+    traceFile = NULL;
+    return recordCount;
+}
+
+int trace_isRecording(void)
+{
+    return traceFile != NULL;
+}
+
+void trace_circleCircle(int flags, Vector2D centerA, float radiusA, Vector2D centerB, float radiusB, int hit, const Vector2D *resolveDir, const float *depth)
+{
+    beginRecord(TRACE_CIRCLE_CIRCLE, flags);
+    writeCircle(centerA, radiusA);
+    writeCircle(centerB, radiusB);
+    writeResolve(flags, hit, resolveDir, depth);
+}
+
+void trace_circlePoly(int flags, Vector2D center, float radius, const Polygon *poly, int hit, const Vector2D *resolveDir, const float *depth)
+{
+    beginRecord(TRACE_CIRCLE_POLY, flags);
+    writeCircle(center, radius);
+    writePoly(poly);
+    writeResolve(flags, hit, resolveDir, depth);
+}
+
+void trace_polyPoly(int flags, const Polygon *polyA, const Polygon *polyB, int hit, const Vector2D *resolveDir, const float *depth)
+{
+    beginRecord(TRACE_POLY_POLY, flags);
+    writePoly(polyA);
+    writePoly(polyB);
+    writeResolve(flags, hit, resolveDir, depth);
+}
+
+void trace_polyPolyManifold(const Polygon *polyA, const Polygon *polyB, int hit, const ContactManifold *manifold)
+{
+    beginRecord(TRACE_POLY_POLY_MANIFOLD, 0);
+    writePoly(polyA);
+    writePoly(polyB);
+    writeU8(hit);
+    if (!hit)
+        return;
+
+    writeVector(manifold->normal);
+    writeFloat(manifold->depth);
+    writeU8(manifold->pointCount);
+    for (int i = 0; i < manifold->pointCount; ++i)
+    {
+        writeVector(manifold->points[i]);
+        writeFloat(manifold->depths[i]);
+    }
+}
+
+void trace_circlePolySwept(Vector2D center, float radius, Vector2D move, const Polygon *poly, int hit, const SweepResult *result)
+{
+    beginRecord(TRACE_CIRCLE_POLY_SWEPT, 0);
+    writeCircle(center, radius);
+    writeVector(move);
+    writePoly(poly);
+    if (hit)
+        writeHit(hit, result->toi, result->normal, result->point);
+    else
+        writeU8(0);
+}
+
+void trace_polyPolySwept(const Polygon *polyA, Vector2D move, const Polygon *polyB, int hit, const SweepResult *result)
+{
+    beginRecord(TRACE_POLY_POLY_SWEPT, 0);
+    writePoly(polyA);
+    writeVector(move);
+    writePoly(polyB);
+    if (hit)
+        writeHit(hit, result->toi, result->normal, result->point);
+    else
+        writeU8(0);
+}
+
+void trace_aabbAABB(AABB boxA, AABB boxB, int hit, const Vector2D *resolveDir, const float *depth)
+{
+    beginRecord(TRACE_AABB_AABB, 0);
+    writeBox(boxA);
+    writeBox(boxB);
+    writeResolve(0, hit, resolveDir, depth);
+}
+
+void trace_aabbCircle(AABB box, Vector2D center, float radius, int hit, const Vector2D *resolveDir, const float *depth)
+{
+    beginRecord(TRACE_AABB_CIRCLE, 0);
+    writeBox(box);
+    writeCircle(center, radius);
+    writeResolve(0, hit, resolveDir, depth);
+}
+
+void trace_capsuleCircle(Capsule capsule, Vector2D center, float radius, int hit, const Vector2D *resolveDir, const float *depth)
+{
+    beginRecord(TRACE_CAPSULE_CIRCLE, 0);
+    writeCapsule(capsule);
+    writeCircle(center, radius);
+    writeResolve(0, hit, resolveDir, depth);
+}
+
+void trace_capsuleCapsule(Capsule capsuleA, Capsule capsuleB, int hit, const Vector2D *resolveDir, const float *depth)
+{
+    beginRecord(TRACE_CAPSULE_CAPSULE, 0);
+    writeCapsule(capsuleA);
+    writeCapsule(capsuleB);
+    writeResolve(0, hit, resolveDir, depth);
+}
+
+void trace_segmentPoly(Segment segment, const Polygon *poly, int hit, const Vector2D *resolveDir, const float *depth)
+{
+    beginRecord(TRACE_SEGMENT_POLY, 0);
+    writeVector(segment.a);
+    writeVector(segment.b);
+    writePoly(poly);
+    writeResolve(0, hit, resolveDir, depth);
+}
+
+void trace_rayCircle(Vector2D origin, Vector2D dir, float maxT, Vector2D center, float radius, int hit, const RayHit *result)
+{
+    beginRecord(TRACE_RAY_CIRCLE, 0);
+    writeVector(origin);
+    writeVector(dir);
+    writeFloat(maxT);
+    writeCircle(center, radius);
+    if (hit)
+        writeHit(hit, result->t, result->normal, result->point);
+    else
+        writeU8(0);
+}
+
+void trace_rayPoly(Vector2D origin, Vector2D dir, float maxT, const Polygon *poly, int hit, const RayHit *result)
+{
+    beginRecord(TRACE_RAY_POLY, 0);
+    writeVector(origin);
+    writeVector(dir);
+    writeFloat(maxT);
+    writePoly(poly);
+    if (hit)
+        writeHit(hit, result->t, result->normal, result->point);
+    else
+        writeU8(0);
+}
+
+void trace_circleCircleBatch(const float *x, const float *y, const float *r, int count, const CollisionPair *pairs, int pairCount, const CollisionResult *results, int resultCount)
+{
+    beginRecord(TRACE_BATCH_CIRCLE_CIRCLE, pairs != NULL ? TRACE_FLAG_PAIRS : 0);
+    writeCircles(x, y, r, count);
+    writePairs(pairs, pairCount);
+    writeResults(results, resultCount);
+}
+
+void trace_circlePolyBatch(int flags, const float *x, const float *y, const float *r, int circleCount, Polygon *const *polys, int polyCount, const CollisionResult *results, int resultCount)
+{
+    beginRecord(TRACE_BATCH_CIRCLE_POLY, flags);
+    writeCircles(x, y, r, circleCount);
+    writePolys(polys, polyCount);
+    writeResults(results, resultCount);
+}
+
+void trace_polyPolyBatch(int flags, Polygon *const *polys, int count, const CollisionPair *pairs, int pairCount, const CollisionResult *results, int resultCount)
+{
+    beginRecord(TRACE_BATCH_POLY_POLY, flags | (pairs != NULL ? TRACE_FLAG_PAIRS : 0));
+    writePolys(polys, count);
+    writePairs(pairs, pairCount);
+    writeResults(results, resultCount);
+}
+
+// --- LUA HOOKS ---
+
+// collision.trace.start(path) -> true if recording
+static int lua_trace_start(lua_State *L)
+{
+    pd->lua->pushBool(trace_start(pd->lua->getArgString(1)));
+    return 1;
+}
+
+// collision.trace.stop() -> number of recorded queries
+static int lua_trace_stop(lua_State *L)
+{
+    pd->lua->pushInt(trace_stop());
+    return 1;
+}
+
+static int lua_trace_isRecording(lua_State *L)
+{
+    pd->lua->pushBool(trace_isRecording());
+    return 1;
+}
+
+static const lua_reg tracelib[] =
+{
+    { "start",          lua_trace_start },
+    { "stop",           lua_trace_stop },
+    { "isRecording",    lua_trace_isRecording },
+    { NULL, NULL }
+};
+
+void registerTrace(PlaydateAPI* playdate)
+{
+    pd = playdate;
+
+    const char* err;
+
+    if (!pd->lua->registerClass(TRACE_TYPE_NAME, tracelib, NULL, 0, &err))
+        pd->system->error("%s:%i: registerClass failed, %s", __FILE__, __LINE__, err);
+}
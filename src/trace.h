@@ -0,0 +1,95 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include "pd_api.h"
+#include "vector2d.h"
+#include "polygon.h"
+#include "collision.h"
+
+#define TRACE_TYPE_NAME "collision.trace"
+
+// Query trace: while recording, the Lua collision hooks append every query (shapes,
+// arguments and result) to a binary file via pd->file. host/replay.c reads the file back,
+// runs the same queries through the C functions, times them and checks the results.
+// Batch calls are recorded as a whole, world:step as one query record per narrowphase pair.
+//
+// Format (little endian, floats as IEEE 754 single):
+//   header: "SATTRACE", u32 version
+//   record: u8 op (TraceOp), u8 flags (TRACE_FLAG_*), inputs, u8 hit, outputs if hit
+// Inputs per op, in the order of the arguments of the C function:
+//   circle: f32 x, y, radius        vector: f32 x, y        box (AABB): f32 minX, minY, maxX, maxY
+//   capsule: vector a, b, f32 radius     segment: vector a, b
+//   polygon: u16 count, u8 polyFlags (TRACE_POLY_*), [f32 x, y, rotation if transformed],
+//            count * vector (local vertices if transformed)
+// Outputs:
+//   resolve (not with TRACE_FLAG_CHECK): vector resolveDir, f32 depth
+//   sweep / ray: f32 toi or t, vector normal, vector point
+//   manifold: vector normal, f32 depth, u8 count, count * (vector point, f32 depth)
+// Batch records have no hit byte, their inputs and outputs are:
+//   circles: u32 count, count * f32 x, count * f32 y, count * f32 radius (as in CollisionBatch)
+//   polygons: u32 count, count * polygon
+//   pairs (only with TRACE_FLAG_PAIRS): u32 count, count * (u32 a, u32 b)
+//   results: u32 count, count * (u32 a, u32 b, vector resolveDir, f32 depth)
+// Version 1 traces are version 2 traces without batch records.
+#define TRACE_MAGIC "SATTRACE"
+#define TRACE_VERSION 2
+
+typedef enum
+{
+    TRACE_CIRCLE_CIRCLE = 1,    // circle, circle -> resolve
+    TRACE_CIRCLE_POLY,          // circle, polygon -> resolve
+    TRACE_POLY_POLY,            // polygon, polygon -> resolve
+    TRACE_POLY_POLY_MANIFOLD,   // polygon, polygon -> manifold
+    TRACE_CIRCLE_POLY_SWEPT,    // circle, vector move, polygon -> sweep
+    TRACE_POLY_POLY_SWEPT,      // polygon, vector move, polygon -> sweep
+    TRACE_AABB_AABB,            // box, box -> resolve
+    TRACE_AABB_CIRCLE,          // box, circle -> resolve
+    TRACE_CAPSULE_CIRCLE,       // capsule, circle -> resolve
+    TRACE_CAPSULE_CAPSULE,      // capsule, capsule -> resolve
+    TRACE_SEGMENT_POLY,         // segment, polygon -> resolve
+    TRACE_RAY_CIRCLE,           // vector origin, vector dir, f32 maxT, circle -> ray
+    TRACE_RAY_POLY,             // vector origin, vector dir, f32 maxT, polygon -> ray
+    TRACE_BATCH_CIRCLE_CIRCLE,  // circles, [pairs] -> results
+    TRACE_BATCH_CIRCLE_POLY,    // circles, polygons -> results
+    TRACE_BATCH_POLY_POLY,      // polygons, [pairs] -> results
+    TRACE_OP_COUNT
+} TraceOp;
+
+#define TRACE_FLAG_CHECK 1      // _check variant, only hit is recorded
+#define TRACE_FLAG_GJK 2        // GJK instead of SAT
+#define TRACE_FLAG_PAIRS 4      // batch call on the pairs of a broadphase instead of all pairs
+
+#define TRACE_POLY_NORMALS 1    // normals were cached
+#define TRACE_POLY_TRANSFORMED 2
+
+// Starts recording into path (data folder of the game), a running recording is stopped first.
+// Returns 0 if the file could not be opened.
+int trace_start(const char *path);
+// Writes the remaining records and closes the file, returns the number of recorded queries
+int trace_stop(void);
+int trace_isRecording(void);
+
+// Record one query each. Result pointers are only read if hit is set (and for resolve
+// results without TRACE_FLAG_CHECK), they may be NULL otherwise.
+void trace_circleCircle(int flags, Vector2D centerA, float radiusA, Vector2D centerB, float radiusB, int hit, const Vector2D *resolveDir, const float *depth);
+void trace_circlePoly(int flags, Vector2D center, float radius, const Polygon *poly, int hit, const Vector2D *resolveDir, const float *depth);
+void trace_polyPoly(int flags, const Polygon *polyA, const Polygon *polyB, int hit, const Vector2D *resolveDir, const float *depth);
+void trace_polyPolyManifold(const Polygon *polyA, const Polygon *polyB, int hit, const ContactManifold *manifold);
+void trace_circlePolySwept(Vector2D center, float radius, Vector2D move, const Polygon *poly, int hit, const SweepResult *result);
+void trace_polyPolySwept(const Polygon *polyA, Vector2D move, const Polygon *polyB, int hit, const SweepResult *result);
+void trace_aabbAABB(AABB boxA, AABB boxB, int hit, const Vector2D *resolveDir, const float *depth);
+void trace_aabbCircle(AABB box, Vector2D center, float radius, int hit, const Vector2D *resolveDir, const float *depth);
+void trace_capsuleCircle(Capsule capsule, Vector2D center, float radius, int hit, const Vector2D *resolveDir, const float *depth);
+void trace_capsuleCapsule(Capsule capsuleA, Capsule capsuleB, int hit, const Vector2D *resolveDir, const float *depth);
+void trace_segmentPoly(Segment segment, const Polygon *poly, int hit, const Vector2D *resolveDir, const float *depth);
+void trace_rayCircle(Vector2D origin, Vector2D dir, float maxT, Vector2D center, float radius, int hit, const RayHit *result);
+void trace_rayPoly(Vector2D origin, Vector2D dir, float maxT, const Polygon *poly, int hit, const RayHit *result);
+
+// Record one batch call each, pairs is NULL when all pairs were tested
+void trace_circleCircleBatch(const float *x, const float *y, const float *r, int count, const CollisionPair *pairs, int pairCount, const CollisionResult *results, int resultCount);
+void trace_circlePolyBatch(int flags, const float *x, const float *y, const float *r, int circleCount, Polygon *const *polys, int polyCount, const CollisionResult *results, int resultCount);
+void trace_polyPolyBatch(int flags, Polygon *const *polys, int count, const CollisionPair *pairs, int pairCount, const CollisionResult *results, int resultCount);
+
+void registerTrace(PlaydateAPI *playdate);
+
+#endif // _TRACE_H
@@ -0,0 +1,31 @@
+#ifndef _UTIL_H
+#define _UTIL_H
+
+#include <stddef.h>
+#include <float.h>
+
+#include "stats.h"
+
+// Small helpers shared by all modules
+
+#ifndef FLT_MAX
+#define FLT_MAX 3.402823466e+38F
+#endif
+
+// Grows array to hold at least needed elements (doubling), returns the (new) pointer.
+// reallocFn is pd->system->realloc of the calling module.
+static inline void *ensureCapacity(void *(*reallocFn)(void *ptr, size_t size), void *array, int *capacity, int needed, size_t elemSize)
+{
+    if (needed <= *capacity)
+        return array;
+
+    int newCapacity = *capacity > 0 ? *capacity : 16;
+    while (newCapacity < needed)
+        newCapacity *= 2;
+
+    *capacity = newCapacity;
+    STATS_COUNT(STAT_ALLOCS);
+    return reallocFn(array, elemSize * newCapacity);
+}
+
+#endif // _UTIL_H
@@ -1,15 +1,12 @@
 #include "vector2d.h"
+#include "stats.h"
 #include <stdio.h>
 
 static PlaydateAPI* pd = NULL;
 
-static inline float square(float v)
-{
-    return v * v;
-}
-
 void vector2D_normalize(Vector2D *v)
 {
+    STATS_COUNT(STAT_NORMALIZE);
     float len = vector2D_length(*v);
     if (len == 0)
         return;
@@ -18,50 +15,6 @@ void vector2D_normalize(Vector2D *v)
     v->y /= len;
 }
 
-// assuming coordinate space where y=0 is top-left and y=+ is bottom-left
-void vector2D_leftNormal(Vector2D *target, Vector2D src)
-{
-    target->x = src.y;
-    target->y = -src.x;
-}
-
-// assuming coordinate space where y=0 is top-left and y=+ is bottom-left
-void vector2D_rightNormal(Vector2D *target, Vector2D src)
-{
-    target->x = -src.y;
-    target->y = src.x;
-}
-
-void vector2D_dirNormalized(Vector2D *target, Vector2D pa, Vector2D pb)
-{
-    float len = sqrtf(square(pa.x - pb.x) + square(pa.y - pb.y));
-    if (len == 0)
-        len = 1.0f;
-    target->x = (pa.x - pb.x) / len;
-    target->y = (pa.y - pb.y) / len;
-}
-
-void vector2D_addVecScaled(Vector2D *v, Vector2D other, float otherScale)
-{
-    v->x += other.x * otherScale;
-    v->y += other.y * otherScale;
-}
-
-float vector2D_length(Vector2D v)
-{
-    return sqrtf(v.x * v.x + v.y * v.y);
-}
-
-float vector2D_lengthSquared(Vector2D v)
-{
-    return v.x * v.x + v.y * v.y;
-}
-
-float vector2D_dotProduct(Vector2D a, Vector2D b)
-{
-    return a.x * b.x + a.y * b.y;
-}
-
 size_t vector2D_print(char* dest, size_t len, Vector2D v)
 {
     //int bytesWritten = snprintf(dest, len, "(%.2f, %.2f)", v.x, v.y);
@@ -78,6 +31,7 @@ size_t vector2D_print(char* dest, size_t len, Vector2D v)
 static int lua_vector2d_new(lua_State *L)
 {
     Vector2D* v = pd->system->realloc(NULL, sizeof(Vector2D));
+    STATS_COUNT(STAT_ALLOCS);
 
     if (pd->lua->getArgCount() == 1)
     {
@@ -2,6 +2,7 @@
 #define _vector2d_H
 
 #include "pd_api.h"
+#include <math.h>
 
 #define VECTOR_TYPE_NAME "collision.vector2D"
 
@@ -12,15 +13,56 @@ typedef struct
 } Vector2D;
 
 void vector2D_normalize(Vector2D *v);
-void vector2D_leftNormal(Vector2D *target, Vector2D src);
-void vector2D_rightNormal(Vector2D *target, Vector2D src);
-void vector2D_dirNormalized(Vector2D *v, Vector2D pa, Vector2D pb);
-void vector2D_addVecScaled(Vector2D *v, Vector2D other, float otherScale);
 size_t vector2D_print(char* dest, size_t len, Vector2D v);
 
-float vector2D_length(Vector2D v);
-float vector2D_lengthSquared(Vector2D v);
-float vector2D_dotProduct(Vector2D a, Vector2D b);
+// The small helpers below are used in the innermost collision loops of other translation
+// units, so they are inline instead of a call each
+
+// assuming coordinate space where y=0 is top-left and y=+ is bottom-left
+static inline void vector2D_leftNormal(Vector2D *target, Vector2D src)
+{
+    target->x = src.y;
+    target->y = -src.x;
+}
+
+// assuming coordinate space where y=0 is top-left and y=+ is bottom-left
+static inline void vector2D_rightNormal(Vector2D *target, Vector2D src)
+{
+    target->x = -src.y;
+    target->y = src.x;
+}
+
+static inline void vector2D_dirNormalized(Vector2D *target, Vector2D pa, Vector2D pb)
+{
+    float dx = pa.x - pb.x;
+    float dy = pa.y - pb.y;
+    float len = sqrtf(dx * dx + dy * dy);
+    if (len == 0)
+        len = 1.0f;
+    target->x = dx / len;
+    target->y = dy / len;
+}
+
+static inline void vector2D_addVecScaled(Vector2D *v, Vector2D other, float otherScale)
+{
+    v->x += other.x * otherScale;
+    v->y += other.y * otherScale;
+}
+
+static inline float vector2D_length(Vector2D v)
+{
+    return sqrtf(v.x * v.x + v.y * v.y);
+}
+
+static inline float vector2D_lengthSquared(Vector2D v)
+{
+    return v.x * v.x + v.y * v.y;
+}
+
+static inline float vector2D_dotProduct(Vector2D a, Vector2D b)
+{
+    return a.x * b.x + a.y * b.y;
+}
 
 void registerVector2D(PlaydateAPI *playdate);
 
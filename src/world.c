@@ -0,0 +1,834 @@
+#include "world.h"
+#include "gjk.h"
+#include "stats.h"
+#include "util.h"
+#include "trace.h"
+
+static PlaydateAPI* pd = NULL;
+
+// -- HELPER ---
+
+static AABB bodyBox(const Body *body)
+{
+    AABB box = {
+        .minX = body->center->x - body->extent.x,
+        .minY = body->center->y - body->extent.y,
+        .maxX = body->center->x + body->extent.x,
+        .maxY = body->center->y + body->extent.y
+    };
+    return box;
+}
+
+static Capsule bodyCapsule(const Body *body)
+{
+    Capsule capsule = {
+        .a = { .x = body->center->x - body->extent.x, .y = body->center->y - body->extent.y },
+        .b = { .x = body->center->x + body->extent.x, .y = body->center->y + body->extent.y },
+        .radius = body->radius
+    };
+    return capsule;
+}
+
+static void bodyBounds(AABB *target, const Body *body)
+{
+    switch (body->shape)
+    {
+        case BODY_CIRCLE:
+            aabb_fromCircle(target, *body->center, body->radius);
+            break;
+        case BODY_POLY:
+            *target = body->poly->bounds;
+            break;
+        case BODY_BOX:
+            *target = bodyBox(body);
+            break;
+        case BODY_CAPSULE:
+        {
+            Capsule capsule = bodyCapsule(body);
+            aabb_fromCapsule(target, capsule.a, capsule.b, capsule.radius);
+            break;
+        }
+    }
+}
+
+// Circles that moved further than their radius are swept (Manhattan distance, cheap and
+// errs on the side of sweeping)
+static inline int isFast(const Body *body)
+{
+    return body->shape == BODY_CIRCLE && fabsf(body->moved.x) + fabsf(body->moved.y) > body->radius;
+}
+
+static void moveBody(Body *body, Vector2D offset)
+{
+    if (body->shape == BODY_POLY)
+        polygon_translate(body->poly, offset);
+    else
+        vector2D_addVecScaled(body->center, offset, 1.0f);
+}
+
+static void releaseBody(Body *body)
+{
+    if (body->ref != NULL)
+        pd->lua->releaseObject(body->ref);
+    body->ref = NULL;
+}
+
+static int addBody(World *world, Body body, float mass)
+{
+    body.invMass = mass > 0 ? 1.0f / mass : 0.0f;
+
+    AABB bounds;
+    bodyBounds(&bounds, &body);
+    body.proxy = spatialGrid_insert(world->grid, bounds);
+
+    world->proxyBodies = ensureCapacity(pd->system->realloc, world->proxyBodies, &world->proxyBodyCapacity, body.proxy + 1, sizeof(int));
+    world->proxyBodies[body.proxy] = world->bodyCount;
+
+    world->bodies = ensureCapacity(pd->system->realloc, world->bodies, &world->bodyCapacity, world->bodyCount + 1, sizeof(Body));
+    world->bodies[world->bodyCount] = body;
+    return world->bodyCount++;
+}
+
+// --- STEP ---
+
+void world_integrate(World *world, float dt)
+{
+    Vector2D gravityStep = { .x = world->gravity.x * dt, .y = world->gravity.y * dt };
+
+    for (int i = 0; i < world->bodyCount; ++i)
+    {
+        Body *body = &world->bodies[i];
+        body->moved.x = 0.0f;
+        body->moved.y = 0.0f;
+        if (body->shape == BODY_POLY)
+            polygon_updateCache(body->poly);
+        if (body->invMass == 0)
+            continue;
+
+        body->velocity.x += gravityStep.x;
+        body->velocity.y += gravityStep.y;
+
+        if (world->hasBounds)
+        {
+            AABB b;
+            bodyBounds(&b, body);
+            if ((b.minX < world->bounds.minX && body->velocity.x < 0) || (b.maxX > world->bounds.maxX && body->velocity.x > 0))
+                body->velocity.x *= -body->restitution;
+            if ((b.minY < world->bounds.minY && body->velocity.y < 0) || (b.maxY > world->bounds.maxY && body->velocity.y > 0))
+                body->velocity.y *= -body->restitution;
+        }
+
+        Vector2D offset = { .x = body->velocity.x * dt, .y = body->velocity.y * dt };
+        moveBody(body, offset);
+        body->moved = offset;
+    }
+}
+
+int world_findPairs(World *world)
+{
+    AABB bounds;
+    for (int i = 0; i < world->bodyCount; ++i)
+    {
+        Body *body = &world->bodies[i];
+        // fast circles cover their whole movement, so the swept test finds the walls in between
+        if (isFast(body))
+        {
+            Vector2D start = { .x = body->center->x - body->moved.x, .y = body->center->y - body->moved.y };
+            aabb_fromCapsule(&bounds, start, *body->center, body->radius);
+        }
+        else
+        {
+            bodyBounds(&bounds, body);
+        }
+        spatialGrid_update(world->grid, body->proxy, bounds);
+    }
+    return spatialGrid_findPairs(world->grid);
+}
+
+// points holds the corners of boxes and the ends of capsules
+static void bodySupport(SupportShape *shape, Vector2D *points, const Body *body)
+{
+    switch (body->shape)
+    {
+        case BODY_CIRCLE:
+            supportShape_fromCircle(shape, *body->center, body->radius);
+            break;
+        case BODY_POLY:
+            supportShape_fromPoly(shape, *body->poly);
+            break;
+        case BODY_BOX:
+        {
+            AABB box = bodyBox(body);
+            points[0].x = box.minX;
+            points[0].y = box.minY;
+            points[1].x = box.maxX;
+            points[1].y = box.minY;
+            points[2].x = box.maxX;
+            points[2].y = box.maxY;
+            points[3].x = box.minX;
+            points[3].y = box.maxY;
+            supportShape_fromPoints(shape, points, 4, 0);
+            break;
+        }
+        case BODY_CAPSULE:
+        {
+            Capsule capsule = bodyCapsule(body);
+            points[0] = capsule.a;
+            points[1] = capsule.b;
+            supportShape_fromPoints(shape, points, 2, capsule.radius);
+            break;
+        }
+    }
+}
+
+// The kernels below take the shapes the other way around
+static inline int flipped(int collides, Vector2D *resolveDir)
+{
+    resolveDir->x = -resolveDir->x;
+    resolveDir->y = -resolveDir->y;
+    return collides;
+}
+
+// Narrowphase of one pair, resolveDir points from a to b. a->shape <= b->shape.
+// Pairs without a closed form function use GJK.
+static int collideBodies(World *world, Vector2D *resolveDir, float *depth, const Body *a, const Body *b)
+{
+    int gjk = world->method == COLLISION_GJK;
+    if (a->shape == BODY_CIRCLE)
+    {
+        switch (b->shape)
+        {
+            case BODY_CIRCLE:
+                return collision_circleCircle(resolveDir, depth, *a->center, a->radius, *b->center, b->radius);
+            case BODY_POLY:
+                if (gjk)
+                    return collision_circlePoly_gjk(resolveDir, depth, *a->center, a->radius, *b->poly);
+                return collision_circlePoly(resolveDir, depth, *a->center, a->radius, *b->poly);
+            case BODY_BOX:
+                return flipped(collision_aabbCircle(resolveDir, depth, bodyBox(b), *a->center, a->radius), resolveDir);
+            case BODY_CAPSULE:
+                return flipped(collision_capsuleCircle(resolveDir, depth, bodyCapsule(b), *a->center, a->radius), resolveDir);
+        }
+    }
+    if (a->shape == BODY_POLY && b->shape == BODY_POLY)
+    {
+        if (gjk)
+            return collision_polyPoly_gjk(resolveDir, depth, *a->poly, *b->poly);
+        return collision_polyPoly(resolveDir, depth, *a->poly, *b->poly);
+    }
+    if (a->shape == BODY_POLY && b->shape == BODY_CAPSULE && b->radius == 0)
+    {
+        Capsule capsule = bodyCapsule(b);
+        Segment segment = { .a = capsule.a, .b = capsule.b };
+        return flipped(collision_segmentPoly(resolveDir, depth, segment, *a->poly), resolveDir);
+    }
+    if (a->shape == BODY_BOX && b->shape == BODY_BOX)
+        return collision_aabbAABB(resolveDir, depth, bodyBox(a), bodyBox(b));
+    if (a->shape == BODY_CAPSULE && b->shape == BODY_CAPSULE)
+        return collision_capsuleCapsule(resolveDir, depth, bodyCapsule(a), bodyCapsule(b));
+
+    SupportShape shapeA, shapeB;
+    Vector2D pointsA[4], pointsB[4];
+    bodySupport(&shapeA, pointsA, a);
+    bodySupport(&shapeB, pointsB, b);
+    return gjk_collide(resolveDir, depth, shapeA, shapeB);
+}
+
+// Records the query of collideBodies in the argument order of the C function, so world:step
+// shows up in the trace. Pairs that fall back to GJK on support shapes are not recorded.
+static void traceBodies(World *world, const Body *a, const Body *b, int collides, const Vector2D *resolveDir, const float *depth)
+{
+    int flags = world->method == COLLISION_GJK ? TRACE_FLAG_GJK : 0;
+    // the flipped kernels returned the direction from b to a
+    Vector2D flippedDir = { 0, 0 };
+    if (collides)
+    {
+        flippedDir.x = -resolveDir->x;
+        flippedDir.y = -resolveDir->y;
+    }
+
+    if (a->shape == BODY_CIRCLE && b->shape == BODY_CIRCLE)
+        trace_circleCircle(0, *a->center, a->radius, *b->center, b->radius, collides, resolveDir, depth);
+    else if (a->shape == BODY_CIRCLE && b->shape == BODY_POLY)
+        trace_circlePoly(flags, *a->center, a->radius, b->poly, collides, resolveDir, depth);
+    else if (a->shape == BODY_CIRCLE && b->shape == BODY_BOX)
+        trace_aabbCircle(bodyBox(b), *a->center, a->radius, collides, &flippedDir, depth);
+    else if (a->shape == BODY_CIRCLE && b->shape == BODY_CAPSULE)
+        trace_capsuleCircle(bodyCapsule(b), *a->center, a->radius, collides, &flippedDir, depth);
+    else if (a->shape == BODY_POLY && b->shape == BODY_POLY)
+        trace_polyPoly(flags, a->poly, b->poly, collides, resolveDir, depth);
+    else if (a->shape == BODY_POLY && b->shape == BODY_CAPSULE && b->radius == 0)
+    {
+        Capsule capsule = bodyCapsule(b);
+        Segment segment = { .a = capsule.a, .b = capsule.b };
+        trace_segmentPoly(segment, a->poly, collides, &flippedDir, depth);
+    }
+    else if (a->shape == BODY_BOX && b->shape == BODY_BOX)
+        trace_aabbAABB(bodyBox(a), bodyBox(b), collides, resolveDir, depth);
+    else if (a->shape == BODY_CAPSULE && b->shape == BODY_CAPSULE)
+        trace_capsuleCapsule(bodyCapsule(a), bodyCapsule(b), collides, resolveDir, depth);
+}
+
+// Pushes the bodies apart (split by inverse mass) and exchanges the impulse along the normal
+static void resolve(Body *a, Body *b, Vector2D normal, float depth)
+{
+    float invMassSum = a->invMass + b->invMass;
+    float shareA = a->invMass / invMassSum;
+    float shareB = b->invMass / invMassSum;
+
+    Vector2D offset = { .x = -normal.x * depth * shareA, .y = -normal.y * depth * shareA };
+    if (shareA > 0)
+        moveBody(a, offset);
+    offset.x = normal.x * depth * shareB;
+    offset.y = normal.y * depth * shareB;
+    if (shareB > 0)
+        moveBody(b, offset);
+
+    Vector2D relVel = { .x = b->velocity.x - a->velocity.x, .y = b->velocity.y - a->velocity.y };
+    float relSpeed = vector2D_dotProduct(relVel, normal);
+    // already separating
+    if (relSpeed >= 0)
+        return;
+
+    float restitution = fminf(a->restitution, b->restitution);
+    float impulse = -(1.0f + restitution) * relSpeed / invMassSum;
+    vector2D_addVecScaled(&a->velocity, normal, -impulse * a->invMass);
+    vector2D_addVecScaled(&b->velocity, normal, impulse * b->invMass);
+}
+
+// Stops a fast circle where its movement first touches a static polygon and reflects its
+// velocity. Returns 0 if the movement misses the polygon or the circle already overlapped it
+// at the start, the regular collision function takes over then.
+static int collideSwept(Vector2D *normal, Body *circle, const Body *wall)
+{
+    SweepResult sweep;
+    Vector2D start = { .x = circle->center->x - circle->moved.x, .y = circle->center->y - circle->moved.y };
+    int hit = collision_circlePoly_swept(&sweep, start, circle->radius, circle->moved, *wall->poly);
+    if (trace_isRecording())
+        trace_circlePolySwept(start, circle->radius, circle->moved, wall->poly, hit, &sweep);
+    if (!hit || sweep.toi <= 0)
+        return 0;
+
+    Vector2D offset = { .x = -circle->moved.x * (1.0f - sweep.toi), .y = -circle->moved.y * (1.0f - sweep.toi) };
+    moveBody(circle, offset);
+    circle->moved.x *= sweep.toi;
+    circle->moved.y *= sweep.toi;
+
+    float speed = vector2D_dotProduct(circle->velocity, sweep.normal);
+    if (speed > 0)
+        vector2D_addVecScaled(&circle->velocity, sweep.normal, -(1.0f + fminf(circle->restitution, wall->restitution)) * speed);
+    *normal = sweep.normal;
+    return 1;
+}
+
+int world_collide(World *world, int pairCount)
+{
+    STATS_TIMER_START(TIMER_NARROWPHASE);
+    world->contactCount = 0;
+    Vector2D resolveDir;
+    float depth;
+    for (int iteration = 0; iteration < world->iterations; ++iteration)
+    {
+        for (int p = 0; p < pairCount; ++p)
+        {
+            int indexA = world->proxyBodies[world->grid->pairs[p].a];
+            int indexB = world->proxyBodies[world->grid->pairs[p].b];
+            if (world->bodies[indexA].shape > world->bodies[indexB].shape)
+            {
+                int tmp = indexA;
+                indexA = indexB;
+                indexB = tmp;
+            }
+
+            Body *a = &world->bodies[indexA];
+            Body *b = &world->bodies[indexB];
+            if (a->invMass == 0 && b->invMass == 0)
+                continue;
+
+            // the sweep already stops the circle at the wall
+            if (iteration == 0 && b->shape == BODY_POLY && b->invMass == 0 && isFast(a) && collideSwept(&resolveDir, a, b))
+            {
+                depth = 0.0f;
+            }
+            else
+            {
+                int collides = collideBodies(world, &resolveDir, &depth, a, b);
+                if (trace_isRecording())
+                    traceBodies(world, a, b, collides, &resolveDir, &depth);
+                if (!collides)
+                    continue;
+                resolve(a, b, resolveDir, depth);
+            }
+
+            // report the collisions found in the first iteration, later ones only refine those
+            if (iteration > 0)
+                continue;
+            world->contacts = ensureCapacity(pd->system->realloc, world->contacts, &world->contactCapacity, world->contactCount + 1, sizeof(CollisionResult));
+            CollisionResult *contact = &world->contacts[world->contactCount++];
+            contact->a = indexA;
+            contact->b = indexB;
+            contact->resolveDir = resolveDir;
+            contact->depth = depth;
+        }
+    }
+
+    STATS_TIMER_STOP(TIMER_NARROWPHASE);
+    return world->contactCount;
+}
+
+int world_step(World *world, float dt)
+{
+    STATS_TIMER_START(TIMER_WORLD_STEP);
+    world_integrate(world, dt);
+    int contactCount = world_collide(world, world_findPairs(world));
+    STATS_TIMER_STOP(TIMER_WORLD_STEP);
+    return contactCount;
+}
+
+// --- WORLD ---
+
+World *world_new(float cellSize)
+{
+    World *world = pd->system->realloc(NULL, sizeof(World));
+    memset(world, 0, sizeof(World));
+    world->grid = spatialGrid_new(cellSize);
+    world->iterations = 1;
+    world->method = COLLISION_SAT;
+    return world;
+}
+
+void world_free(World *world)
+{
+    world_clear(world);
+    spatialGrid_free(world->grid);
+    pd->system->realloc(world->bodies, 0);
+    pd->system->realloc(world->proxyBodies, 0);
+    pd->system->realloc(world->contacts, 0);
+    pd->system->realloc(world->packed, 0);
+    pd->system->realloc(world, 0);
+}
+
+void world_clear(World *world)
+{
+    for (int i = 0; i < world->bodyCount; ++i)
+        releaseBody(&world->bodies[i]);
+    world->bodyCount = 0;
+    world->contactCount = 0;
+    spatialGrid_clear(world->grid);
+}
+
+int world_addCircle(World *world, Vector2D *center, float radius, float mass, float restitution)
+{
+    Body body = { .shape = BODY_CIRCLE, .center = center, .radius = radius, .restitution = restitution };
+    return addBody(world, body, mass);
+}
+
+int world_addPoly(World *world, Polygon *poly, float mass, float restitution)
+{
+    polygon_updateCache(poly);
+    Body body = { .shape = BODY_POLY, .poly = poly, .restitution = restitution };
+    return addBody(world, body, mass);
+}
+
+int world_addBox(World *world, Vector2D *center, float width, float height, float mass, float restitution)
+{
+    Body body = { .shape = BODY_BOX, .center = center, .restitution = restitution };
+    body.extent.x = width / 2;
+    body.extent.y = height / 2;
+    return addBody(world, body, mass);
+}
+
+int world_addCapsule(World *world, Vector2D *center, Vector2D halfAxis, float radius, float mass, float restitution)
+{
+    Body body = { .shape = BODY_CAPSULE, .center = center, .extent = halfAxis, .radius = radius, .restitution = restitution };
+    return addBody(world, body, mass);
+}
+
+void world_remove(World *world, int index)
+{
+    Body *body = &world->bodies[index];
+    releaseBody(body);
+    spatialGrid_remove(world->grid, body->proxy);
+
+    --world->bodyCount;
+    if (index < world->bodyCount)
+    {
+        *body = world->bodies[world->bodyCount];
+        world->proxyBodies[body->proxy] = index;
+    }
+    // contacts refer to the old indices
+    world->contactCount = 0;
+}
+
+void world_setFilter(World *world, int index, CollisionFilter filter)
+{
+    spatialGrid_setFilter(world->grid, world->bodies[index].proxy, filter);
+}
+
+// --- LUA HOOKS ---
+
+// collision.world.new([cellSize]), cellSize of the broadphase grid, about the size of a typical body
+static int lua_world_new(lua_State *L)
+{
+    float cellSize = WORLD_DEFAULT_CELL_SIZE;
+    if (!pd->lua->argIsNil(1))
+        cellSize = pd->lua->getArgFloat(1);
+    if (cellSize <= 0)
+    {
+        pd->system->error("%s:%i: world cell size must be > 0", __FILE__, __LINE__);
+        return 0;
+    }
+
+    World *world = world_new(cellSize);
+    pd->lua->pushObject(world, WORLD_TYPE_NAME, 0);
+    return 1;
+}
+
+static int lua_world_free(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    world_free(world);
+    return 0;
+}
+
+// Optional velocity at pos, pos + 1
+static void setVelocityArgs(World *world, int index, int pos)
+{
+    if (pd->lua->argIsNil(pos))
+        return;
+
+    world->bodies[index].velocity.x = pd->lua->getArgFloat(pos);
+    world->bodies[index].velocity.y = pd->lua->getArgFloat(pos + 1);
+}
+
+// Lua indices are 1-based
+// world:addCircle(center, radius, mass, restitution, [vx, vy]) -> index
+// center is a collision.vector2D the world keeps a reference to and moves on every step
+static int lua_world_addCircle(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    LuaUDObject *ref = NULL;
+    Vector2D *center = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, &ref);
+    float radius = pd->lua->getArgFloat(3);
+    float mass = pd->lua->getArgFloat(4);
+    float restitution = pd->lua->getArgFloat(5);
+
+    if (center == NULL)
+        return 0;
+
+    int index = world_addCircle(world, center, radius, mass, restitution);
+    world->bodies[index].ref = pd->lua->retainObject(ref);
+    setVelocityArgs(world, index, 6);
+
+    pd->lua->pushInt(index + 1);
+    return 1;
+}
+
+// world:addPoly(poly, mass, restitution, [vx, vy]) -> index, the world keeps a reference to poly and moves it
+static int lua_world_addPoly(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    LuaUDObject *ref = NULL;
+    Polygon *poly = pd->lua->getArgObject(2, POLY_TYPE_NAME, &ref);
+    float mass = pd->lua->getArgFloat(3);
+    float restitution = pd->lua->getArgFloat(4);
+
+    if (poly == NULL)
+        return 0;
+
+    int index = world_addPoly(world, poly, mass, restitution);
+    world->bodies[index].ref = pd->lua->retainObject(ref);
+    setVelocityArgs(world, index, 5);
+
+    pd->lua->pushInt(index + 1);
+    return 1;
+}
+
+// world:addBox(center, width, height, mass, restitution, [vx, vy]) -> index, box around the vector2D center
+static int lua_world_addBox(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    LuaUDObject *ref = NULL;
+    Vector2D *center = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, &ref);
+    float width = pd->lua->getArgFloat(3);
+    float height = pd->lua->getArgFloat(4);
+    float mass = pd->lua->getArgFloat(5);
+    float restitution = pd->lua->getArgFloat(6);
+
+    if (center == NULL)
+        return 0;
+
+    int index = world_addBox(world, center, width, height, mass, restitution);
+    world->bodies[index].ref = pd->lua->retainObject(ref);
+    setVelocityArgs(world, index, 7);
+
+    pd->lua->pushInt(index + 1);
+    return 1;
+}
+
+// world:addCapsule(center, dx, dy, radius, mass, restitution, [vx, vy]) -> index
+// Capsule from center - (dx, dy) to center + (dx, dy), radius 0 for a segment
+static int lua_world_addCapsule(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    LuaUDObject *ref = NULL;
+    Vector2D *center = pd->lua->getArgObject(2, VECTOR_TYPE_NAME, &ref);
+    Vector2D halfAxis = { .x = pd->lua->getArgFloat(3), .y = pd->lua->getArgFloat(4) };
+    float radius = pd->lua->getArgFloat(5);
+    float mass = pd->lua->getArgFloat(6);
+    float restitution = pd->lua->getArgFloat(7);
+
+    if (center == NULL)
+        return 0;
+
+    int index = world_addCapsule(world, center, halfAxis, radius, mass, restitution);
+    world->bodies[index].ref = pd->lua->retainObject(ref);
+    setVelocityArgs(world, index, 8);
+
+    pd->lua->pushInt(index + 1);
+    return 1;
+}
+
+// world:remove(i), the last body takes over index i
+static int lua_world_remove(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    int i = pd->lua->getArgInt(2) - 1;
+
+    if (i < 0 || i >= world->bodyCount)
+        return 0;
+
+    world_remove(world, i);
+    return 0;
+}
+
+static int lua_world_clear(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    world_clear(world);
+    return 0;
+}
+
+static int lua_world_getBodyCount(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    pd->lua->pushInt(world->bodyCount);
+    return 1;
+}
+
+static int lua_world_setGravity(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    world->gravity.x = pd->lua->getArgFloat(2);
+    world->gravity.y = pd->lua->getArgFloat(3);
+    return 0;
+}
+
+// world:setBounds(x, y, width, height), bodies bounce off its walls. Without arguments removes the bounds.
+static int lua_world_setBounds(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+
+    world->hasBounds = !pd->lua->argIsNil(2);
+    if (!world->hasBounds)
+        return 0;
+
+    world->bounds.minX = pd->lua->getArgFloat(2);
+    world->bounds.minY = pd->lua->getArgFloat(3);
+    world->bounds.maxX = world->bounds.minX + pd->lua->getArgFloat(4);
+    world->bounds.maxY = world->bounds.minY + pd->lua->getArgFloat(5);
+    return 0;
+}
+
+// world:setIterations(n), how often the collisions are resolved per step (default 1)
+static int lua_world_setIterations(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    int iterations = pd->lua->getArgInt(2);
+    world->iterations = iterations > 0 ? iterations : 1;
+    return 0;
+}
+
+// world:setMethod("sat" or "gjk"), narrowphase used for polygons
+static int lua_world_setMethod(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    world->method = collision_getMethodArg(2);
+    return 0;
+}
+
+// world:step(dt) -> number of collisions
+// Circle centers and polygons added to the world are updated in place, so after this call
+// they can be drawn directly without reading anything back.
+static int lua_world_step(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    float dt = pd->lua->getArgFloat(2);
+
+    pd->lua->pushInt(world_step(world, dt));
+    return 1;
+}
+
+// world:getBody(i) -> x, y, vx, vy (x, y is the center of the body, the centroid for polygons)
+static int lua_world_getBody(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    int i = pd->lua->getArgInt(2) - 1;
+
+    if (i < 0 || i >= world->bodyCount)
+        return 0;
+
+    Body *body = &world->bodies[i];
+    Vector2D position;
+    if (body->shape == BODY_POLY)
+    {
+        polygon_updateCache(body->poly);
+        position = body->poly->centroid;
+    }
+    else
+    {
+        position = *body->center;
+    }
+
+    pd->lua->pushFloat(position.x);
+    pd->lua->pushFloat(position.y);
+    pd->lua->pushFloat(body->velocity.x);
+    pd->lua->pushFloat(body->velocity.y);
+    return 4;
+}
+
+static int lua_world_setVelocity(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    int i = pd->lua->getArgInt(2) - 1;
+
+    if (i < 0 || i >= world->bodyCount)
+        return 0;
+
+    setVelocityArgs(world, i, 3);
+    return 0;
+}
+
+// world:setFilter(i, category, mask, [group]), mask -1 for all categories
+static int lua_world_setFilter(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    int i = pd->lua->getArgInt(2) - 1;
+
+    if (i < 0 || i >= world->bodyCount)
+        return 0;
+
+    CollisionFilter filter;
+    filter.category = (uint32_t)pd->lua->getArgInt(3);
+    filter.mask = (uint32_t)pd->lua->getArgInt(4);
+    filter.group = pd->lua->argIsNil(5) ? 0 : pd->lua->getArgInt(5);
+    world_setFilter(world, i, filter);
+    return 0;
+}
+
+// world:getContact(i) -> a, b, resolveX, resolveY, depth of collision i (1-based) of the last step
+static int lua_world_getContact(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+    int i = pd->lua->getArgInt(2) - 1;
+
+    if (i < 0 || i >= world->contactCount)
+        return 0;
+
+    CollisionResult *contact = &world->contacts[i];
+    pd->lua->pushInt(contact->a + 1);
+    pd->lua->pushInt(contact->b + 1);
+    pd->lua->pushFloat(contact->resolveDir.x);
+    pd->lua->pushFloat(contact->resolveDir.y);
+    pd->lua->pushFloat(contact->depth);
+    return 5;
+}
+
+// The pack functions return one string instead of pushing a value per field, the Lua stack
+// of a C function only has room for a few values. Read it with string.unpack (native sizes).
+
+// Record of world:packContacts, string.unpack("i4i4fff", s, pos)
+typedef struct
+{
+    int32_t a;
+    int32_t b;
+    float resolveX;
+    float resolveY;
+    float depth;
+} PackedContact;
+
+// world:packVelocities() -> string of vx, vy of all bodies, string.unpack("ff", s, pos)
+static int lua_world_packVelocities(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+
+    size_t size = sizeof(float) * 2 * world->bodyCount;
+    world->packed = ensureCapacity(pd->system->realloc, world->packed, &world->packedCapacity, (int)size, 1);
+    float *velocities = (float *)world->packed;
+    for (int i = 0; i < world->bodyCount; ++i)
+    {
+        velocities[i * 2] = world->bodies[i].velocity.x;
+        velocities[i * 2 + 1] = world->bodies[i].velocity.y;
+    }
+
+    pd->lua->pushBytes(world->packed, size);
+    return 1;
+}
+
+// world:packContacts() -> string of the collisions of the last step as a, b, resolveX, resolveY,
+// depth records, string.unpack("i4i4fff", s, pos)
+static int lua_world_packContacts(lua_State *L)
+{
+    World *world = pd->lua->getArgObject(1, WORLD_TYPE_NAME, NULL);
+
+    size_t size = sizeof(PackedContact) * world->contactCount;
+    world->packed = ensureCapacity(pd->system->realloc, world->packed, &world->packedCapacity, (int)size, 1);
+    PackedContact *packed = (PackedContact *)world->packed;
+    for (int i = 0; i < world->contactCount; ++i)
+    {
+        CollisionResult *contact = &world->contacts[i];
+        packed[i].a = contact->a + 1;
+        packed[i].b = contact->b + 1;
+        packed[i].resolveX = contact->resolveDir.x;
+        packed[i].resolveY = contact->resolveDir.y;
+        packed[i].depth = contact->depth;
+    }
+
+    pd->lua->pushBytes(world->packed, size);
+    return 1;
+}
+
+static const lua_reg worldlib[] =
+{
+    { "new",                lua_world_new },
+    { "__gc",               lua_world_free },
+    { "addCircle",          lua_world_addCircle },
+    { "addPoly",            lua_world_addPoly },
+    { "addBox",             lua_world_addBox },
+    { "addCapsule",         lua_world_addCapsule },
+    { "remove",             lua_world_remove },
+    { "clear",              lua_world_clear },
+    { "getBodyCount",       lua_world_getBodyCount },
+    { "setGravity",         lua_world_setGravity },
+    { "setBounds",          lua_world_setBounds },
+    { "setIterations",      lua_world_setIterations },
+    { "setMethod",          lua_world_setMethod },
+    { "step",               lua_world_step },
+    { "getBody",            lua_world_getBody },
+    { "setVelocity",        lua_world_setVelocity },
+    { "setFilter",          lua_world_setFilter },
+    { "getContact",         lua_world_getContact },
+    { "packVelocities",     lua_world_packVelocities },
+    { "packContacts",       lua_world_packContacts },
+    { NULL, NULL }
+};
+
+void registerWorld(PlaydateAPI* playdate)
+{
+    pd = playdate;
+
+    const char* err;
+
+    if (!pd->lua->registerClass(WORLD_TYPE_NAME, worldlib, NULL, 0, &err))
+        pd->system->error("%s:%i: registerClass failed, %s", __FILE__, __LINE__, err);
+}
@@ -0,0 +1,108 @@
+#ifndef _WORLD_H
+#define _WORLD_H
+
+#include "pd_api.h"
+#include "vector2d.h"
+#include "polygon.h"
+#include "collision.h"
+#include "spatialgrid.h"
+
+#define WORLD_TYPE_NAME "collision.world"
+
+#define WORLD_DEFAULT_CELL_SIZE 32.0f
+
+// Simple physics world doing the whole frame in one call: integrate velocities,
+// find pairs with a spatial grid, run the collision functions and resolve the
+// collisions (position correction plus impulse along the normal). Bodies are circles,
+// polygons, axis-aligned boxes or capsules (segments with radius 0) and only move, they
+// do not rotate. A mass of 0 makes a body static. Circles moving further than their radius
+// in one step are swept against static polygons, so they do not tunnel through thin walls.
+
+// Pairs are tested in this order (lower shape first), see world_step
+typedef enum
+{
+    BODY_CIRCLE,
+    BODY_POLY,
+    BODY_BOX,
+    BODY_CAPSULE
+} BodyShape;
+
+typedef struct
+{
+    BodyShape shape;
+    // all but polygons: the center is stored outside of the world (e.g. a Lua vector2D) and moved in place
+    Vector2D *center;
+    float radius;
+    // boxes: half width and height, capsules: from center to one end of the segment
+    Vector2D extent;
+    // polygons are moved with polygon_translate
+    Polygon *poly;
+    LuaUDObject *ref;
+
+    Vector2D velocity;
+    float invMass;
+    float restitution;
+    int proxy;          // spatial grid id
+    // offset of the last integration, start of the swept test of fast circles
+    Vector2D moved;
+} Body;
+
+typedef struct
+{
+    Body *bodies;
+    int bodyCount;
+    int bodyCapacity;
+
+    SpatialGrid *grid;
+    // grid id -> body index
+    int *proxyBodies;
+    int proxyBodyCapacity;
+
+    Vector2D gravity;
+    // bodies bounce off the walls of bounds when hasBounds is set
+    AABB bounds;
+    int hasBounds;
+    int iterations;
+    CollisionMethod method;
+
+    // collisions of the last world_step, a and b are body indices
+    CollisionResult *contacts;
+    int contactCount;
+    int contactCapacity;
+
+    // scratch of the Lua pack functions, in bytes
+    char *packed;
+    int packedCapacity;
+} World;
+
+World *world_new(float cellSize);
+void world_free(World *world);
+void world_clear(World *world);
+
+// Return the index of the new body. center has to stay valid while the body exists.
+int world_addCircle(World *world, Vector2D *center, float radius, float mass, float restitution);
+int world_addPoly(World *world, Polygon *poly, float mass, float restitution);
+int world_addBox(World *world, Vector2D *center, float width, float height, float mass, float restitution);
+// Capsule around the segment center - halfAxis to center + halfAxis, radius 0 for a segment
+int world_addCapsule(World *world, Vector2D *center, Vector2D halfAxis, float radius, float mass, float restitution);
+// The last body takes over index
+void world_remove(World *world, int index);
+// Collision layers of a body (COLLISION_FILTER_DEFAULT when added). Filtered pairs are dropped
+// by the grid before any collision function runs. Static bodies never collide with each
+// other anyway.
+void world_setFilter(World *world, int index, CollisionFilter filter);
+
+// Advances the world by dt, returns the number of collisions (see world->contacts)
+int world_step(World *world, float dt);
+
+// The phases of world_step, which runs them in this order. Exposed to time them separately.
+// Moves the bodies by their velocity and bounces them off the bounds
+void world_integrate(World *world, float dt);
+// Updates the grid, returns the number of candidate pairs in world->grid->pairs
+int world_findPairs(World *world);
+// Tests and resolves the pairs found by world_findPairs, returns the number of collisions
+int world_collide(World *world, int pairCount);
+
+void registerWorld(PlaydateAPI *playdate);
+
+#endif // _WORLD_H